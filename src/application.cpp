@@ -20,6 +20,13 @@
 #include <glad/glad.h>
 #endif
 
+namespace {
+
+// Options shown for a recognized glyph, the most likely one first.
+constexpr size_t candidates_count = 3;
+
+} // namespace
+
 Application::Application() : m_running(false) {}
 
 Application::~Application() {
@@ -126,10 +133,20 @@ bool Application::Init() {
     m_network = std::make_unique<Neural::Network>(m_glyph_buffer_width * m_glyph_buffer_height,
                                                   std::vector<size_t>{hidden_layer_size, m_output_options.size()});
     m_network->Randomize(1337);
+    // Glyphs are mostly background, so the first layer only needs the weights of the drawn pixels.
+    m_network->SetSparseInputs(true);
+    // The targets are one-hot, which softmax outputs learn much faster than squared errors of independent ones.
+    m_network->SetLoss(Neural::Loss::CrossEntropy);
+    m_network_workspace = m_network->CreateWorkspace();
+    m_network_state = m_network->CreateIncrementalState();
 
     m_input_view = std::make_unique<InputView>();
 
     m_network_editor = std::make_unique<NetworkEditor>(*m_network);
+    m_network_editor->NetworkChanged() += [this]() {
+        m_network_workspace = m_network->CreateWorkspace();
+        m_network_state = m_network->CreateIncrementalState();
+    };
 
     return true;
 }
@@ -209,27 +226,30 @@ void Application::Render() {
     ImGui::Begin("Input demo");
     bool glyph_changed = m_input_view->Show(ImVec2(ImGui::GetContentRegionAvailWidth() - ImGui::GetFontSize() * 12, 0));
     size_t glyph_count = m_input_view->GetGlyphCount();
-    if (glyph_changed && glyph_count != 0) {
-        std::vector<float> buffer(m_network_editor->GetInputs().size(), 0);
-        m_input_view->QueryGlyphBuffer(glyph_count - 1, m_glyph_buffer_width, m_glyph_buffer_height, buffer);
-        std::vector<double> inputs(buffer.begin(), buffer.end());
-        auto outputs = m_network->ComputeOutput(inputs);
-        m_selected_option = 0;
-        double certainty = 0;
-        for (size_t i = 0; i != outputs.size(); ++i) {
-            if (outputs[i] > certainty) {
-                certainty = outputs[i];
-                m_selected_option = i;
-            }
-        }
+    if (m_input_view->IsStrokeChanged()) {
+        // Recognize while the pen is still down, between two moves only a few pixels of the glyph change.
+        m_glyph_buffer.resize(m_network_editor->GetInputs().size());
+        m_input_view->QueryStrokeBuffer(m_glyph_buffer_width, m_glyph_buffer_height, m_glyph_buffer);
+        Recognize(m_glyph_buffer);
+    } else if (glyph_changed && glyph_count != 0) {
+        m_glyph_buffer.resize(m_network_editor->GetInputs().size());
+        m_input_view->QueryGlyphBuffer(glyph_count - 1, m_glyph_buffer_width, m_glyph_buffer_height, m_glyph_buffer);
+        Recognize(m_glyph_buffer);
     }
     ImGui::SameLine();
     ImGui::BeginChild("Tools");
     bool wants_feed_to_ann = ImGui::Button("Feed the last glyph to ANN") && glyph_count != 0;
     // TODO: Show radio buttons for every possible value.
     bool wants_add_as_record = ImGui::Button("Add as an example record") && glyph_count != 0;
-    for (size_t option_index = 0; option_index != m_output_options.size(); ++option_index) {
+    for (size_t option_index = 0; option_index != m_output_options.size(); ++option_index)
         ImGui::RadioButton(m_output_options[option_index].c_str(), &m_selected_option, option_index);
+    if (!m_candidates.empty())
+        ImGui::Text("Candidates:");
+    for (const auto& candidate : m_candidates) {
+        if (candidate.index >= m_output_options.size())
+            continue;
+        ImGui::SameLine();
+        ImGui::Text("%s %.2f", m_output_options[candidate.index].c_str(), candidate.confidence);
     }
     if (wants_feed_to_ann || wants_add_as_record) {
         std::vector<float> buffer(m_network_editor->GetInputs().size(), 0);
@@ -249,7 +269,7 @@ void Application::Render() {
         if (wants_feed_to_ann)
             m_network_editor->SetInputs(buffer);
         if (wants_add_as_record) {
-            auto target_outputs = std::vector<double>(10);
+            auto target_outputs = std::vector<float>(10);
             target_outputs[m_selected_option] = 1.0;
             m_network_editor->AddLearningExampleRecord(buffer, target_outputs);
         }
@@ -271,3 +291,10 @@ void Application::Render() {
 
     // last_timestamp = timestamp;
 }
+
+void Application::Recognize(const std::vector<float>& buffer) {
+    const auto candidates =
+        m_network->TopKIncremental(buffer, candidates_count, m_network_state, m_network_workspace);
+    m_candidates.assign(candidates.begin(), candidates.end());
+    m_selected_option = !m_candidates.empty() ? static_cast<int>(m_candidates.front().index) : 0;
+}
@@ -24,6 +24,13 @@ private:
     SDL_GLContext m_context;
     bool m_running;
     std::unique_ptr<Neural::Network> m_network;
+    Neural::Workspace m_network_workspace;
+    // First layer sums of the last recognized glyph, so that redrawing it only recomputes the pixels that changed.
+    Neural::IncrementalState m_network_state;
+    // Raster of the recognized glyph, kept so that recognizing on every move of the pen does not allocate.
+    std::vector<float> m_glyph_buffer;
+    // Strongest outputs of the last recognized glyph.
+    std::vector<Neural::Candidate> m_candidates;
     std::unique_ptr<InputView> m_input_view;
     std::unique_ptr<NetworkEditor> m_network_editor;
     unsigned m_glyph_buffer_width;
@@ -34,5 +41,7 @@ private:
     Event<int, int> m_resized;
 
     void Render();
+    // Run the network on a glyph buffer, keep the most likely options and select the first one.
+    void Recognize(const std::vector<float>&);
     void HandleEvent(SDL_Event&);
 };
@@ -23,7 +23,8 @@ InputView::InputView(float intersection_threshold, float segment_length, float s
                      std::uint32_t background_color, std::uint32_t stroke_color)
     : m_intersection_threshold(intersection_threshold), m_stroke_segment_length(segment_length),
       m_stroke_thickness(stroke_thickness), m_background_color(background_color | 0xff << 24),
-      m_stroke_color(stroke_color | 0xff << 24), m_stroke_history(1), m_history_position(0), m_drawing(false) {}
+      m_stroke_color(stroke_color | 0xff << 24), m_stroke_history(1), m_history_position(0), m_drawing(false),
+      m_stroke_changed(false) {}
 
 InputView::~InputView() {}
 
@@ -44,6 +45,8 @@ bool InputView::Stroke::Intersects(const InputView::Stroke& other, float thresho
 }
 
 bool InputView::Show(ImVec2 size) {
+    m_stroke_changed = false;
+
     ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(0, 0));
     ImGui::PushStyleColor(ImGuiCol_ChildBg, m_background_color);
     bool visible = ImGui::BeginChild("Frame", size, true, ImGuiWindowFlags_NoMove);
@@ -131,6 +134,7 @@ bool InputView::Show(ImVec2 size) {
         } else if (ImGui::IsItemActive()) {
             auto& current_stroke_points = m_glyph_strokes.back().points;
             auto delta = canvas_position - current_stroke_points[current_stroke_points.size() - 2];
+            m_stroke_changed = canvas_position != current_stroke_points.back();
             if (glm::dot(delta, delta) <= m_stroke_segment_length * m_stroke_segment_length) {
                 current_stroke_points.back() = canvas_position;
             } else {
@@ -553,9 +557,35 @@ void InputView::DrawGlyphBuffer(size_t index) const {
 void InputView::QueryGlyphBuffer(size_t index, unsigned buffer_width, unsigned buffer_height,
                                  std::vector<float>& output_destination) const {
     assert(index < m_glyphs.size());
-    assert(output_destination.size() >= static_cast<size_t>(buffer_width) * static_cast<size_t>(buffer_height));
+    RasterizeGlyph(m_glyphs[index], buffer_width, buffer_height, output_destination);
+}
 
-    const auto& glyph = m_glyphs[index];
+void InputView::QueryStrokeBuffer(unsigned buffer_width, unsigned buffer_height,
+                                  std::vector<float>& output_destination) const {
+    assert(m_drawing && !m_glyph_strokes.empty());
+
+    // The bounding box of the stroke is only calculated once it is completed.
+    Stroke stroke = m_glyph_strokes.back();
+    for (const auto& point : stroke.points) {
+        stroke.rect_min = glm::min(point, stroke.rect_min);
+        stroke.rect_max = glm::max(point, stroke.rect_max);
+    }
+
+    Glyph glyph(stroke);
+    for (size_t stroke_index = 0; stroke_index + 1 < m_glyph_strokes.size(); ++stroke_index) {
+        const auto& other_stroke = m_glyph_strokes[stroke_index];
+        if (stroke.Intersects(other_stroke, m_intersection_threshold)) {
+            glyph.strokes.push_back(other_stroke);
+            glyph.rect_min = glm::min(glyph.rect_min, other_stroke.rect_min);
+            glyph.rect_max = glm::max(glyph.rect_max, other_stroke.rect_max);
+        }
+    }
+    RasterizeGlyph(glyph, buffer_width, buffer_height, output_destination);
+}
+
+void InputView::RasterizeGlyph(const Glyph& glyph, unsigned buffer_width, unsigned buffer_height,
+                               std::vector<float>& output_destination) const {
+    assert(output_destination.size() >= static_cast<size_t>(buffer_width) * static_cast<size_t>(buffer_height));
 
     // TODO: Initialize GL-related stuff in the constructor and keep it.
 
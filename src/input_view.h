@@ -17,9 +17,13 @@ public:
     bool Show(ImVec2 = ImVec2(0, 0));
 
     inline size_t GetGlyphCount() const { return m_glyphs.size(); }
+    // Whether the stroke being drawn has changed during the last Show.
+    inline bool IsStrokeChanged() const { return m_stroke_changed; }
 
     void DrawGlyphBuffer(size_t) const;
     void QueryGlyphBuffer(size_t, unsigned, unsigned, std::vector<float>&) const;
+    // The same for the stroke being drawn together with the strokes it touches, i.e. the glyph it is going to become.
+    void QueryStrokeBuffer(unsigned, unsigned, std::vector<float>&) const;
 
 private:
     struct Stroke {
@@ -54,4 +58,7 @@ private:
     std::vector<std::vector<Stroke>> m_stroke_history;
     size_t m_history_position;
     bool m_drawing;
+    bool m_stroke_changed;
+
+    void RasterizeGlyph(const Glyph&, unsigned, unsigned, std::vector<float>&) const;
 };
@@ -43,11 +43,11 @@ static bool NeuronWidget(const std::string& id, double bias, float size = 32) {
     return result;
 }
 
-static void NeuronTooltip(double bias, const std::vector<double>& weights, std::optional<double> output = {}) {
+static void NeuronTooltip(float bias, const float* weights, size_t weights_count, std::optional<float> output = {}) {
     ImGui::BeginTooltip();
     ImGui::BeginTable("Info", 2, ImGuiTableFlags_RowBg);
 
-    for (size_t input_index = 0; input_index != weights.size(); ++input_index) {
+    for (size_t input_index = 0; input_index != weights_count; ++input_index) {
         ImGui::TableNextRow();
         ImGui::TableSetColumnIndex(0);
         ImGui::Text("Weight %zu", input_index);
@@ -74,13 +74,10 @@ static void NeuronTooltip(double bias, const std::vector<double>& weights, std::
 }
 
 // FIXME: The implementation is currently quite hackish and definitely needs to be reworked at some point.
-static void DrawNetworkConnections(const Neural::Network& ann, std::vector<double>* inputs,
-                                   std::vector<double>* outputs) {
-    const auto& weights = ann.GetWeights();
-    const auto& biases = ann.GetBiases();
-
-    assert(!inputs || inputs->size() == weights.front().front().size());
-    assert(!outputs || outputs->size() == weights.back().size());
+static void DrawNetworkConnections(const Neural::Network& ann, std::vector<float>* inputs,
+                                   std::vector<float>* outputs) {
+    assert(!inputs || inputs->size() == ann.GetInputsCount());
+    assert(!outputs || outputs->size() == ann.GetOutputsCount());
 
     const float circle_size = 32;
     const size_t max_layer_size = ann.GetMaxLayerSize();
@@ -88,8 +85,8 @@ static void DrawNetworkConnections(const Neural::Network& ann, std::vector<doubl
 
     char name_buffer[32];
 
-    std::optional<std::vector<double>> input_buffer;
-    std::optional<std::vector<double>> output_buffer;
+    std::optional<std::vector<float>> input_buffer;
+    std::optional<std::vector<float>> output_buffer;
 
     if (inputs) {
         input_buffer.emplace(max_layer_size);
@@ -98,7 +95,7 @@ static void DrawNetworkConnections(const Neural::Network& ann, std::vector<doubl
     }
 
     ImGui::BeginGroup();
-    const size_t inputs_count = weights.front().front().size();
+    const size_t inputs_count = ann.GetInputsCount();
     ImGui::SetCursorPosY(ImGui::GetCursorPosY() + offset * (max_layer_size - inputs_count) * 0.5f);
     for (size_t input_index = 0; input_index != inputs_count; ++input_index) {
         if (inputs) {
@@ -109,7 +106,7 @@ static void DrawNetworkConnections(const Neural::Network& ann, std::vector<doubl
                                 ImVec2(ImGui::GetStyle().ItemSpacing.x,
                                        ImGui::GetStyle().ItemSpacing.y + (circle_size - ImGui::GetFontSize()) * 0.5f));
             ImGui::PushItemWidth(100);
-            ImGui::InputDouble(name_buffer, &inputs->at(input_index), 0.0, 0.0, "%.3f");
+            ImGui::InputFloat(name_buffer, &inputs->at(input_index), 0.0f, 0.0f, "%.3f");
             ImGui::PopItemWidth();
             ImGui::PopStyleVar();
         } else {
@@ -119,9 +116,9 @@ static void DrawNetworkConnections(const Neural::Network& ann, std::vector<doubl
     }
     ImGui::EndGroup();
 
-    for (size_t layer_index = 0; layer_index != weights.size(); ++layer_index) {
-        const auto& layer_weights = weights[layer_index];
-        const auto& layer_biases = biases[layer_index];
+    for (size_t layer_index = 0; layer_index != ann.GetLayersCount(); ++layer_index) {
+        const auto layer_weights = ann.GetWeights(layer_index);
+        const auto& layer_biases = ann.GetBiases(layer_index);
 
         if (input_buffer.has_value()) {
             ann.ComputeOutputForLayer(layer_index, input_buffer.value(), output_buffer.value());
@@ -130,9 +127,9 @@ static void DrawNetworkConnections(const Neural::Network& ann, std::vector<doubl
 
         ImGui::SameLine();
         ImGui::BeginGroup();
-        ImGui::SetCursorPosY(ImGui::GetCursorPosY() + offset * (max_layer_size - layer_weights.size()) * 0.5f);
-        std::optional<double> neuron_output;
-        for (size_t neuron_index = 0; neuron_index != layer_weights.size(); ++neuron_index) {
+        ImGui::SetCursorPosY(ImGui::GetCursorPosY() + offset * (max_layer_size - layer_weights.Rows()) * 0.5f);
+        std::optional<float> neuron_output;
+        for (size_t neuron_index = 0; neuron_index != layer_weights.Rows(); ++neuron_index) {
             if (input_buffer.has_value()) {
                 neuron_output = input_buffer->at(neuron_index);
                 if (outputs)
@@ -141,31 +138,29 @@ static void DrawNetworkConnections(const Neural::Network& ann, std::vector<doubl
             snprintf(name_buffer, sizeof(name_buffer), "%zu", neuron_index);
             NeuronWidget(name_buffer, layer_biases[neuron_index], circle_size);
             if (ImGui::IsItemHovered())
-                NeuronTooltip(layer_biases[neuron_index], layer_weights[neuron_index], neuron_output);
+                NeuronTooltip(layer_biases[neuron_index], layer_weights.Row(neuron_index), layer_weights.Columns(),
+                              neuron_output);
         }
         ImGui::EndGroup();
     }
 }
 
 static void DrawNetworkLayers(const Neural::Network& ann) {
-    const auto& weights = ann.GetWeights();
-    const auto& biases = ann.GetBiases();
-
-    for (size_t layer_index = 0; layer_index != weights.size(); ++layer_index) {
+    for (size_t layer_index = 0; layer_index != ann.GetLayersCount(); ++layer_index) {
         if (!ImGui::TreeNode((void*)(intptr_t)layer_index, "Layer %zu", layer_index))
             continue;
 
-        const auto& layer_weights = weights[layer_index];
-        const auto& layer_biases = biases[layer_index];
+        const auto layer_weights = ann.GetWeights(layer_index);
+        const auto& layer_biases = ann.GetBiases(layer_index);
         char name_buffer[48];
 
         const float column_width = ImGui::GetFontSize() * 5;
 
-        ImGui::SetNextWindowContentSize(ImVec2(column_width * (layer_weights.front().size() + 2), FLT_MIN));
+        ImGui::SetNextWindowContentSize(ImVec2(column_width * (layer_weights.Columns() + 2), FLT_MIN));
         if (!ImGui::BeginChild(
                 "Container",
                 ImVec2(ImGui::GetContentRegionAvail().x,
-                       (ImGui::GetFontSize() + ImGui::GetStyle().CellPadding.y * 2) * (layer_weights.size() + 1) +
+                       (ImGui::GetFontSize() + ImGui::GetStyle().CellPadding.y * 2) * (layer_weights.Rows() + 1) +
                            ImGui::GetStyle().ScrollbarSize),
                 false, ImGuiWindowFlags_HorizontalScrollbar)) {
             ImGui::EndChild();
@@ -194,7 +189,7 @@ static void DrawNetworkLayers(const Neural::Network& ann) {
         ImGui::EndTable();
 
         size_t start_index = 0;
-        for (size_t remaining_columns = layer_weights.front().size(); remaining_columns != 0;) {
+        for (size_t remaining_columns = layer_weights.Columns(); remaining_columns != 0;) {
             const size_t columns_count =
                 remaining_columns > IMGUI_TABLE_MAX_COLUMNS ? IMGUI_TABLE_MAX_COLUMNS : remaining_columns;
             const size_t next_start_index = start_index + columns_count;
@@ -210,8 +205,8 @@ static void DrawNetworkLayers(const Neural::Network& ann) {
             }
             ImGui::TableHeadersRow();
 
-            for (size_t neuron_index = 0; neuron_index != layer_weights.size(); ++neuron_index) {
-                const auto& neuron_weights = layer_weights[neuron_index];
+            for (size_t neuron_index = 0; neuron_index != layer_weights.Rows(); ++neuron_index) {
+                const float* neuron_weights = layer_weights.Row(neuron_index);
 
                 int column = 0;
                 ImGui::TableNextRow();
@@ -234,7 +229,7 @@ static void DrawNetworkLayers(const Neural::Network& ann) {
     }
 }
 
-void ShowProperty(const Neural::Network& ann, std::vector<double>* inputs, std::vector<double>* outputs) {
+void ShowProperty(const Neural::Network& ann, std::vector<float>* inputs, std::vector<float>* outputs) {
     if (ImGui::TreeNode("Connections")) {
         DrawNetworkConnections(ann, inputs, outputs);
         ImGui::TreePop();
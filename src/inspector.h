@@ -12,6 +12,6 @@ namespace Inspector {
 bool ShowProperty(double&);
 bool ShowProperty(int&);
 
-void ShowProperty(const Neural::Network&, std::vector<double>* = nullptr, std::vector<double>* = nullptr);
+void ShowProperty(const Neural::Network&, std::vector<float>* = nullptr, std::vector<float>* = nullptr);
 
 } // namespace Inspector
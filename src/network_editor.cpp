@@ -1,17 +1,67 @@
 #include "network_editor.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <limits>
+#include <thread>
 
 #include "imgui.h"
 #include "inspector.h"
+#include <neural/cascade_network.h>
+#include <neural/convolutional_network.h>
+#include <neural/fixed_network.h>
+#include <neural/pruned_network.h>
+#include <neural/quantized_network.h>
+#include <neural/sequential_network.h>
 #include <util/csv.h>
 
+namespace {
+
+// Topology of the digits model deployed by the application: 16x16 glyphs, 20 hidden neurons and 10 digits.
+using DigitsNetwork = Neural::FixedNetwork<256, 20, 10>;
+
+// Side of the square glyphs fed to the network, or 0 if its inputs are not a glyph the pooling layers can shrink.
+size_t GetGlyphSide(const Neural::Network& network) {
+    const size_t side = static_cast<size_t>(std::lround(std::sqrt(network.GetInputsCount())));
+    return side * side == network.GetInputsCount() && side >= 4 ? side : 0;
+}
+
+// Seconds a call of `compute` takes. A single pass over a small dataset is too short to time, it is repeated until it
+// adds up.
+template <typename F>
+double MeasureSeconds(const F& compute) {
+    size_t passes_count = 0;
+    const auto start_time = std::chrono::steady_clock::now();
+    double seconds = 0;
+    do {
+        compute();
+        ++passes_count;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    } while (seconds < 0.05);
+    return seconds / passes_count;
+}
+
+// Seconds per sample of `compute` called with the inputs of every record in turn.
+template <typename R, typename F>
+double MeasureSecondsPerSample(const std::vector<R>& records, const F& compute) {
+    const auto compute_records = [&]() {
+        for (const auto& record : records)
+            compute(record.inputs);
+    };
+    return MeasureSeconds(compute_records) / records.size();
+}
+
+} // namespace
+
 NetworkEditor::NetworkEditor(Neural::Network& ann, float learning_rate)
-    : m_network(ann), m_learn_continuously(false), m_learning_rate(learning_rate),
-      m_network_inputs(ann.GetWeights().front().front().size()), m_model_save_path(256, '\0'),
-      m_dataset_save_path(256, '\0') {}
+    : m_network(ann), m_learn_continuously(false), m_learning_rate(learning_rate), m_batch_size(1),
+      m_threads_count(std::max(1u, std::thread::hardware_concurrency())), m_learn_asynchronously(false), m_trainer(),
+      m_async_trainer(), m_workspace(ann.CreateWorkspace()), m_network_inputs(ann.GetInputsCount()),
+      m_pruning_sparsity(0.9f), m_pruning_epochs(5), m_model_save_path(256, '\0'), m_dataset_save_path(256, '\0') {}
 
 NetworkEditor::~NetworkEditor() {}
 
@@ -44,14 +94,14 @@ void NetworkEditor::Show() {
                 if (ImGui::TreeNode("Inputs")) {
                     for (size_t input_index = 0; input_index != record.inputs.size(); ++input_index) {
                         snprintf(name_buffer, sizeof(name_buffer), "Input %zu", input_index);
-                        ImGui::InputDouble(name_buffer, &record.inputs[input_index]);
+                        ImGui::InputFloat(name_buffer, &record.inputs[input_index]);
                     }
                     ImGui::TreePop();
                 }
                 if (ImGui::TreeNode("Outputs")) {
                     for (size_t output_index = 0; output_index != record.outputs.size(); ++output_index) {
                         snprintf(name_buffer, sizeof(name_buffer), "Output %zu", output_index);
-                        ImGui::InputDouble(name_buffer, &record.outputs[output_index]);
+                        ImGui::InputFloat(name_buffer, &record.outputs[output_index]);
                     }
                     ImGui::TreePop();
                 }
@@ -67,14 +117,12 @@ void NetworkEditor::Show() {
     }
     ImGui::SameLine();
     if (ImGui::Button("Load")) {
-        // TODO: m_network.get() = LoadFromFile(m_model_save_path);
         wants_action = true;
         m_wants_model = true;
         m_wants_write = false;
     }
     ImGui::SameLine();
     if (ImGui::Button("Save")) {
-        // TODO: m_network.get().DumpToFile(m_model_save_path);
         wants_action = true;
         m_wants_model = true;
         m_wants_write = true;
@@ -83,18 +131,185 @@ void NetworkEditor::Show() {
     ImGui::SetNextItemWidth(ImGui::GetWindowWidth() - ImGui::GetCursorPosX() - 100);
     ImGui::InputText("Path", m_model_save_path.data(), m_model_save_path.capacity());
 
+    ImGui::Text("Activation:");
+    for (auto activation : {Neural::Kernels::Activation::Fast, Neural::Kernels::Activation::Precise,
+                            Neural::Kernels::Activation::Exact}) {
+        ImGui::SameLine();
+        if (ImGui::RadioButton(Neural::Kernels::GetName(activation), m_network.get().GetActivation() == activation)) {
+            m_network.get().SetActivation(activation);
+            m_activation_error.reset();
+        }
+    }
+    if (!m_activation_error.has_value()) {
+        const auto& kernels = Neural::Kernels::GetTable<float>(m_network.get().GetInstructionSet());
+        m_activation_error = Neural::Kernels::MeasureMaxError(kernels, m_network.get().GetActivation());
+    }
+    ImGui::SameLine();
+    if (m_network.get().GetActivation() != Neural::Kernels::Activation::Exact)
+        ImGui::Text("max error %.2g (bound %.2g)", *m_activation_error,
+                    Neural::Kernels::GetMaxError(m_network.get().GetActivation()));
+    else
+        ImGui::Text("max error %.2g (rounding)", *m_activation_error);
+
+    ImGui::Text("Optimizer:");
+    for (auto type : {Neural::Optimizer::Type::Sgd, Neural::Optimizer::Type::Momentum,
+                      Neural::Optimizer::Type::Nesterov, Neural::Optimizer::Type::Adam}) {
+        ImGui::SameLine();
+        if (ImGui::RadioButton(Neural::GetName(type), m_network.get().GetOptimizer().type == type)) {
+            Neural::Optimizer optimizer;
+            optimizer.type = type;
+            m_network.get().SetOptimizer(optimizer);
+        }
+    }
+
+    ImGui::Text("Loss:");
+    for (auto loss : {Neural::Loss::SquaredError, Neural::Loss::CrossEntropy}) {
+        ImGui::SameLine();
+        if (ImGui::RadioButton(Neural::GetName(loss), m_network.get().GetLoss() == loss))
+            m_network.get().SetLoss(loss);
+    }
+
     ImGui::Checkbox("Learn", &m_learn_continuously);
     ImGui::SameLine();
     bool step_once = ImGui::Button("Step once");
     ImGui::SameLine();
     ImGui::SetNextItemWidth(ImGui::GetWindowWidth() - ImGui::GetCursorPosX() - 100);
-    ImGui::SliderFloat("Learning rate", &m_learning_rate, 0.01f, 1.0f);
+    // Adam takes much smaller steps than the others.
+    ImGui::SliderFloat("Learning rate", &m_learning_rate, 0.001f, 1.0f, "%.3f");
+    ImGui::SetNextItemWidth(ImGui::GetWindowWidth() - ImGui::GetCursorPosX() - 100);
+    ImGui::SliderInt("Batch size", &m_batch_size, 1, 256);
+    ImGui::SetNextItemWidth(ImGui::GetWindowWidth() - ImGui::GetCursorPosX() - 100);
+    ImGui::SliderInt("Threads", &m_threads_count, 1, std::max(1u, std::thread::hardware_concurrency()));
+    if (m_batch_size == 1)
+        ImGui::Checkbox("Asynchronous", &m_learn_asynchronously);
     if (m_learn_continuously || step_once) {
-        for (const auto& record : m_dataset_records) {
-            m_network.get().Learn(record.inputs, record.outputs, m_learning_rate);
+        m_quantization_report.reset();
+        if (m_batch_size == 1 && m_learn_asynchronously) {
+            if (!m_async_trainer || m_async_trainer->GetThreadsCount() != static_cast<size_t>(m_threads_count))
+                m_async_trainer = std::make_unique<Neural::AsyncTrainer<float>>(m_network.get(), m_threads_count);
+            Neural::Matrix<float> inputs, outputs;
+            BuildDatasetMatrices(inputs, outputs);
+            m_async_trainer->Learn(inputs.View(), outputs.View(), m_learning_rate);
+        } else if (m_batch_size == 1) {
+            for (const auto& record : m_dataset_records) {
+                m_network.get().Learn(record.inputs, record.outputs, m_learning_rate, m_workspace);
+            }
+        } else {
+            if (!m_trainer || m_trainer->GetThreadsCount() != static_cast<size_t>(m_threads_count))
+                m_trainer = std::make_unique<Neural::ParallelTrainer<float>>(m_network.get(), m_threads_count);
+            Neural::Matrix<float> inputs, outputs;
+            BuildDatasetMatrices(inputs, outputs);
+            const size_t batch_size = m_batch_size;
+            for (size_t first_record = 0; first_record < m_dataset_records.size(); first_record += batch_size) {
+                const size_t records_count = std::min(batch_size, m_dataset_records.size() - first_record);
+                m_trainer->LearnBatch(inputs.View().RowRange(first_record, records_count),
+                                      outputs.View().RowRange(first_record, records_count), m_learning_rate);
+            }
+        }
+        m_dataset_accuracy.reset();
+    }
+
+    if (ImGui::Button("Evaluate"))
+        m_dataset_accuracy = EvaluateAccuracy();
+    if (m_dataset_accuracy.has_value()) {
+        ImGui::SameLine();
+        ImGui::Text("Accuracy: %.1f%% of %zu records", *m_dataset_accuracy * 100, m_dataset_records.size());
+    }
+
+    if (ImGui::Button("Quantize"))
+        m_quantization_report = RunQuantizationReport();
+    if (m_quantization_report.has_value()) {
+        const auto& report = *m_quantization_report;
+        ImGui::SameLine();
+        ImGui::Text("Int8 accuracy: %.1f%% (%+.1f%%)", report.quantized_accuracy * 100,
+                    (report.quantized_accuracy - report.accuracy) * 100);
+        ImGui::Text("Parameters: %zu -> %zu bytes, dataset pass: %.3f -> %.3f ms", report.parameters_size,
+                    report.quantized_parameters_size, report.seconds * 1000, report.quantized_seconds * 1000);
+    }
+
+    ImGui::SliderFloat("Pruned weights", &m_pruning_sparsity, 0, 0.99f, "%.2f");
+    ImGui::SliderInt("Fine-tuning epochs", &m_pruning_epochs, 0, 20);
+    if (!m_dataset_records.empty() && ImGui::Button("Prune"))
+        m_pruning_report = RunPruningReport();
+    if (m_pruning_report.has_value()) {
+        const auto& report = *m_pruning_report;
+        ImGui::SameLine();
+        ImGui::Text("%.0f%% pruned, accuracy: %.1f%% (%+.1f%%)", report.sparsity * 100, report.pruned_accuracy * 100,
+                    (report.pruned_accuracy - report.accuracy) * 100);
+        ImGui::Text("Parameters: %zu -> %zu bytes, dataset pass: %.3f -> %.3f ms", report.parameters_size,
+                    report.pruned_parameters_size, report.seconds * 1000, report.pruned_seconds * 1000);
+        if (ImGui::Button("Keep pruned network")) {
+            m_network.get() = std::move(*m_pruning_report->network);
+            Rebind(m_network.get());
+            m_network_changed.Invoke();
         }
     }
 
+    if (GetGlyphSide(m_network) != 0 && !m_dataset_records.empty() && ImGui::Button("Compare convolutions"))
+        m_convolution_report = RunConvolutionReport();
+    if (m_convolution_report.has_value()) {
+        const auto& report = *m_convolution_report;
+        ImGui::SameLine();
+        ImGui::Text("Convolutional accuracy: %.1f%% (%+.1f%%)", report.convolutional_accuracy * 100,
+                    (report.convolutional_accuracy - report.accuracy) * 100);
+        ImGui::Text("Parameters: %zu -> %zu bytes, per sample: %.0f -> %.0f ns direct, %.0f ns im2col",
+                    report.parameters_size, report.convolutional_parameters_size, report.seconds_per_sample * 1e9,
+                    report.direct_seconds_per_sample * 1e9, report.im2col_seconds_per_sample * 1e9);
+    }
+
+    if (!m_dataset_records.empty() && ImGui::Button("Build cascade"))
+        m_cascade_report = RunCascadeReport();
+    if (m_cascade_report.has_value()) {
+        const auto& report = *m_cascade_report;
+        ImGui::SameLine();
+        ImGui::Text("%.1f%% answered by the first stage (threshold %.3f)", report.exit_rate * 100, report.threshold);
+        ImGui::Text("Accuracy: first stage %.1f%%, network %.1f%%, cascade %.1f%%", report.first_stage_accuracy * 100,
+                    report.accuracy * 100, report.cascade_accuracy * 100);
+        ImGui::Text("Per sample: first stage %.0f ns, network %.0f ns, cascade %.0f ns",
+                    report.first_stage_seconds_per_sample * 1e9, report.seconds_per_sample * 1e9,
+                    report.cascade_seconds_per_sample * 1e9);
+    }
+
+    if (!m_dataset_records.empty() && ImGui::Button("Compare layer stack"))
+        m_layers_report = RunLayersReport();
+    if (m_layers_report.has_value()) {
+        const auto& report = *m_layers_report;
+        ImGui::SameLine();
+        ImGui::Text("Max difference %.2g, dataset pass: %.3f -> %.3f ms", report.max_difference, report.seconds * 1000,
+                    report.sequential_seconds * 1000);
+        ImGui::Text("With normalization and dropout, accuracy: %.1f%% (%+.1f%%)", report.regularized_accuracy * 100,
+                    (report.regularized_accuracy - report.accuracy) * 100);
+    }
+
+    if (ImGui::Button("Benchmark asynchronous learning"))
+        m_learning_benchmark = RunLearningBenchmark();
+    if (m_learning_benchmark.has_value()) {
+        const auto& benchmark = *m_learning_benchmark;
+        ImGui::Text("Serial: %.3f s, loss %.4f -> %.4f (%.4f per second)", benchmark.serial_seconds,
+                    benchmark.initial_loss, benchmark.serial_loss,
+                    (benchmark.initial_loss - benchmark.serial_loss) / benchmark.serial_seconds);
+        ImGui::Text("Asynchronous, %zu threads: %.3f s, loss %.4f -> %.4f (%.4f per second)", benchmark.threads_count,
+                    benchmark.async_seconds, benchmark.initial_loss, benchmark.async_loss,
+                    (benchmark.initial_loss - benchmark.async_loss) / benchmark.async_seconds);
+    }
+
+    if (DigitsNetwork::IsCompatible(m_network) && !m_dataset_records.empty() &&
+        ImGui::Button("Compare fixed topology"))
+        m_fixed_network_report = RunFixedNetworkReport();
+    if (m_fixed_network_report.has_value()) {
+        const auto& report = *m_fixed_network_report;
+        ImGui::SameLine();
+        ImGui::Text("Per sample: %.0f -> %.0f ns, max difference %.2g", report.seconds_per_sample * 1e9,
+                    report.fixed_seconds_per_sample * 1e9, report.max_difference);
+    }
+
+    if (ImGui::Button("Benchmark matrix kernels"))
+        m_kernel_benchmarks = RunKernelBenchmarks();
+    for (const auto& benchmark : m_kernel_benchmarks)
+        ImGui::Text("%zu samples, %zu x %zu: forward %.1f, backward %.1f, accumulate %.1f GFLOP/s",
+                    benchmark.samples_count, benchmark.rows, benchmark.columns, benchmark.throughput.forward,
+                    benchmark.throughput.backward, benchmark.throughput.accumulate);
+
     if (wants_action && m_wants_write) {
         if (std::filesystem::exists(m_wants_model ? m_model_save_path : m_dataset_save_path))
             ImGui::OpenPopup("Warning");
@@ -125,8 +340,12 @@ void NetworkEditor::Show() {
     }
 
     if (wants_action) {
-        if (!(m_wants_write ? (m_wants_model ? false : SaveLearningExamples(m_dataset_save_path))
-                            : (m_wants_model ? false : LoadLearningExamples(m_dataset_save_path))))
+        const bool succeeded = m_wants_write
+                                   ? (m_wants_model ? SaveModel(m_model_save_path)
+                                                    : SaveLearningExamples(m_dataset_save_path))
+                                   : (m_wants_model ? LoadModel(m_model_save_path)
+                                                    : LoadLearningExamples(m_dataset_save_path));
+        if (!succeeded)
             ImGui::OpenPopup("Error");
     }
 
@@ -151,7 +370,396 @@ void NetworkEditor::Rebind(Neural::Network& new_network) {
         m_dataset_records.clear();
 
     m_network = new_network;
-    m_network_inputs.resize(new_network.GetWeights().front().front().size());
+    m_workspace = new_network.CreateWorkspace();
+    m_trainer.reset();
+    m_async_trainer.reset();
+    m_dataset_accuracy.reset();
+    m_learning_benchmark.reset();
+    m_quantization_report.reset();
+    m_pruning_report.reset();
+    m_convolution_report.reset();
+    m_cascade_report.reset();
+    m_layers_report.reset();
+    m_kernel_benchmarks.clear();
+    m_fixed_network_report.reset();
+    m_activation_error.reset();
+    m_network_inputs.resize(new_network.GetInputsCount());
+}
+
+namespace {
+
+// Fraction of rows whose strongest output matches the strongest target output.
+float MeasureAccuracy(Neural::MatrixView<const float> outputs, Neural::MatrixView<const float> targets) {
+    size_t correct_count = 0;
+    for (size_t record_index = 0; record_index != outputs.Rows(); ++record_index) {
+        const float* record_outputs = outputs.Row(record_index);
+        const float* record_targets = targets.Row(record_index);
+        if (std::max_element(record_outputs, record_outputs + outputs.Columns()) - record_outputs ==
+            std::max_element(record_targets, record_targets + targets.Columns()) - record_targets)
+            ++correct_count;
+    }
+    return static_cast<float>(correct_count) / outputs.Rows();
+}
+
+} // namespace
+
+float NetworkEditor::EvaluateAccuracy() const {
+    if (m_dataset_records.empty())
+        return 0;
+
+    Neural::Matrix<float> inputs, targets;
+    BuildDatasetMatrices(inputs, targets);
+    Neural::Matrix<float> outputs(m_dataset_records.size(), m_network.get().GetOutputsCount());
+    m_network.get().ComputeOutputBatch(inputs.View(), outputs.View());
+    return MeasureAccuracy(outputs.View(), targets.View());
+}
+
+namespace {
+
+// Mean loss of the network over the samples: the squared error halved like in the derivation of the backpropagation,
+// or the cross-entropy of the outputs against the targets.
+float EvaluateLoss(const Neural::Network& network, Neural::MatrixView<const float> inputs,
+                   Neural::MatrixView<const float> targets) {
+    if (inputs.Rows() == 0)
+        return 0;
+
+    Neural::Matrix<float> outputs(inputs.Rows(), network.GetOutputsCount());
+    network.ComputeOutputBatch(inputs, outputs.View());
+    float loss = 0;
+    for (size_t record_index = 0; record_index != inputs.Rows(); ++record_index)
+        for (size_t output_index = 0; output_index != outputs.Columns(); ++output_index) {
+            const float target = targets(record_index, output_index);
+            const float output = outputs(record_index, output_index);
+            if (network.GetLoss() == Neural::Loss::CrossEntropy) {
+                // Outputs that round to zero would make the loss infinite.
+                if (target != 0)
+                    loss -= target * std::log(std::max(output, std::numeric_limits<float>::min()));
+            } else {
+                loss += (target - output) * (target - output) / 2;
+            }
+        }
+    return loss / inputs.Rows();
+}
+
+} // namespace
+
+std::vector<NetworkEditor::KernelBenchmark> NetworkEditor::RunKernelBenchmarks() const {
+    // The current layers first, then wider ones of the kind the kernels are blocked for.
+    std::vector<KernelBenchmark> benchmarks;
+    for (size_t layer_index = 0; layer_index != m_network.get().GetLayersCount(); ++layer_index) {
+        const auto weights = m_network.get().GetWeights(layer_index);
+        benchmarks.push_back({256, weights.Rows(), weights.Columns(), {}});
+    }
+    for (size_t size : {256, 1024, 4096})
+        benchmarks.push_back({256, size, 1024, {}});
+
+    const auto& kernels = Neural::Kernels::GetTable<float>(m_network.get().GetInstructionSet());
+    for (auto& benchmark : benchmarks)
+        benchmark.throughput =
+            Neural::Kernels::MeasureThroughput(kernels, benchmark.samples_count, benchmark.rows, benchmark.columns);
+    return benchmarks;
+}
+
+NetworkEditor::LearningBenchmark NetworkEditor::RunLearningBenchmark() const {
+    constexpr int epochs_count = 10;
+
+    Neural::Matrix<float> inputs, targets;
+    BuildDatasetMatrices(inputs, targets);
+
+    LearningBenchmark benchmark;
+    benchmark.initial_loss = EvaluateLoss(m_network, inputs.View(), targets.View());
+
+    // The serial run is the plain per-record loop used for learning with the batch size of 1.
+    Neural::Network serial_network = m_network;
+    auto workspace = serial_network.CreateWorkspace();
+    auto start_time = std::chrono::steady_clock::now();
+    for (int epoch = 0; epoch != epochs_count; ++epoch)
+        for (const auto& record : m_dataset_records)
+            serial_network.Learn(record.inputs, record.outputs, m_learning_rate, workspace);
+    benchmark.serial_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    benchmark.serial_loss = EvaluateLoss(serial_network, inputs.View(), targets.View());
+
+    Neural::Network async_network = m_network;
+    Neural::AsyncTrainer<float> async_trainer(async_network, m_threads_count);
+    benchmark.threads_count = async_trainer.GetThreadsCount();
+    start_time = std::chrono::steady_clock::now();
+    for (int epoch = 0; epoch != epochs_count; ++epoch)
+        async_trainer.Learn(inputs.View(), targets.View(), m_learning_rate);
+    benchmark.async_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    benchmark.async_loss = EvaluateLoss(async_network, inputs.View(), targets.View());
+
+    return benchmark;
+}
+
+NetworkEditor::QuantizationReport NetworkEditor::RunQuantizationReport() const {
+    Neural::Matrix<float> inputs, targets;
+    BuildDatasetMatrices(inputs, targets);
+    Neural::Matrix<float> outputs(m_dataset_records.size(), m_network.get().GetOutputsCount());
+
+    const Neural::QuantizedNetwork quantized_network(m_network, inputs.View());
+
+    QuantizationReport report;
+    report.parameters_size = 0;
+    for (size_t layer_index = 0; layer_index != m_network.get().GetLayersCount(); ++layer_index) {
+        const auto weights = m_network.get().GetWeights(layer_index);
+        report.parameters_size += weights.Rows() * (weights.Columns() + 1) * sizeof(float);
+    }
+    report.quantized_parameters_size = quantized_network.GetParametersSize();
+
+    auto workspace = m_network.get().CreateWorkspace();
+    report.seconds =
+        MeasureSeconds([&]() { m_network.get().ComputeOutputBatch(inputs.View(), outputs.View(), workspace); });
+    report.accuracy = m_dataset_records.empty() ? 0 : MeasureAccuracy(outputs.View(), targets.View());
+
+    report.quantized_seconds =
+        MeasureSeconds([&]() { quantized_network.ComputeOutputBatch(inputs.View(), outputs.View()); });
+    report.quantized_accuracy = m_dataset_records.empty() ? 0 : MeasureAccuracy(outputs.View(), targets.View());
+
+    return report;
+}
+
+NetworkEditor::PruningReport NetworkEditor::RunPruningReport() const {
+    Neural::Matrix<float> inputs, targets;
+    BuildDatasetMatrices(inputs, targets);
+    Neural::Matrix<float> outputs(m_dataset_records.size(), m_network.get().GetOutputsCount());
+
+    PruningReport report;
+    report.network = std::make_unique<Neural::Network>(m_network.get());
+    const Neural::WeightPruning pruning(*report.network, m_pruning_sparsity);
+    pruning.FineTune(*report.network, inputs.View(), targets.View(), m_learning_rate, m_batch_size, m_pruning_epochs);
+    const Neural::PrunedNetwork pruned_network(*report.network);
+    report.sparsity = static_cast<float>(pruning.GetSparsity());
+
+    report.parameters_size = 0;
+    for (size_t layer_index = 0; layer_index != m_network.get().GetLayersCount(); ++layer_index) {
+        const auto weights = m_network.get().GetWeights(layer_index);
+        report.parameters_size += weights.Rows() * (weights.Columns() + 1) * sizeof(float);
+    }
+    report.pruned_parameters_size = pruned_network.GetParametersSize();
+
+    auto workspace = m_network.get().CreateWorkspace();
+    report.seconds =
+        MeasureSeconds([&]() { m_network.get().ComputeOutputBatch(inputs.View(), outputs.View(), workspace); });
+    report.accuracy = MeasureAccuracy(outputs.View(), targets.View());
+    report.pruned_seconds = MeasureSeconds([&]() { pruned_network.ComputeOutputBatch(inputs.View(), outputs.View()); });
+    report.pruned_accuracy = MeasureAccuracy(outputs.View(), targets.View());
+
+    return report;
+}
+
+NetworkEditor::ConvolutionReport NetworkEditor::RunConvolutionReport() const {
+    // Convolutions start slower than a dense layer, they need more epochs to catch up.
+    constexpr int epochs_count = 30;
+
+    // Two convolutions, each followed by halving the feature map, and the outputs of the network on top.
+    const size_t side = GetGlyphSide(m_network);
+    Neural::ConvolutionalNetwork network({side, side, 1},
+                                         {Neural::ConvolutionalNetwork::LayerDescription::Convolution(8, 3),
+                                          Neural::ConvolutionalNetwork::LayerDescription::MaxPooling(2),
+                                          Neural::ConvolutionalNetwork::LayerDescription::Convolution(16, 3),
+                                          Neural::ConvolutionalNetwork::LayerDescription::MaxPooling(2),
+                                          Neural::ConvolutionalNetwork::LayerDescription::Dense(
+                                              m_network.get().GetOutputsCount())});
+    network.Randomize(0);
+    network.SetInstructionSet(m_network.get().GetInstructionSet());
+    network.SetActivation(m_network.get().GetActivation());
+    auto workspace = network.CreateWorkspace();
+    for (int epoch = 0; epoch != epochs_count; ++epoch)
+        for (const auto& record : m_dataset_records)
+            network.Learn(record.inputs, record.outputs, m_learning_rate, workspace);
+
+    Neural::Matrix<float> inputs, targets;
+    BuildDatasetMatrices(inputs, targets);
+    Neural::Matrix<float> outputs(m_dataset_records.size(), m_network.get().GetOutputsCount());
+
+    ConvolutionReport report;
+    m_network.get().ComputeOutputBatch(inputs.View(), outputs.View());
+    report.accuracy = MeasureAccuracy(outputs.View(), targets.View());
+    network.ComputeOutputBatch(inputs.View(), outputs.View(), workspace);
+    report.convolutional_accuracy = MeasureAccuracy(outputs.View(), targets.View());
+
+    report.parameters_size = 0;
+    for (size_t layer_index = 0; layer_index != m_network.get().GetLayersCount(); ++layer_index) {
+        const auto weights = m_network.get().GetWeights(layer_index);
+        report.parameters_size += weights.Rows() * (weights.Columns() + 1) * sizeof(float);
+    }
+    report.convolutional_parameters_size = network.GetParametersCount() * sizeof(float);
+
+    auto network_workspace = m_network.get().CreateWorkspace();
+    std::vector<float> sample_outputs(m_network.get().GetOutputsCount());
+    const auto compute_dense = [&](const std::vector<float>& sample_inputs) {
+        m_network.get().ComputeOutput(sample_inputs, network_workspace, sample_outputs);
+    };
+    report.seconds_per_sample = MeasureSecondsPerSample(m_dataset_records, compute_dense);
+    const auto compute_convolutional = [&](const std::vector<float>& sample_inputs) {
+        network.ComputeOutput(sample_inputs, workspace, sample_outputs);
+    };
+    network.SetConvolutionAlgorithm(Neural::ConvolutionAlgorithm::Direct);
+    report.direct_seconds_per_sample = MeasureSecondsPerSample(m_dataset_records, compute_convolutional);
+    network.SetConvolutionAlgorithm(Neural::ConvolutionAlgorithm::Im2col);
+    report.im2col_seconds_per_sample = MeasureSecondsPerSample(m_dataset_records, compute_convolutional);
+    return report;
+}
+
+NetworkEditor::CascadeReport NetworkEditor::RunCascadeReport() const {
+    constexpr int epochs_count = 20;
+
+    // The outputs straight from the inputs, a fraction of the cost of the hidden layers of the network.
+    Neural::Network first_stage(m_network.get().GetInputsCount(), {m_network.get().GetOutputsCount()});
+    first_stage.Randomize(0);
+    first_stage.SetInstructionSet(m_network.get().GetInstructionSet());
+    first_stage.SetActivation(m_network.get().GetActivation());
+    first_stage.SetLoss(m_network.get().GetLoss());
+    first_stage.SetSparseInputs(m_network.get().GetSparseInputs());
+    auto first_stage_workspace = first_stage.CreateWorkspace();
+    for (int epoch = 0; epoch != epochs_count; ++epoch)
+        for (const auto& record : m_dataset_records)
+            first_stage.Learn(record.inputs, record.outputs, m_learning_rate, first_stage_workspace);
+
+    Neural::Matrix<float> inputs, targets;
+    BuildDatasetMatrices(inputs, targets);
+    Neural::CascadeNetwork cascade(std::move(first_stage), m_network.get());
+    cascade.Calibrate(inputs.View(), targets.View());
+
+    CascadeReport report;
+    report.threshold = cascade.GetThreshold();
+    Neural::Matrix<float> outputs(m_dataset_records.size(), m_network.get().GetOutputsCount());
+    cascade.GetSecondStage().ComputeOutputBatch(inputs.View(), outputs.View());
+    report.accuracy = MeasureAccuracy(outputs.View(), targets.View());
+    cascade.GetFirstStage().ComputeOutputBatch(inputs.View(), outputs.View());
+    report.first_stage_accuracy = MeasureAccuracy(outputs.View(), targets.View());
+    auto workspace = cascade.CreateWorkspace();
+    size_t exits_count = 0;
+    for (size_t record_index = 0; record_index != m_dataset_records.size(); ++record_index)
+        if (cascade.ComputeOutput(m_dataset_records[record_index].inputs, workspace,
+                                  {outputs.Row(record_index), outputs.Columns()}) == 0)
+            ++exits_count;
+    report.exit_rate = static_cast<float>(exits_count) / m_dataset_records.size();
+    report.cascade_accuracy = MeasureAccuracy(outputs.View(), targets.View());
+
+    std::vector<float> sample_outputs(m_network.get().GetOutputsCount());
+    const auto compute_second_stage = [&](const std::vector<float>& sample_inputs) {
+        cascade.GetSecondStage().ComputeOutput(sample_inputs, workspace.second, sample_outputs);
+    };
+    const auto compute_first_stage = [&](const std::vector<float>& sample_inputs) {
+        cascade.GetFirstStage().ComputeOutput(sample_inputs, workspace.first, sample_outputs);
+    };
+    const auto compute_cascade = [&](const std::vector<float>& sample_inputs) {
+        cascade.ComputeOutput(sample_inputs, workspace, sample_outputs);
+    };
+    report.seconds_per_sample = MeasureSecondsPerSample(m_dataset_records, compute_second_stage);
+    report.first_stage_seconds_per_sample = MeasureSecondsPerSample(m_dataset_records, compute_first_stage);
+    report.cascade_seconds_per_sample = MeasureSecondsPerSample(m_dataset_records, compute_cascade);
+    return report;
+}
+
+NetworkEditor::LayersReport NetworkEditor::RunLayersReport() const {
+    constexpr int epochs_count = 20;
+    constexpr float dropout_probability = 0.1f;
+
+    Neural::Matrix<float> inputs, targets;
+    BuildDatasetMatrices(inputs, targets);
+    Neural::Matrix<float> outputs(m_dataset_records.size(), m_network.get().GetOutputsCount());
+    Neural::Matrix<float> sequential_outputs(outputs.Rows(), outputs.Columns());
+
+    LayersReport report;
+    const Neural::SequentialNetwork sequential_network(m_network);
+    auto network_workspace = m_network.get().CreateWorkspace();
+    auto sequential_workspace = sequential_network.CreateWorkspace();
+    report.seconds = MeasureSeconds(
+        [&]() { m_network.get().ComputeOutputBatch(inputs.View(), outputs.View(), network_workspace); });
+    report.accuracy = MeasureAccuracy(outputs.View(), targets.View());
+    report.sequential_seconds = MeasureSeconds([&]() {
+        sequential_network.ComputeOutputBatch(inputs.View(), sequential_outputs.View(), sequential_workspace);
+    });
+    report.max_difference = 0;
+    for (size_t record_index = 0; record_index != outputs.Rows(); ++record_index)
+        for (size_t output_index = 0; output_index != outputs.Columns(); ++output_index)
+            report.max_difference = std::max(report.max_difference, std::abs(outputs(record_index, output_index) -
+                                                                              sequential_outputs(record_index,
+                                                                                                 output_index)));
+
+    // The hidden layers of the network, each normalized before its activation and followed by dropout.
+    Neural::SequentialNetwork regularized_network;
+    size_t inputs_count = m_network.get().GetInputsCount();
+    for (size_t layer_index = 0; layer_index + 1 != m_network.get().GetLayersCount(); ++layer_index) {
+        const size_t layer_size = m_network.get().GetLayerSize(layer_index);
+        regularized_network.Add<Neural::DenseLayer>(inputs_count, layer_size);
+        regularized_network.Add<Neural::NormalizationLayer>(layer_size);
+        regularized_network.Add<Neural::ActivationLayer>(layer_size, m_network.get().GetActivation());
+        regularized_network.Add<Neural::DropoutLayer>(layer_size, dropout_probability);
+        inputs_count = layer_size;
+    }
+    const size_t outputs_count = m_network.get().GetOutputsCount();
+    regularized_network.Add<Neural::DenseLayer>(inputs_count, outputs_count);
+    if (m_network.get().GetLoss() == Neural::Loss::CrossEntropy)
+        regularized_network.Add<Neural::SoftmaxLayer>(outputs_count);
+    else
+        regularized_network.Add<Neural::ActivationLayer>(outputs_count, m_network.get().GetActivation());
+    regularized_network.Randomize(0);
+    regularized_network.SetInstructionSet(m_network.get().GetInstructionSet());
+    auto workspace = regularized_network.CreateWorkspace();
+    for (int epoch = 0; epoch != epochs_count; ++epoch)
+        for (const auto& record : m_dataset_records)
+            regularized_network.Learn(record.inputs, record.outputs, m_learning_rate, workspace);
+    regularized_network.ComputeOutputBatch(inputs.View(), outputs.View(), workspace);
+    report.regularized_accuracy = MeasureAccuracy(outputs.View(), targets.View());
+    return report;
+}
+
+NetworkEditor::FixedNetworkReport NetworkEditor::RunFixedNetworkReport() const {
+    const DigitsNetwork fixed_network(m_network);
+    auto workspace = m_network.get().CreateWorkspace();
+    std::vector<float> outputs(m_network.get().GetOutputsCount());
+    std::vector<float> fixed_outputs(outputs.size());
+
+    FixedNetworkReport report;
+    report.max_difference = 0;
+    for (const auto& record : m_dataset_records) {
+        m_network.get().ComputeOutput(record.inputs, workspace, outputs);
+        fixed_network.ComputeOutput(record.inputs, fixed_outputs);
+        for (size_t output_index = 0; output_index != outputs.size(); ++output_index)
+            report.max_difference =
+                std::max(report.max_difference, std::abs(outputs[output_index] - fixed_outputs[output_index]));
+    }
+
+    report.seconds_per_sample = MeasureSecondsPerSample(m_dataset_records, [&](const std::vector<float>& inputs) {
+        m_network.get().ComputeOutput(inputs, workspace, outputs);
+    });
+    report.fixed_seconds_per_sample = MeasureSecondsPerSample(m_dataset_records, [&](const std::vector<float>& inputs) {
+        fixed_network.ComputeOutput(inputs, fixed_outputs);
+    });
+    return report;
+}
+
+void NetworkEditor::BuildDatasetMatrices(Neural::Matrix<float>& inputs, Neural::Matrix<float>& outputs) const {
+    inputs = Neural::Matrix<float>(m_dataset_records.size(), m_network.get().GetInputsCount());
+    outputs = Neural::Matrix<float>(m_dataset_records.size(), m_network.get().GetOutputsCount());
+    for (size_t record_index = 0; record_index != m_dataset_records.size(); ++record_index) {
+        const auto& record = m_dataset_records[record_index];
+        std::copy(record.inputs.begin(), record.inputs.end(), inputs.Row(record_index));
+        std::copy(record.outputs.begin(), record.outputs.end(), outputs.Row(record_index));
+    }
+}
+
+bool NetworkEditor::LoadModel(const std::string& path) {
+    auto network = Neural::Network::LoadFromFile(path);
+    if (!network || network->GetInputsCount() != m_network.get().GetInputsCount() ||
+        network->GetOutputsCount() != m_network.get().GetOutputsCount())
+        return false;
+
+    network->SetInstructionSet(m_network.get().GetInstructionSet());
+    network->SetActivation(m_network.get().GetActivation());
+    network->SetOptimizer(m_network.get().GetOptimizer());
+    network->SetSparseInputs(m_network.get().GetSparseInputs());
+    m_network.get() = std::move(*network);
+    Rebind(m_network.get());
+    m_network_changed.Invoke();
+    return true;
+}
+
+bool NetworkEditor::SaveModel(const std::string& path) const {
+    return m_network.get().DumpToFile(path);
 }
 
 bool NetworkEditor::LoadLearningExamples(const std::string& path) {
@@ -159,8 +767,8 @@ bool NetworkEditor::LoadLearningExamples(const std::string& path) {
     if (!input_stream.is_open())
         return false;
 
-    std::vector<double> inputs(m_network.get().GetInputsCount());
-    std::vector<double> outputs(m_network.get().GetOutputsCount());
+    std::vector<float> inputs(m_network.get().GetInputsCount());
+    std::vector<float> outputs(m_network.get().GetOutputsCount());
 
     for (;;) {
         for (auto& input : inputs) {
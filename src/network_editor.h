@@ -1,10 +1,14 @@
 #pragma once
 
 #include <functional>
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
+#include "event.h"
 #include <neural/network.h>
+#include <neural/trainer.h>
 
 class NetworkEditor {
 public:
@@ -28,26 +32,152 @@ public:
         m_dataset_records.emplace_back(inputs, outputs);
     }
 
+    // Replace the network with a model file of the same number of inputs and outputs.
+    bool LoadModel(const std::string&);
+    bool SaveModel(const std::string&) const;
+
+    // Raised when the network is replaced by a loaded model, its hidden layers may have changed.
+    Event<>& NetworkChanged() { return m_network_changed; }
+
     bool LoadLearningExamples(const std::string&);
     bool SaveLearningExamples(const std::string&) const;
 
+    // Fraction of dataset records whose strongest output matches the strongest target output.
+    float EvaluateAccuracy() const;
+
 private:
     struct Record {
-        std::vector<double> inputs;
-        std::vector<double> outputs;
+        std::vector<float> inputs;
+        std::vector<float> outputs;
 
         template <typename IT, typename OT>
         Record(const std::vector<IT>& input_values, const std::vector<OT>& output_values)
             : inputs(input_values.begin(), input_values.end()), outputs(output_values.begin(), output_values.end()) {}
     };
 
+    // Same number of per-sample learning epochs run on copies of the network, serially and asynchronously.
+    struct LearningBenchmark {
+        size_t threads_count;
+        float initial_loss;
+        float serial_loss;
+        float async_loss;
+        double serial_seconds;
+        double async_seconds;
+    };
+
+    // Per-sample inference over the dataset with the network and with a FixedNetwork copy of it.
+    struct FixedNetworkReport {
+        double seconds_per_sample;
+        double fixed_seconds_per_sample;
+        float max_difference;
+    };
+
+    // Speed of the batched matrix kernels of the network's instruction set for one layer shape.
+    struct KernelBenchmark {
+        size_t samples_count;
+        size_t rows;
+        size_t columns;
+        Neural::Kernels::Throughput throughput;
+    };
+
+    // The network quantized with the dataset as calibration samples, compared to the original on the same dataset.
+    struct QuantizationReport {
+        float accuracy;
+        float quantized_accuracy;
+        size_t parameters_size;
+        size_t quantized_parameters_size;
+        double seconds;
+        double quantized_seconds;
+    };
+
+    // The network with the given fraction of its weights pruned and the rest fine-tuned on the dataset, compared to
+    // the original on the same dataset when run as a PrunedNetwork.
+    struct PruningReport {
+        float sparsity;
+        float accuracy;
+        float pruned_accuracy;
+        size_t parameters_size;
+        size_t pruned_parameters_size;
+        double seconds;
+        double pruned_seconds;
+        // The pruned network itself, to replace the edited one if it is good enough.
+        std::unique_ptr<Neural::Network> network;
+    };
+
+    // A convolutional network trained from scratch on the dataset glyphs, compared to the network on the same dataset.
+    struct ConvolutionReport {
+        float accuracy;
+        float convolutional_accuracy;
+        size_t parameters_size;
+        size_t convolutional_parameters_size;
+        double seconds_per_sample;
+        double direct_seconds_per_sample;
+        double im2col_seconds_per_sample;
+    };
+
+    // A single-layer network trained on the dataset as the first stage of a cascade in front of the network, with the
+    // threshold calibrated on the same dataset, compared to the network alone.
+    struct CascadeReport {
+        float threshold;
+        // Fraction of the records answered by the first stage.
+        float exit_rate;
+        float accuracy;
+        float first_stage_accuracy;
+        float cascade_accuracy;
+        double seconds_per_sample;
+        double first_stage_seconds_per_sample;
+        double cascade_seconds_per_sample;
+    };
+
+    // The network run as a SequentialNetwork of dense and activation layers, and one of the same sizes with
+    // normalization and dropout in its hidden layers trained from scratch on the dataset, compared to the network.
+    struct LayersReport {
+        float max_difference;
+        float accuracy;
+        float regularized_accuracy;
+        double seconds;
+        double sequential_seconds;
+    };
+
     std::reference_wrapper<Neural::Network> m_network;
     bool m_learn_continuously;
     float m_learning_rate;
-    std::vector<double> m_network_inputs;
+    int m_batch_size;
+    int m_threads_count;
+    bool m_learn_asynchronously;
+    std::unique_ptr<Neural::ParallelTrainer<float>> m_trainer;
+    std::unique_ptr<Neural::AsyncTrainer<float>> m_async_trainer;
+    Neural::Workspace m_workspace;
+    std::vector<float> m_network_inputs;
     std::vector<Record> m_dataset_records;
+    std::optional<float> m_dataset_accuracy;
+    // Activation error of the current network's kernels, measured when the activation is chosen.
+    std::optional<double> m_activation_error;
+    std::optional<LearningBenchmark> m_learning_benchmark;
+    std::optional<QuantizationReport> m_quantization_report;
+    float m_pruning_sparsity;
+    int m_pruning_epochs;
+    std::optional<PruningReport> m_pruning_report;
+    std::optional<ConvolutionReport> m_convolution_report;
+    std::optional<CascadeReport> m_cascade_report;
+    std::optional<LayersReport> m_layers_report;
+    std::vector<KernelBenchmark> m_kernel_benchmarks;
+    std::optional<FixedNetworkReport> m_fixed_network_report;
     std::string m_model_save_path;
     std::string m_dataset_save_path;
     bool m_wants_write;
     bool m_wants_model;
+    Event<> m_network_changed;
+
+    // Pack the dataset records into (records x inputs) and (records x outputs) matrices.
+    void BuildDatasetMatrices(Neural::Matrix<float>&, Neural::Matrix<float>&) const;
+
+    LearningBenchmark RunLearningBenchmark() const;
+    QuantizationReport RunQuantizationReport() const;
+    PruningReport RunPruningReport() const;
+    ConvolutionReport RunConvolutionReport() const;
+    CascadeReport RunCascadeReport() const;
+    LayersReport RunLayersReport() const;
+    std::vector<KernelBenchmark> RunKernelBenchmarks() const;
+    FixedNetworkReport RunFixedNetworkReport() const;
 };
@@ -0,0 +1,138 @@
+#pragma once
+
+// Approximations of tanh and exp, shared by the scalar and the vectorized kernels.
+// They are written against the register traits of kernels_simd.h, which additionally have to provide
+// Add, Mul, Div, Min, Max and PowerOfTwo, so that every instruction set evaluates the very same formulas.
+// ScalarOps<T> wraps plain numbers into the same interface, used by the reference kernels and the vector loop tails.
+//
+// Everything lives in an anonymous namespace for the reasons explained in kernels_simd.h.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <math.h>
+
+namespace Neural {
+namespace Kernels {
+namespace {
+
+template <typename T>
+struct ScalarOps {
+    using Scalar = T;
+    using Register = T;
+    static constexpr size_t width = 1;
+
+    static inline Register Set(Scalar x) { return x; }
+    static inline Register Add(Register a, Register b) { return a + b; }
+    static inline Register Mul(Register a, Register b) { return a * b; }
+    static inline Register MulAdd(Register a, Register b, Register c) { return a * b + c; }
+    static inline Register Div(Register a, Register b) { return a / b; }
+    static inline Register Min(Register a, Register b) { return b < a ? b : a; }
+    static inline Register Max(Register a, Register b) { return a < b ? b : a; }
+    // The C library functions rather than std::sqrt, which is an inline function shared with other translation units.
+    static inline float Sqrt(float x) { return ::sqrtf(x); }
+    static inline double Sqrt(double x) { return ::sqrt(x); }
+    // 2^k for an integral k within the range of normal numbers, by writing the exponent bits.
+    static inline float PowerOfTwo(float k) {
+        const std::uint32_t bits = static_cast<std::uint32_t>(static_cast<std::int32_t>(k) + 127) << 23;
+        float result;
+        std::memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+    static inline double PowerOfTwo(double k) {
+        const std::uint64_t bits = static_cast<std::uint64_t>(static_cast<std::int64_t>(k) + 1023) << 52;
+        double result;
+        std::memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+};
+
+// [3/2] Padé approximant x * (27 + x^2) / (27 + 9 * x^2), clamped at |x| = 3 where it reaches exactly 1.
+// Absolute error is below 0.025, one division and three multiplications.
+template <typename V>
+inline typename V::Register FastTanh(typename V::Register x) {
+    using R = typename V::Register;
+    x = V::Min(V::Max(x, V::Set(-3)), V::Set(3));
+    const R x2 = V::Mul(x, x);
+    return V::Div(V::Mul(x, V::Add(x2, V::Set(27))), V::MulAdd(x2, V::Set(9), V::Set(27)));
+}
+
+// [13/6] minimax rational approximation, clamped at |x| = 7.9 where it rounds to 1 in single precision.
+// Absolute error is below 4e-7 in single precision, a few units in the last place, and 3e-7 in double.
+template <typename V>
+inline typename V::Register PreciseTanh(typename V::Register x) {
+    using R = typename V::Register;
+    using T = typename V::Scalar;
+    x = V::Min(V::Max(x, V::Set(T(-7.90531110763549805))), V::Set(T(7.90531110763549805)));
+    const R x2 = V::Mul(x, x);
+
+    R p = V::Set(T(-2.76076847742355e-16));
+    p = V::MulAdd(p, x2, V::Set(T(2.00018790482477e-13)));
+    p = V::MulAdd(p, x2, V::Set(T(-8.60467152213735e-11)));
+    p = V::MulAdd(p, x2, V::Set(T(5.12229709037114e-08)));
+    p = V::MulAdd(p, x2, V::Set(T(1.48572235717979e-05)));
+    p = V::MulAdd(p, x2, V::Set(T(6.37261928875436e-04)));
+    p = V::MulAdd(p, x2, V::Set(T(4.89352455891786e-03)));
+    p = V::Mul(p, x);
+
+    R q = V::Set(T(1.19825839466702e-06));
+    q = V::MulAdd(q, x2, V::Set(T(1.18534705686654e-04)));
+    q = V::MulAdd(q, x2, V::Set(T(2.26843463243900e-03)));
+    q = V::MulAdd(q, x2, V::Set(T(4.89352518554385e-03)));
+
+    return V::Div(p, q);
+}
+
+template <typename T>
+struct ExpConstants;
+
+// Taylor coefficients 1/n! from the highest degree down. Over |r| <= ln(2) / 2 the truncation error of degree 7 is
+// below 6e-9 relative, and that of degree 13 below 5e-18, both well under half a unit in the last place.
+template <>
+struct ExpConstants<float> {
+    static constexpr float lowest = -87.3f;
+    static constexpr float highest = 88.0f;
+    static constexpr float round = 12582912.0f;
+    static constexpr float ln2_high = 0.693359375f;
+    static constexpr float ln2_low = -2.12194440e-4f;
+    static constexpr float coefficients[] = {1.0f / 5040, 1.0f / 720, 1.0f / 120, 1.0f / 24, 1.0f / 6, 0.5f, 1, 1};
+};
+
+template <>
+struct ExpConstants<double> {
+    static constexpr double lowest = -708.0;
+    static constexpr double highest = 709.0;
+    static constexpr double round = 6755399441055744.0;
+    static constexpr double ln2_high = 6.93147180369123816490e-01;
+    static constexpr double ln2_low = 1.90821492927058770002e-10;
+    static constexpr double coefficients[] = {
+        1.0 / 6227020800, 1.0 / 479001600, 1.0 / 39916800, 1.0 / 3628800, 1.0 / 362880, 1.0 / 40320, 1.0 / 5040,
+        1.0 / 720,        1.0 / 120,        1.0 / 24,       1.0 / 6,       0.5,          1,           1,
+    };
+};
+
+// exp(x) = 2^k * exp(r) with k = round(x / ln(2)) and r = x - k * ln(2), |r| <= ln(2) / 2, where exp(r) is a Taylor
+// polynomial. ln(2) is split in two so that k * ln(2) is subtracted without rounding, and adding 1.5 * 2^23 (2^52
+// for doubles) rounds to an integer without a dedicated instruction. Relative error is below 2 units in the last
+// place, 1.2e-7 for floats and 2.3e-16 for doubles, over the whole range. The input is clamped to where 2^k is a
+// normal number: below about -87 for floats and -708 for doubles the result is that of the bound, under 1e-38 and
+// 1e-307, instead of going down to zero.
+template <typename V>
+inline typename V::Register Exp(typename V::Register x) {
+    using R = typename V::Register;
+    using T = typename V::Scalar;
+    using C = ExpConstants<T>;
+    x = V::Min(V::Max(x, V::Set(C::lowest)), V::Set(C::highest));
+    const R k = V::Add(V::MulAdd(x, V::Set(T(1.44269504088896340736)), V::Set(C::round)), V::Set(-C::round));
+    R r = V::MulAdd(k, V::Set(-C::ln2_high), x);
+    r = V::MulAdd(k, V::Set(-C::ln2_low), r);
+
+    R p = V::Set(C::coefficients[0]);
+    for (size_t index = 1; index != sizeof(C::coefficients) / sizeof(C::coefficients[0]); ++index)
+        p = V::MulAdd(p, r, V::Set(C::coefficients[index]));
+    return V::Mul(p, V::PowerOfTwo(k));
+}
+
+} // namespace
+} // namespace Kernels
+} // namespace Neural
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace Neural {
+
+// Brain floating point: the upper half of an IEEE 754 single precision float.
+// Only meant as a compact storage format for inference, all arithmetic is done after widening to float.
+struct BFloat16 {
+    std::uint16_t bits;
+
+    BFloat16() = default;
+
+    // Rounds to nearest even, NaNs are not given any special treatment.
+    explicit BFloat16(float value) {
+        std::uint32_t value_bits;
+        std::memcpy(&value_bits, &value, sizeof(value_bits));
+        value_bits += 0x7fff + ((value_bits >> 16) & 1);
+        bits = static_cast<std::uint16_t>(value_bits >> 16);
+    }
+
+    explicit operator float() const {
+        std::uint32_t value_bits = static_cast<std::uint32_t>(bits) << 16;
+        float value;
+        std::memcpy(&value, &value_bits, sizeof(value));
+        return value;
+    }
+};
+
+} // namespace Neural
@@ -0,0 +1,87 @@
+#include "cascade_network.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace Neural {
+
+namespace {
+
+bool IsCorrect(const float* outputs, const float* targets, size_t count) {
+    return std::max_element(outputs, outputs + count) - outputs == std::max_element(targets, targets + count) - targets;
+}
+
+} // namespace
+
+CascadeNetwork::CascadeNetwork(Network first, Network second)
+    : m_first(std::move(first)), m_second(std::move(second)), m_threshold(std::numeric_limits<float>::infinity()) {
+    assert(m_first.GetInputsCount() == m_second.GetInputsCount());
+    assert(m_first.GetOutputsCount() == m_second.GetOutputsCount());
+}
+
+CascadeNetwork::~CascadeNetwork() {}
+
+CascadeNetwork::Workspace CascadeNetwork::CreateWorkspace() const {
+    return {m_first.CreateWorkspace(), m_second.CreateWorkspace()};
+}
+
+size_t CascadeNetwork::ComputeOutput(Span<const float> inputs, Workspace& workspace, Span<float> outputs) const {
+    m_first.ComputeOutput(inputs, workspace.first, outputs);
+    if (GetConfidence(outputs) >= m_threshold)
+        return 0;
+    m_second.ComputeOutput(inputs, workspace.second, outputs);
+    return 1;
+}
+
+void CascadeNetwork::Calibrate(MatrixView<const float> inputs, MatrixView<const float> targets) {
+    assert(inputs.Columns() == GetInputsCount());
+    assert(targets.Columns() == GetOutputsCount());
+    assert(inputs.Rows() == targets.Rows());
+
+    const size_t samples_count = inputs.Rows();
+    const size_t outputs_count = GetOutputsCount();
+    Matrix<float> first_outputs(samples_count, outputs_count);
+    Matrix<float> second_outputs(samples_count, outputs_count);
+    m_first.ComputeOutputBatch(inputs, first_outputs.View());
+    m_second.ComputeOutputBatch(inputs, second_outputs.View());
+
+    // Per sample, the confidence of the first stage and how many more samples are correct when it answers this one.
+    struct Sample {
+        float confidence;
+        int gain;
+    };
+    std::vector<Sample> samples(samples_count);
+    for (size_t sample_index = 0; sample_index != samples_count; ++sample_index) {
+        const float* sample_targets = targets.Row(sample_index);
+        samples[sample_index].confidence = GetConfidence({first_outputs.Row(sample_index), outputs_count});
+        samples[sample_index].gain = static_cast<int>(IsCorrect(first_outputs.Row(sample_index), sample_targets,
+                                                                outputs_count)) -
+                                     static_cast<int>(IsCorrect(second_outputs.Row(sample_index), sample_targets,
+                                                                outputs_count));
+    }
+    std::sort(samples.begin(), samples.end(),
+              [](const Sample& a, const Sample& b) { return a.confidence > b.confidence; });
+
+    // Lower the threshold one sample at a time, the most confident first. Samples of equal confidence exit together.
+    m_threshold = std::numeric_limits<float>::infinity();
+    int gain = 0;
+    for (size_t index = 0; index != samples_count; ++index) {
+        gain += samples[index].gain;
+        if (index + 1 != samples_count && samples[index + 1].confidence == samples[index].confidence)
+            continue;
+        if (gain >= 0)
+            m_threshold = samples[index].confidence;
+    }
+}
+
+float CascadeNetwork::GetConfidence(Span<const float> outputs) {
+    float sum = 0;
+    for (float output : outputs)
+        sum += output;
+    return sum > 0 ? *std::max_element(outputs.begin(), outputs.end()) / sum : 0;
+}
+
+} // namespace Neural
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+
+#include "matrix.h"
+#include "network.h"
+#include "span.h"
+
+namespace Neural {
+
+// Two networks with the same inputs and outputs, a small one and a large one. The small first stage answers alone
+// when it is confident enough, and the large second stage only computes the samples it is not confident about. Most
+// glyphs are easy, so the average cost gets close to that of the first stage while the hard ones still get the second.
+// The confidence is the strongest output divided by the sum of all of them, the top probability for the cross-entropy
+// loss, whose softmax outputs suit the cascade best.
+class CascadeNetwork {
+public:
+    struct Workspace {
+        Neural::Workspace first;
+        Neural::Workspace second;
+    };
+
+    // Until calibrated, every sample goes through both stages.
+    CascadeNetwork(Network, Network);
+    ~CascadeNetwork();
+
+    Workspace CreateWorkspace() const;
+
+    // Write the outputs of the stage that answered, and return its index: 0 for the first stage, 1 for the second.
+    size_t ComputeOutput(Span<const float>, Workspace&, Span<float>) const;
+
+    // Choose the lowest threshold at which the cascade is as accurate on the given samples, one per row, as the second
+    // stage alone. A sample is classified correctly when its strongest output matches the strongest target.
+    void Calibrate(MatrixView<const float>, MatrixView<const float>);
+
+    inline const Network& GetFirstStage() const { return m_first; }
+    inline const Network& GetSecondStage() const { return m_second; }
+    inline size_t GetInputsCount() const { return m_first.GetInputsCount(); }
+    inline size_t GetOutputsCount() const { return m_first.GetOutputsCount(); }
+
+    // The first stage answers when its confidence reaches the threshold. Above 1 it never does.
+    inline void SetThreshold(float threshold) { m_threshold = threshold; }
+    inline float GetThreshold() const { return m_threshold; }
+
+    static float GetConfidence(Span<const float>);
+
+private:
+    Network m_first;
+    Network m_second;
+    float m_threshold;
+};
+
+} // namespace Neural
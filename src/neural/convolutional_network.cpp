@@ -0,0 +1,454 @@
+#include "convolutional_network.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include <util/random.h>
+
+namespace Neural {
+
+namespace {
+
+float ActivationDerivativeFromValue(float y) {
+    return 2 * y * (1 - y);
+}
+
+} // namespace
+
+ConvolutionalNetwork::ConvolutionalNetwork(FeatureShape input_shape, const std::vector<LayerDescription>& layers)
+    : m_layers(), m_kernels(&Kernels::GetTable<float>()), m_algorithm(ConvolutionAlgorithm::Direct),
+      m_activation(Kernels::Activation::Precise) {
+    assert(!layers.empty());
+    assert(input_shape.Size() != 0);
+
+    m_layers.reserve(layers.size());
+    FeatureShape shape = input_shape;
+    for (const auto& description : layers) {
+        auto& layer = m_layers.emplace_back();
+        layer.type = description.type;
+        layer.size = description.size;
+        layer.input_shape = shape;
+        switch (description.type) {
+        case LayerType::Convolution:
+            assert(description.size % 2 == 1 && description.channels != 0);
+            layer.output_shape = {shape.height, shape.width, description.channels};
+            layer.weights = Matrix<float>(description.channels, description.size * description.size * shape.channels);
+            layer.weight_columns = Matrix<float>(layer.weights.Columns(), layer.weights.Rows());
+            layer.biases.resize(description.channels);
+            break;
+        case LayerType::MaxPooling:
+        case LayerType::AveragePooling:
+            // The last rows and columns are left out if the windows do not cover the feature map exactly.
+            assert(description.size != 0 && description.size <= shape.height && description.size <= shape.width);
+            layer.output_shape = {shape.height / description.size, shape.width / description.size, shape.channels};
+            break;
+        case LayerType::Dense:
+            assert(description.channels != 0);
+            layer.output_shape = {1, 1, description.channels};
+            layer.weights = Matrix<float>(description.channels, shape.Size());
+            layer.biases.resize(description.channels);
+            break;
+        }
+        shape = layer.output_shape;
+    }
+}
+
+ConvolutionalNetwork::~ConvolutionalNetwork() {}
+
+void ConvolutionalNetwork::Randomize(std::uint64_t seed) {
+    Random::Prng<> rng(seed);
+    for (auto& layer : m_layers) {
+        if (layer.weights.Rows() == 0)
+            continue;
+        // Scaled by the number of inputs of a neuron, otherwise the sums over large kernels and feature maps start out
+        // deep in the saturated range of the activation function, where it learns nothing.
+        const float range = std::sqrt(3.0f / layer.weights.Columns());
+        for (size_t neuron_index = 0; neuron_index != layer.weights.Rows(); ++neuron_index)
+            for (size_t input_index = 0; input_index != layer.weights.Columns(); ++input_index)
+                layer.weights(neuron_index, input_index) = rng.NextFloat<float>(-range, range);
+        for (auto& bias : layer.biases)
+            bias = rng.NextFloat<float>(-range, range);
+        if (layer.type == LayerType::Convolution)
+            SyncWeightColumns(layer, true);
+    }
+}
+
+ConvolutionalNetwork::Workspace ConvolutionalNetwork::CreateWorkspace() const {
+    Workspace workspace;
+    size_t max_size = GetInputsCount();
+    size_t max_positions = 0;
+    size_t max_kernel_inputs = 0;
+    size_t max_channels = 0;
+    workspace.outputs.reserve(m_layers.size());
+    for (const auto& layer : m_layers) {
+        workspace.outputs.emplace_back(layer.output_shape.Size());
+        max_size = std::max(max_size, layer.output_shape.Size());
+        if (layer.type == LayerType::Convolution) {
+            max_positions = std::max(max_positions, layer.output_shape.height * layer.output_shape.width);
+            max_kernel_inputs = std::max(max_kernel_inputs, layer.weights.Columns());
+            max_channels = std::max(max_channels, layer.output_shape.channels);
+        }
+    }
+    workspace.errors.resize(max_size);
+    workspace.next_errors.resize(max_size);
+    workspace.scales.resize(max_size);
+    if (max_positions != 0) {
+        workspace.patches = Matrix<float>(max_positions, max_kernel_inputs);
+        workspace.patch_errors = Matrix<float>(max_positions, max_kernel_inputs);
+        workspace.gradients = Matrix<float>(max_channels, max_kernel_inputs);
+        workspace.channel_outputs = Matrix<float>(max_channels, max_positions);
+        workspace.zero_biases.resize(max_positions);
+        workspace.active_inputs.reserve(max_kernel_inputs);
+        workspace.active_values.reserve(max_kernel_inputs);
+    }
+    return workspace;
+}
+
+size_t ConvolutionalNetwork::GetParametersCount() const {
+    size_t count = 0;
+    for (const auto& layer : m_layers)
+        count += layer.weights.Rows() * layer.weights.Columns() + layer.biases.size();
+    return count;
+}
+
+void ConvolutionalNetwork::SetInstructionSet(Kernels::InstructionSet instruction_set) {
+    m_kernels = &Kernels::GetTable<float>(instruction_set);
+}
+
+void ConvolutionalNetwork::ComputeOutput(Span<const float> inputs, Workspace& workspace, Span<float> outputs) const {
+    assert(workspace.outputs.size() == m_layers.size());
+    assert(inputs.Size() == GetInputsCount());
+    assert(outputs.Size() == GetOutputsCount());
+
+    ComputeLayers(inputs.Data(), outputs.Data(), workspace);
+}
+
+void ConvolutionalNetwork::ComputeOutputBatch(MatrixView<const float> inputs, MatrixView<float> outputs,
+                                              Workspace& workspace) const {
+    assert(workspace.outputs.size() == m_layers.size());
+    assert(inputs.Columns() == GetInputsCount());
+    assert(outputs.Columns() == GetOutputsCount());
+    assert(inputs.Rows() == outputs.Rows());
+
+    for (size_t sample_index = 0; sample_index != inputs.Rows(); ++sample_index)
+        ComputeLayers(inputs.Row(sample_index), outputs.Row(sample_index), workspace);
+}
+
+void ConvolutionalNetwork::ComputeLayers(const float* inputs, float* outputs, Workspace& workspace) const {
+    const float* layer_inputs = inputs;
+    for (size_t layer_index = 0; layer_index != m_layers.size(); ++layer_index) {
+        const auto& layer = m_layers[layer_index];
+        // The last layer writes straight into the destination.
+        float* layer_outputs = layer_index + 1 != m_layers.size() ? workspace.outputs[layer_index].data() : outputs;
+        switch (layer.type) {
+        case LayerType::Convolution:
+            ComputeConvolution(layer, layer_inputs, layer_outputs, workspace);
+            break;
+        case LayerType::MaxPooling:
+        case LayerType::AveragePooling:
+            ComputePooling(layer, layer_inputs, layer_outputs);
+            break;
+        case LayerType::Dense:
+            m_kernels->dense(layer.weights.Data(), layer.weights.Stride(), layer.weights.Rows(),
+                             layer.weights.Columns(), layer_inputs, layer.biases.data(), layer_outputs);
+            Activate(layer_outputs, layer.weights.Rows());
+            break;
+        }
+        layer_inputs = layer_outputs;
+    }
+}
+
+void ConvolutionalNetwork::ComputeConvolution(const Layer& layer, const float* inputs, float* outputs,
+                                              Workspace& workspace) const {
+    const auto& shape = layer.output_shape;
+    const size_t positions_count = shape.height * shape.width;
+    const size_t kernel_inputs_count = layer.weights.Columns();
+
+    if (m_algorithm == ConvolutionAlgorithm::Im2col) {
+        const MatrixView<float> patches(workspace.patches.Data(), positions_count, kernel_inputs_count,
+                                        workspace.patches.Stride());
+        const MatrixView<float> channel_outputs(workspace.channel_outputs.Data(), shape.channels, positions_count,
+                                                workspace.channel_outputs.Stride());
+        FillPatches(layer, inputs, patches);
+        // Every output channel is a sample of a dense layer with a neuron per position, so that the matrix kernels
+        // block over the many positions rather than over the few channels, then the channels are interleaved back.
+        m_kernels->dense_batch(patches.Data(), patches.Stride(), positions_count, kernel_inputs_count,
+                               layer.weights.Data(), layer.weights.Stride(), shape.channels,
+                               workspace.zero_biases.data(), channel_outputs.Data(), channel_outputs.Stride());
+        for (size_t position = 0; position != positions_count; ++position) {
+            float* pixel_outputs = outputs + position * shape.channels;
+            for (size_t channel = 0; channel != shape.channels; ++channel)
+                pixel_outputs[channel] = channel_outputs(channel, position) + layer.biases[channel];
+        }
+    } else {
+        for (size_t y = 0; y != shape.height; ++y) {
+            for (size_t x = 0; x != shape.width; ++x) {
+                CollectPatch(layer, inputs, y, x, workspace);
+                m_kernels->sparse_dense(layer.weight_columns.Data(), layer.weight_columns.Stride(), shape.channels,
+                                        workspace.active_inputs.data(), workspace.active_values.data(),
+                                        workspace.active_inputs.size(), layer.biases.data(),
+                                        outputs + (y * shape.width + x) * shape.channels);
+            }
+        }
+    }
+    Activate(outputs, shape.Size());
+}
+
+void ConvolutionalNetwork::ComputePooling(const Layer& layer, const float* inputs, float* outputs) const {
+    const auto& input_shape = layer.input_shape;
+    const auto& shape = layer.output_shape;
+    const size_t channels = shape.channels;
+    const float scale = 1.0f / static_cast<float>(layer.size * layer.size);
+
+    for (size_t y = 0; y != shape.height; ++y) {
+        for (size_t x = 0; x != shape.width; ++x) {
+            float* pixel_outputs = outputs + (y * shape.width + x) * channels;
+            if (layer.type == LayerType::AveragePooling)
+                std::fill_n(pixel_outputs, channels, 0.0f);
+            for (size_t window_y = 0; window_y != layer.size; ++window_y) {
+                for (size_t window_x = 0; window_x != layer.size; ++window_x) {
+                    const float* pixel_inputs =
+                        inputs + ((y * layer.size + window_y) * input_shape.width + x * layer.size + window_x) *
+                                     channels;
+                    if (layer.type == LayerType::AveragePooling)
+                        m_kernels->update(pixel_outputs, 0, 1, channels, pixel_inputs, 0, scale);
+                    else if (window_y == 0 && window_x == 0)
+                        std::copy_n(pixel_inputs, channels, pixel_outputs);
+                    else
+                        m_kernels->maximum(pixel_outputs, pixel_inputs, channels);
+                }
+            }
+        }
+    }
+}
+
+void ConvolutionalNetwork::Learn(Span<const float> inputs, Span<const float> target_outputs, float rate,
+                                 Workspace& workspace) {
+    assert(rate > 0 && rate <= 1);
+    assert(workspace.outputs.size() == m_layers.size());
+    assert(inputs.Size() == GetInputsCount());
+    assert(target_outputs.Size() == GetOutputsCount());
+
+    const auto& outputs = workspace.outputs;
+    ComputeLayers(inputs.Data(), workspace.outputs.back().data(), workspace);
+
+    auto& error_buffer = workspace.errors;
+    auto& next_error_buffer = workspace.next_errors;
+    auto& scale_buffer = workspace.scales;
+    for (size_t output_index = 0; output_index != target_outputs.Size(); ++output_index)
+        error_buffer[output_index] = target_outputs[output_index] - outputs.back()[output_index];
+
+    // Unlike in Network, the errors are propagated through the derivative of the activation function.
+    for (size_t layer_index = m_layers.size(); layer_index-- != 0;) {
+        auto& layer = m_layers[layer_index];
+        const float* layer_inputs = layer_index != 0 ? outputs[layer_index - 1].data() : inputs.Data();
+        const float* layer_outputs = outputs[layer_index].data();
+        // There is no need for the errors of the network's inputs.
+        float* input_errors = layer_index != 0 ? next_error_buffer.data() : nullptr;
+        if (input_errors)
+            std::fill_n(input_errors, layer.input_shape.Size(), 0.0f);
+
+        switch (layer.type) {
+        case LayerType::Convolution:
+            LearnConvolution(layer, layer_inputs, layer_outputs, error_buffer.data(), input_errors, rate, workspace);
+            break;
+        case LayerType::MaxPooling:
+        case LayerType::AveragePooling:
+            if (input_errors)
+                LearnPooling(layer, layer_inputs, layer_outputs, error_buffer.data(), input_errors);
+            break;
+        case LayerType::Dense:
+            for (size_t neuron_index = 0; neuron_index != layer.weights.Rows(); ++neuron_index) {
+                error_buffer[neuron_index] *= ActivationDerivativeFromValue(layer_outputs[neuron_index]);
+                scale_buffer[neuron_index] = rate * error_buffer[neuron_index];
+                layer.biases[neuron_index] += scale_buffer[neuron_index];
+            }
+            m_kernels->backward(layer.weights.Data(), layer.weights.Stride(), layer.weights.Rows(),
+                                layer.weights.Columns(), error_buffer.data(), scale_buffer.data(), layer_inputs,
+                                input_errors);
+            break;
+        }
+        error_buffer.swap(next_error_buffer);
+    }
+}
+
+void ConvolutionalNetwork::LearnConvolution(Layer& layer, const float* inputs, const float* outputs, float* errors,
+                                            float* input_errors, float rate, Workspace& workspace) {
+    const auto& input_shape = layer.input_shape;
+    const auto& shape = layer.output_shape;
+    const size_t positions_count = shape.height * shape.width;
+    const size_t kernel_inputs_count = layer.weights.Columns();
+    const size_t radius = layer.size / 2;
+
+    for (size_t index = 0; index != shape.Size(); ++index)
+        errors[index] *= ActivationDerivativeFromValue(outputs[index]);
+
+    if (input_errors) {
+        // The errors of the inputs under the kernel at every position, added to the inputs they were taken from.
+        const MatrixView<float> patch_errors(workspace.patch_errors.Data(), positions_count, kernel_inputs_count,
+                                             workspace.patch_errors.Stride());
+        for (size_t position = 0; position != positions_count; ++position)
+            std::fill_n(patch_errors.Row(position), kernel_inputs_count, 0.0f);
+        m_kernels->backward_batch(layer.weights.Data(), layer.weights.Stride(), shape.channels, kernel_inputs_count,
+                                  errors, shape.channels, positions_count, patch_errors.Data(), patch_errors.Stride());
+        for (size_t y = 0; y != shape.height; ++y) {
+            for (size_t x = 0; x != shape.width; ++x) {
+                const float* patch = patch_errors.Row(y * shape.width + x);
+                for (size_t kernel_y = 0; kernel_y != layer.size; ++kernel_y) {
+                    // Positions above and left of the feature map wrap around to large values.
+                    const size_t input_y = y + kernel_y - radius;
+                    for (size_t kernel_x = 0; kernel_x != layer.size; ++kernel_x) {
+                        const size_t input_x = x + kernel_x - radius;
+                        if (input_y < input_shape.height && input_x < input_shape.width)
+                            m_kernels->update(input_errors + (input_y * input_shape.width + input_x) *
+                                                                 input_shape.channels,
+                                              0, 1, input_shape.channels,
+                                              patch + (kernel_y * layer.size + kernel_x) * input_shape.channels, 0, 1);
+                    }
+                }
+            }
+        }
+    }
+
+    for (size_t index = 0; index != shape.Size(); ++index)
+        errors[index] *= rate;
+    for (size_t position = 0; position != positions_count; ++position)
+        for (size_t channel = 0; channel != shape.channels; ++channel)
+            layer.biases[channel] += errors[position * shape.channels + channel];
+
+    if (m_algorithm == ConvolutionAlgorithm::Im2col) {
+        const MatrixView<float> patches(workspace.patches.Data(), positions_count, kernel_inputs_count,
+                                        workspace.patches.Stride());
+        const MatrixView<float> gradients(workspace.gradients.Data(), shape.channels, kernel_inputs_count,
+                                          workspace.gradients.Stride());
+        FillPatches(layer, inputs, patches);
+        for (size_t channel = 0; channel != shape.channels; ++channel)
+            std::fill_n(gradients.Row(channel), kernel_inputs_count, 0.0f);
+        m_kernels->accumulate(gradients.Data(), gradients.Stride(), shape.channels, kernel_inputs_count, errors,
+                              shape.channels, patches.Data(), patches.Stride(), positions_count);
+        m_kernels->update(layer.weights.Data(), layer.weights.Stride(), shape.channels, kernel_inputs_count,
+                          gradients.Data(), gradients.Stride(), 1);
+        SyncWeightColumns(layer, true);
+    } else {
+        // Only the weights of the non-zero inputs under the kernel change, they are contiguous in the transposed copy.
+        for (size_t y = 0; y != shape.height; ++y) {
+            for (size_t x = 0; x != shape.width; ++x) {
+                const float* scales = errors + (y * shape.width + x) * shape.channels;
+                CollectPatch(layer, inputs, y, x, workspace);
+                m_kernels->sparse_update(layer.weight_columns.Data(), layer.weight_columns.Stride(), shape.channels,
+                                         workspace.active_inputs.data(), workspace.active_values.data(),
+                                         workspace.active_inputs.size(), scales);
+            }
+        }
+        SyncWeightColumns(layer, false);
+    }
+}
+
+void ConvolutionalNetwork::LearnPooling(const Layer& layer, const float* inputs, const float* outputs,
+                                        const float* errors, float* input_errors) const {
+    const auto& input_shape = layer.input_shape;
+    const auto& shape = layer.output_shape;
+    const size_t channels = shape.channels;
+    const float scale = 1.0f / static_cast<float>(layer.size * layer.size);
+
+    for (size_t y = 0; y != shape.height; ++y) {
+        for (size_t x = 0; x != shape.width; ++x) {
+            const size_t pixel_offset = (y * shape.width + x) * channels;
+            const auto window_offset = [&](size_t window_index) {
+                return ((y * layer.size + window_index / layer.size) * input_shape.width + x * layer.size +
+                        window_index % layer.size) *
+                       channels;
+            };
+
+            if (layer.type == LayerType::AveragePooling) {
+                for (size_t window_index = 0; window_index != layer.size * layer.size; ++window_index)
+                    m_kernels->update(input_errors + window_offset(window_index), 0, 1, channels,
+                                      errors + pixel_offset, 0, scale);
+                continue;
+            }
+            // The error goes to the first input that was the maximum, the others did not affect the output.
+            for (size_t channel = 0; channel != channels; ++channel) {
+                for (size_t window_index = 0; window_index != layer.size * layer.size; ++window_index) {
+                    const size_t input_index = window_offset(window_index) + channel;
+                    if (inputs[input_index] == outputs[pixel_offset + channel]) {
+                        input_errors[input_index] += errors[pixel_offset + channel];
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void ConvolutionalNetwork::FillPatches(const Layer& layer, const float* inputs, MatrixView<float> patches) {
+    const auto& shape = layer.input_shape;
+    const size_t radius = layer.size / 2;
+    const size_t row_size = layer.size * shape.channels;
+    for (size_t y = 0; y != shape.height; ++y) {
+        for (size_t x = 0; x != shape.width; ++x) {
+            float* patch = patches.Row(y * shape.width + x);
+            // The pixels of a kernel row inside the feature map are contiguous, like in the patch.
+            const size_t first_kernel_x = x < radius ? radius - x : 0;
+            const size_t last_kernel_x = std::min(layer.size, shape.width + radius - x);
+            const size_t run_size = (last_kernel_x - first_kernel_x) * shape.channels;
+            for (size_t kernel_y = 0; kernel_y != layer.size; ++kernel_y) {
+                float* destination = patch + kernel_y * row_size;
+                // Positions above the feature map wrap around to large values.
+                const size_t input_y = y + kernel_y - radius;
+                if (input_y >= shape.height) {
+                    std::fill_n(destination, row_size, 0.0f);
+                    continue;
+                }
+                std::fill_n(destination, first_kernel_x * shape.channels, 0.0f);
+                std::copy_n(inputs + (input_y * shape.width + x + first_kernel_x - radius) * shape.channels, run_size,
+                            destination + first_kernel_x * shape.channels);
+                std::fill_n(destination + last_kernel_x * shape.channels, row_size - last_kernel_x * shape.channels,
+                            0.0f);
+            }
+        }
+    }
+}
+
+void ConvolutionalNetwork::CollectPatch(const Layer& layer, const float* inputs, size_t y, size_t x,
+                                        Workspace& workspace) {
+    const auto& shape = layer.input_shape;
+    const size_t radius = layer.size / 2;
+    const size_t first_kernel_x = x < radius ? radius - x : 0;
+    const size_t last_kernel_x = std::min(layer.size, shape.width + radius - x);
+    const size_t run_size = (last_kernel_x - first_kernel_x) * shape.channels;
+    workspace.active_inputs.clear();
+    workspace.active_values.clear();
+    for (size_t kernel_y = 0; kernel_y != layer.size; ++kernel_y) {
+        const size_t input_y = y + kernel_y - radius;
+        if (input_y >= shape.height)
+            continue;
+        const float* run_inputs = inputs + (input_y * shape.width + x + first_kernel_x - radius) * shape.channels;
+        const size_t first_index = (kernel_y * layer.size + first_kernel_x) * shape.channels;
+        for (size_t index = 0; index != run_size; ++index) {
+            if (run_inputs[index] != 0) {
+                workspace.active_inputs.push_back(first_index + index);
+                workspace.active_values.push_back(run_inputs[index]);
+            }
+        }
+    }
+}
+
+void ConvolutionalNetwork::SyncWeightColumns(Layer& layer, bool to_columns) {
+    for (size_t channel = 0; channel != layer.weights.Rows(); ++channel) {
+        float* channel_weights = layer.weights.Row(channel);
+        for (size_t input_index = 0; input_index != layer.weights.Columns(); ++input_index) {
+            if (to_columns)
+                layer.weight_columns(input_index, channel) = channel_weights[input_index];
+            else
+                channel_weights[input_index] = layer.weight_columns(input_index, channel);
+        }
+    }
+}
+
+void ConvolutionalNetwork::Activate(float* values, size_t count) const {
+    // Trained with the squared error only, so none of the layers is a softmax.
+    Kernels::ActivateLayer(*m_kernels, m_activation, false, values, count);
+}
+
+} // namespace Neural
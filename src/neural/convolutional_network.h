@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "kernels.h"
+#include "matrix.h"
+#include "span.h"
+
+namespace Neural {
+
+// Dimensions of a feature map. Feature maps are stored channels-last: the channels of a pixel are contiguous and the
+// pixels follow each other row by row, so a single-channel map is laid out like the glyph buffer.
+struct FeatureShape {
+    size_t height;
+    size_t width;
+    size_t channels;
+
+    inline size_t Size() const { return height * width * channels; }
+};
+
+// How the convolutions are computed. Direct adds the weights of the non-zero inputs under the kernel at every
+// position, taken from a transposed copy of them, which skips the background of mostly blank glyphs. Im2col copies
+// the inputs under the kernel at every position into the rows of a matrix and multiplies the weights with it at once,
+// which is faster for dense feature maps.
+enum class ConvolutionAlgorithm {
+    Direct,
+    Im2col,
+};
+
+// Feed-forward network for 2D inputs: convolutions and pooling layers extracting features, followed by fully connected
+// layers. Convolutions are centered with zero padding, so they keep the size of the feature map, and pooling takes the
+// maximum or the average of non-overlapping square windows. Convolutions and fully connected layers are followed by
+// the activation function, like the layers of Network.
+class ConvolutionalNetwork {
+public:
+    enum class LayerType {
+        Convolution,
+        MaxPooling,
+        AveragePooling,
+        Dense,
+    };
+
+    struct LayerDescription {
+        LayerType type;
+        // Output channels of a convolution, or neurons of a fully connected layer.
+        size_t channels;
+        // Side of the kernel of a convolution, which has to be odd, or of the pooling window.
+        size_t size;
+
+        static LayerDescription Convolution(size_t channels, size_t kernel_size) {
+            return {LayerType::Convolution, channels, kernel_size};
+        }
+        static LayerDescription MaxPooling(size_t window_size) { return {LayerType::MaxPooling, 0, window_size}; }
+        static LayerDescription AveragePooling(size_t window_size) {
+            return {LayerType::AveragePooling, 0, window_size};
+        }
+        static LayerDescription Dense(size_t neurons) { return {LayerType::Dense, neurons, 0}; }
+    };
+
+    // Scratch memory of the forward and backward passes, see BasicWorkspace.
+    struct Workspace {
+        // Outputs of every layer, errors of the current and the previous layer and weight correction scales.
+        std::vector<AlignedVector<float>> outputs;
+        AlignedVector<float> errors;
+        AlignedVector<float> next_errors;
+        AlignedVector<float> scales;
+        // Inputs under the kernel at every position of a convolution and their errors, one position per row.
+        Matrix<float> patches;
+        Matrix<float> patch_errors;
+        // Weight corrections of a convolution.
+        Matrix<float> gradients;
+        // Outputs of a convolution computed one channel per row, and zeros standing for the biases of the positions.
+        Matrix<float> channel_outputs;
+        AlignedVector<float> zero_biases;
+        // Indices into the kernel and values of the non-zero inputs under it at one position.
+        std::vector<size_t> active_inputs;
+        std::vector<float> active_values;
+    };
+
+    ConvolutionalNetwork(FeatureShape, const std::vector<LayerDescription>&);
+    ~ConvolutionalNetwork();
+
+    void Randomize(std::uint64_t);
+
+    Workspace CreateWorkspace() const;
+
+    void ComputeOutput(Span<const float>, Workspace&, Span<float>) const;
+    // One sample per row of the (samples x inputs) and (samples x outputs) matrices.
+    void ComputeOutputBatch(MatrixView<const float>, MatrixView<float>, Workspace&) const;
+
+    // Per-sample gradient descent step, like Network::Learn with the Sgd optimizer.
+    void Learn(Span<const float>, Span<const float>, float, Workspace&);
+
+    inline size_t GetLayersCount() const { return m_layers.size(); }
+    inline LayerType GetLayerType(size_t layer_index) const { return m_layers[layer_index].type; }
+    inline FeatureShape GetInputShape() const { return m_layers.front().input_shape; }
+    inline FeatureShape GetOutputShape(size_t layer_index) const { return m_layers[layer_index].output_shape; }
+    inline size_t GetInputsCount() const { return GetInputShape().Size(); }
+    inline size_t GetOutputsCount() const { return m_layers.back().output_shape.Size(); }
+
+    // Number of weights and biases.
+    size_t GetParametersCount() const;
+
+    void SetInstructionSet(Kernels::InstructionSet);
+    inline Kernels::InstructionSet GetInstructionSet() const { return m_kernels->instruction_set; }
+
+    inline void SetConvolutionAlgorithm(ConvolutionAlgorithm algorithm) { m_algorithm = algorithm; }
+    inline ConvolutionAlgorithm GetConvolutionAlgorithm() const { return m_algorithm; }
+
+    inline void SetActivation(Kernels::Activation activation) { m_activation = activation; }
+    inline Kernels::Activation GetActivation() const { return m_activation; }
+
+private:
+    struct Layer {
+        LayerType type;
+        size_t size;
+        FeatureShape input_shape;
+        FeatureShape output_shape;
+        // One row per output channel or neuron. The weights of a convolution go over the pixels of the kernel row by
+        // row and the input channels of each, like the inputs under it.
+        Matrix<float> weights;
+        // Transposed copy of the weights of a convolution for the direct algorithm, one row per input under the kernel.
+        Matrix<float> weight_columns;
+        AlignedVector<float> biases;
+    };
+
+    std::vector<Layer> m_layers;
+    const Kernels::Table<float>* m_kernels;
+    ConvolutionAlgorithm m_algorithm;
+    Kernels::Activation m_activation;
+
+    // Compute all the layers, the last one into the given outputs and the others into the workspace.
+    void ComputeLayers(const float*, float*, Workspace&) const;
+    void ComputeConvolution(const Layer&, const float*, float*, Workspace&) const;
+    void ComputePooling(const Layer&, const float*, float*) const;
+
+    // Correct the weights of a layer from the errors of its outputs, which are overwritten, and add the errors of its
+    // inputs to the given ones unless they are null.
+    void LearnConvolution(Layer&, const float*, const float*, float*, float*, float, Workspace&);
+    void LearnPooling(const Layer&, const float*, const float*, const float*, float*) const;
+
+    // Fill the rows of the patches with the inputs under the kernel at every position, zeros outside the feature map.
+    static void FillPatches(const Layer&, const float*, MatrixView<float>);
+    // Collect the non-zero inputs under the kernel at a position into the active inputs of the workspace.
+    static void CollectPatch(const Layer&, const float*, size_t, size_t, Workspace&);
+    // Copy the weights of a convolution into their transposed copy, or back.
+    static void SyncWeightColumns(Layer&, bool);
+
+    void Activate(float*, size_t) const;
+};
+
+} // namespace Neural
@@ -0,0 +1,84 @@
+#include "cpu.h"
+
+#include <cstdint>
+
+#ifdef NEURAL_X86_KERNELS
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace Neural {
+namespace Cpu {
+
+#ifdef NEURAL_X86_KERNELS
+
+static void QueryCpuid(unsigned leaf, unsigned subleaf, unsigned (&registers)[4]) {
+#ifdef _MSC_VER
+    int values[4];
+    __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+    for (int i = 0; i != 4; ++i)
+        registers[i] = static_cast<unsigned>(values[i]);
+#else
+    __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+static std::uint64_t QueryExtendedControlRegister() {
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned low, high;
+    __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+    return (static_cast<std::uint64_t>(high) << 32) | low;
+#endif
+}
+
+static Features DetectFeatures() {
+    Features features = {};
+
+    unsigned registers[4];
+    QueryCpuid(0, 0, registers);
+    const unsigned max_leaf = registers[0];
+    if (max_leaf < 1)
+        return features;
+
+    QueryCpuid(1, 0, registers);
+    features.sse2 = registers[3] & (1u << 26);
+    const bool has_osxsave = registers[2] & (1u << 27);
+    const bool has_avx = registers[2] & (1u << 28);
+    const bool has_fma = registers[2] & (1u << 12);
+    if (!has_osxsave || !has_avx)
+        return features;
+
+    // Check that the OS preserves the XMM/YMM state, and additionally the opmask/ZMM state for AVX-512.
+    const std::uint64_t xcr0 = QueryExtendedControlRegister();
+    const bool ymm_enabled = (xcr0 & 0x06) == 0x06;
+    const bool zmm_enabled = (xcr0 & 0xe6) == 0xe6;
+    if (!ymm_enabled || max_leaf < 7)
+        return features;
+
+    QueryCpuid(7, 0, registers);
+    features.fma = has_fma;
+    features.avx2 = registers[1] & (1u << 5);
+    features.avx512f = zmm_enabled && (registers[1] & (1u << 16));
+    return features;
+}
+
+#else
+
+static Features DetectFeatures() {
+    return {};
+}
+
+#endif
+
+const Features& GetFeatures() {
+    static const Features features = DetectFeatures();
+    return features;
+}
+
+} // namespace Cpu
+} // namespace Neural
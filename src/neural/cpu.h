@@ -0,0 +1,18 @@
+#pragma once
+
+namespace Neural {
+namespace Cpu {
+
+struct Features {
+    bool sse2;
+    bool avx2;
+    bool fma;
+    bool avx512f;
+};
+
+// Features of the CPU the program runs on, queried once on first use.
+// Extended register sets are only reported as available when the OS saves them on context switches.
+const Features& GetFeatures();
+
+} // namespace Cpu
+} // namespace Neural
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+#include "kernels.h"
+#include "matrix.h"
+#include "network.h"
+#include "span.h"
+
+// Fully unrolling the loop over a layer's outputs lets the compiler keep the sums in registers at any optimization
+// level, otherwise every input waits for the previous one's sums to be stored and loaded back.
+#if defined(__GNUC__) || defined(__clang__)
+#define NEURAL_FIXED_UNROLL _Pragma("GCC unroll 128")
+#else
+#define NEURAL_FIXED_UNROLL
+#endif
+
+namespace Neural {
+
+// Inference-only network whose topology is fixed at compile time: `InputsCount` inputs followed by layers of the
+// given sizes, e.g. FixedNetwork<256, 20, 10>. The parameters are std::array members of the object itself, so it
+// never allocates, and every loop has a constant trip count the compiler can unroll and vectorize.
+// It is meant for deploying small trained models and copies its parameters from a Network of the same topology.
+template <size_t InputsCount, size_t... LayerSizes>
+class FixedNetwork {
+public:
+    static constexpr size_t layers_count = sizeof...(LayerSizes);
+    static_assert(layers_count > 0, "At least the output layer is required");
+
+    // Inputs of every layer followed by the outputs of the last one.
+    static constexpr std::array<size_t, layers_count + 1> sizes = {InputsCount, LayerSizes...};
+    static constexpr size_t inputs_count = InputsCount;
+    static constexpr size_t outputs_count = sizes[layers_count];
+
+    explicit FixedNetwork(const Network& network) { Load(network); }
+
+    static bool IsCompatible(const Network& network) {
+        if (network.GetLayersCount() != layers_count || network.GetInputsCount() != inputs_count)
+            return false;
+        for (size_t layer_index = 0; layer_index != layers_count; ++layer_index)
+            if (network.GetLayerSize(layer_index) != sizes[layer_index + 1])
+                return false;
+        return true;
+    }
+
+    // Copy the parameters, instruction set, activation and loss of a network of the same topology.
+    void Load(const Network& network) {
+        assert(IsCompatible(network));
+        LoadLayers(network, std::make_index_sequence<layers_count>());
+        m_kernels = &Kernels::GetTable<float>(network.GetInstructionSet());
+        m_activation = network.GetActivation();
+        m_loss = network.GetLoss();
+    }
+
+    std::array<float, outputs_count> ComputeOutput(const std::array<float, inputs_count>& inputs) const {
+        std::array<float, outputs_count> outputs;
+        ComputeLayers<0>(inputs.data(), outputs.data());
+        return outputs;
+    }
+
+    void ComputeOutput(Span<const float> inputs, Span<float> outputs) const {
+        assert(inputs.Size() == inputs_count);
+        assert(outputs.Size() == outputs_count);
+        ComputeLayers<0>(inputs.Data(), outputs.Data());
+    }
+
+    inline void SetActivation(Kernels::Activation activation) { m_activation = activation; }
+    inline Kernels::Activation GetActivation() const { return m_activation; }
+
+    inline void SetLoss(Loss loss) { m_loss = loss; }
+    inline Loss GetLoss() const { return m_loss; }
+
+private:
+    // Weights are stored transposed, one row per input, so that the inner loop runs over the outputs of the layer
+    // without a horizontal sum. Rows are padded to whole cache lines with zeros and the loop covers the padding too.
+    template <size_t Inputs, size_t Outputs>
+    struct Layer {
+        static constexpr size_t stride = Matrix<float>::PaddedStride(Outputs);
+
+        alignas(cache_line_size) std::array<std::array<float, stride>, Inputs> weights;
+        alignas(cache_line_size) std::array<float, stride> biases;
+    };
+
+    template <size_t... Indices>
+    static auto MakeLayers(std::index_sequence<Indices...>)
+        -> std::tuple<Layer<sizes[Indices], sizes[Indices + 1]>...>;
+
+    decltype(MakeLayers(std::make_index_sequence<layers_count>())) m_layers;
+    const Kernels::Table<float>* m_kernels;
+    Kernels::Activation m_activation;
+    Loss m_loss;
+
+    template <size_t... Indices>
+    void LoadLayers(const Network& network, std::index_sequence<Indices...>) {
+        (LoadLayer(std::get<Indices>(m_layers), network.GetWeights(Indices), network.GetBiases(Indices)), ...);
+    }
+
+    template <size_t Inputs, size_t Outputs, typename B>
+    static void LoadLayer(Layer<Inputs, Outputs>& layer, MatrixView<const float> weights, const B& biases) {
+        for (auto& row : layer.weights)
+            row.fill(0);
+        layer.biases.fill(0);
+        for (size_t output_index = 0; output_index != Outputs; ++output_index) {
+            for (size_t input_index = 0; input_index != Inputs; ++input_index)
+                layer.weights[input_index][output_index] = weights(output_index, input_index);
+            layer.biases[output_index] = biases[output_index];
+        }
+    }
+
+    template <size_t Index>
+    void ComputeLayers(const float* inputs, float* outputs) const {
+        using L = Layer<sizes[Index], sizes[Index + 1]>;
+        const L& layer = std::get<Index>(m_layers);
+
+        alignas(cache_line_size) std::array<float, L::stride> sums = layer.biases;
+        for (size_t input_index = 0; input_index != sizes[Index]; ++input_index) {
+            const float input = inputs[input_index];
+            // Glyphs are mostly background in long runs, so this branch is cheap and saves most of the first layer.
+            if (input == 0)
+                continue;
+            const auto& row = layer.weights[input_index];
+            NEURAL_FIXED_UNROLL
+            for (size_t output_index = 0; output_index != L::stride; ++output_index)
+                sums[output_index] += row[output_index] * input;
+        }
+
+        Kernels::ActivateLayer(*m_kernels, m_activation, Index + 1 == layers_count && m_loss == Loss::CrossEntropy,
+                               sums.data(), sizes[Index + 1]);
+
+        if constexpr (Index + 1 == layers_count)
+            std::copy_n(sums.begin(), outputs_count, outputs);
+        else
+            ComputeLayers<Index + 1>(sums.data(), outputs);
+    }
+};
+
+} // namespace Neural
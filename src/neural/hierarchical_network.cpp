@@ -0,0 +1,172 @@
+#include "hierarchical_network.h"
+
+#include <cassert>
+#include <cmath>
+#include <numeric>
+#include <utility>
+
+#include <util/random.h>
+
+namespace Neural {
+
+namespace {
+
+size_t ChooseGroupSize(size_t classes_count, size_t groups_count) {
+    if (groups_count == 0)
+        groups_count = std::max<size_t>(1, std::lround(std::sqrt(static_cast<double>(classes_count))));
+    return (classes_count + groups_count - 1) / groups_count;
+}
+
+} // namespace
+
+HierarchicalNetwork::HierarchicalNetwork(SequentialNetwork hidden, size_t classes_count, size_t groups_count)
+    : m_hidden(std::move(hidden)), m_group_size(ChooseGroupSize(classes_count, groups_count)),
+      m_group_weights((classes_count + m_group_size - 1) / m_group_size, m_hidden.GetOutputsCount()),
+      m_group_biases(m_group_weights.Rows()), m_class_weights(classes_count, m_hidden.GetOutputsCount()),
+      m_class_biases(classes_count), m_kernels(&Kernels::GetTable<float>(m_hidden.GetInstructionSet())) {
+    assert(classes_count != 0);
+}
+
+HierarchicalNetwork::~HierarchicalNetwork() {}
+
+void HierarchicalNetwork::Randomize(std::uint64_t seed) {
+    m_hidden.Randomize(seed);
+
+    // Scaled by the number of inputs like DenseLayer, from a sequence of its own.
+    Random::Prng<> random(seed + 1);
+    const float range = std::sqrt(3.0f / m_class_weights.Columns());
+    for (auto* weights : {&m_group_weights, &m_class_weights})
+        for (size_t row_index = 0; row_index != weights->Rows(); ++row_index)
+            for (size_t column_index = 0; column_index != weights->Columns(); ++column_index)
+                (*weights)(row_index, column_index) = random.NextFloat<float>(-range, range);
+    for (auto* biases : {&m_group_biases, &m_class_biases})
+        for (auto& bias : *biases)
+            bias = random.NextFloat<float>(-range, range);
+}
+
+HierarchicalNetwork::Workspace HierarchicalNetwork::CreateWorkspace() const {
+    Workspace workspace;
+    workspace.hidden = m_hidden.CreateWorkspace();
+    workspace.group_probabilities.resize(GetGroupsCount());
+    workspace.class_probabilities.resize(m_group_size);
+    workspace.feature_errors.resize(m_class_weights.Columns());
+    workspace.scales.resize(std::max(GetGroupsCount(), m_group_size));
+    workspace.group_order.reserve(GetGroupsCount());
+    return workspace;
+}
+
+Span<const Candidate> HierarchicalNetwork::TopK(Span<const float> inputs, size_t k, Workspace& workspace) const {
+    auto& candidates = workspace.candidates;
+    candidates.clear();
+    if (k == 0)
+        return candidates;
+
+    float* features = workspace.hidden.outputs.back().data();
+    m_hidden.ComputeOutput(inputs, workspace.hidden, {features, m_hidden.GetOutputsCount()});
+    ComputeGroups(features, workspace);
+
+    const auto& group_probabilities = workspace.group_probabilities;
+    auto& group_order = workspace.group_order;
+    group_order.resize(GetGroupsCount());
+    std::iota(group_order.begin(), group_order.end(), 0);
+    std::sort(group_order.begin(), group_order.end(),
+              [&](size_t a, size_t b) { return group_probabilities[a] > group_probabilities[b]; });
+
+    // The candidates are kept as a heap with the least probable one on top, like in Network::TopK.
+    const auto is_stronger = [](const Candidate& a, const Candidate& b) {
+        return a.confidence > b.confidence || (a.confidence == b.confidence && a.index < b.index);
+    };
+    for (size_t group_index : group_order) {
+        const float group_probability = group_probabilities[group_index];
+        if (candidates.size() == k && group_probability <= candidates.front().confidence)
+            break;
+
+        ComputeClasses(features, group_index, workspace);
+        for (size_t index = 0; index != GetGroupClassesCount(group_index); ++index) {
+            const Candidate candidate{GetFirstClass(group_index) + index,
+                                      group_probability * workspace.class_probabilities[index]};
+            if (candidates.size() != k) {
+                candidates.push_back(candidate);
+                std::push_heap(candidates.begin(), candidates.end(), is_stronger);
+            } else if (is_stronger(candidate, candidates.front())) {
+                std::pop_heap(candidates.begin(), candidates.end(), is_stronger);
+                candidates.back() = candidate;
+                std::push_heap(candidates.begin(), candidates.end(), is_stronger);
+            }
+        }
+    }
+    std::sort_heap(candidates.begin(), candidates.end(), is_stronger);
+    return candidates;
+}
+
+float HierarchicalNetwork::GetProbability(Span<const float> inputs, size_t class_index, Workspace& workspace) const {
+    assert(class_index < GetClassesCount());
+
+    float* features = workspace.hidden.outputs.back().data();
+    m_hidden.ComputeOutput(inputs, workspace.hidden, {features, m_hidden.GetOutputsCount()});
+    const size_t group_index = GetGroup(class_index);
+    ComputeGroups(features, workspace);
+    ComputeClasses(features, group_index, workspace);
+    return workspace.group_probabilities[group_index] *
+           workspace.class_probabilities[class_index - GetFirstClass(group_index)];
+}
+
+void HierarchicalNetwork::Learn(Span<const float> inputs, size_t target_class, float rate, Workspace& workspace) {
+    assert(rate > 0 && rate <= 1);
+    assert(target_class < GetClassesCount());
+
+    const float* features = m_hidden.ComputeOutputForLearning(inputs, workspace.hidden).Data();
+    const size_t target_group = GetGroup(target_class);
+    ComputeGroups(features, workspace);
+    ComputeClasses(features, target_group, workspace);
+
+    // The cross-entropy of a softmax has the target minus the probabilities as the errors of its sums, for the groups
+    // and for the classes of the target's group alike. No other class contributes to the loss.
+    float* feature_errors = workspace.feature_errors.data();
+    std::fill(workspace.feature_errors.begin(), workspace.feature_errors.end(), 0.0f);
+    const auto learn_rows = [&](Matrix<float>& weights, AlignedVector<float>& biases, size_t first, size_t count,
+                                float* probabilities, size_t target) {
+        float* scales = workspace.scales.data();
+        for (size_t index = 0; index != count; ++index) {
+            probabilities[index] = (index == target ? 1 : 0) - probabilities[index];
+            scales[index] = rate * probabilities[index];
+            biases[first + index] += scales[index];
+        }
+        m_kernels->backward(weights.Row(first), weights.Stride(), count, weights.Columns(), probabilities, scales,
+                            features, feature_errors);
+    };
+    learn_rows(m_group_weights, m_group_biases, 0, GetGroupsCount(), workspace.group_probabilities.data(),
+               target_group);
+    learn_rows(m_class_weights, m_class_biases, GetFirstClass(target_group), GetGroupClassesCount(target_group),
+               workspace.class_probabilities.data(), target_class - GetFirstClass(target_group));
+
+    m_hidden.Backpropagate(inputs, workspace.feature_errors, rate, workspace.hidden);
+}
+
+size_t HierarchicalNetwork::GetParametersCount() const {
+    const size_t rows = GetGroupsCount() + GetClassesCount();
+    return m_hidden.GetParametersCount() + rows * (m_class_weights.Columns() + 1);
+}
+
+void HierarchicalNetwork::SetInstructionSet(Kernels::InstructionSet instruction_set) {
+    m_hidden.SetInstructionSet(instruction_set);
+    m_kernels = &Kernels::GetTable<float>(instruction_set);
+}
+
+void HierarchicalNetwork::ComputeGroups(const float* features, Workspace& workspace) const {
+    float* probabilities = workspace.group_probabilities.data();
+    m_kernels->dense(m_group_weights.Data(), m_group_weights.Stride(), m_group_weights.Rows(),
+                     m_group_weights.Columns(), features, m_group_biases.data(), probabilities);
+    m_kernels->softmax(probabilities, m_group_weights.Rows());
+}
+
+void HierarchicalNetwork::ComputeClasses(const float* features, size_t group_index, Workspace& workspace) const {
+    const size_t first_class = GetFirstClass(group_index);
+    const size_t count = GetGroupClassesCount(group_index);
+    float* probabilities = workspace.class_probabilities.data();
+    m_kernels->dense(m_class_weights.Row(first_class), m_class_weights.Stride(), count, m_class_weights.Columns(),
+                     features, m_class_biases.data() + first_class, probabilities);
+    m_kernels->softmax(probabilities, count);
+}
+
+} // namespace Neural
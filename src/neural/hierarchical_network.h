@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "kernels.h"
+#include "matrix.h"
+#include "network.h"
+#include "sequential_network.h"
+#include "span.h"
+
+namespace Neural {
+
+// Classifier for many classes: hidden layers followed by a two-level output layer instead of a flat one. The classes
+// are split into groups of consecutive ones, and the probability of a class is that of its group, a softmax over the
+// groups, times its own within the group, a softmax over the classes of the group. With about the square root of
+// the class count as groups of about as many classes, learning a sample only involves the groups and the classes of
+// the target's group, and recognizing one the groups and the classes of the few most probable groups, so a sample
+// costs about the square root of the class count instead of all of them.
+class HierarchicalNetwork {
+public:
+    // Scratch memory of the forward and backward passes, see BasicWorkspace.
+    struct Workspace {
+        SequentialNetwork::Workspace hidden;
+        // Probabilities of the groups and of the classes of one group, and the errors of the hidden layers' outputs.
+        AlignedVector<float> group_probabilities;
+        AlignedVector<float> class_probabilities;
+        AlignedVector<float> feature_errors;
+        AlignedVector<float> scales;
+        // Groups from the most probable down, and the most probable classes chosen by TopK.
+        std::vector<size_t> group_order;
+        std::vector<Candidate> candidates;
+    };
+
+    // The hidden layers, whose outputs are the inputs of the output layer, and the number of classes. Without a number
+    // of groups, it is the square root of the number of classes.
+    HierarchicalNetwork(SequentialNetwork, size_t, size_t = 0);
+    ~HierarchicalNetwork();
+
+    void Randomize(std::uint64_t);
+
+    // The workspace has to be created again after layers are added to the hidden ones.
+    Workspace CreateWorkspace() const;
+
+    // The given number of most probable classes with their probabilities, from the most probable one down, kept in
+    // the workspace until the next call. The groups are expanded from the most probable one down, until the next one
+    // is less probable than the last of the candidates so far, which none of its classes can then beat.
+    Span<const Candidate> TopK(Span<const float>, size_t, Workspace&) const;
+
+    // Probability of one class.
+    float GetProbability(Span<const float>, size_t, Workspace&) const;
+
+    // Per-sample gradient descent step on the cross-entropy of the given target class, through the hidden layers too.
+    void Learn(Span<const float>, size_t, float, Workspace&);
+
+    inline size_t GetInputsCount() const { return m_hidden.GetInputsCount(); }
+    inline size_t GetClassesCount() const { return m_class_weights.Rows(); }
+    inline size_t GetGroupsCount() const { return m_group_weights.Rows(); }
+    // Classes of every group but the last one, which may have fewer.
+    inline size_t GetGroupSize() const { return m_group_size; }
+    inline size_t GetGroup(size_t class_index) const { return class_index / m_group_size; }
+
+    inline const SequentialNetwork& GetHiddenLayers() const { return m_hidden; }
+    inline SequentialNetwork& GetHiddenLayers() { return m_hidden; }
+
+    // Number of trained parameters of the hidden layers and the output layer.
+    size_t GetParametersCount() const;
+
+    void SetInstructionSet(Kernels::InstructionSet);
+    inline Kernels::InstructionSet GetInstructionSet() const { return m_kernels->instruction_set; }
+
+private:
+    SequentialNetwork m_hidden;
+    size_t m_group_size;
+    // One row per group, and one per class with the classes of every group following each other.
+    Matrix<float> m_group_weights;
+    AlignedVector<float> m_group_biases;
+    Matrix<float> m_class_weights;
+    AlignedVector<float> m_class_biases;
+    const Kernels::Table<float>* m_kernels;
+
+    inline size_t GetFirstClass(size_t group_index) const { return group_index * m_group_size; }
+    inline size_t GetGroupClassesCount(size_t group_index) const {
+        return std::min(m_group_size, GetClassesCount() - GetFirstClass(group_index));
+    }
+
+    // Compute the probabilities of the groups, or of the classes of one group, from the outputs of the hidden layers.
+    void ComputeGroups(const float*, Workspace&) const;
+    void ComputeClasses(const float*, size_t, Workspace&) const;
+};
+
+} // namespace Neural
@@ -0,0 +1,424 @@
+#include "kernels.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <initializer_list>
+#include <vector>
+
+#include "activation.h"
+#include "bfloat16.h"
+#include "cpu.h"
+#include "matrix.h"
+
+namespace Neural {
+namespace Kernels {
+
+// Reference implementations, kept deliberately straightforward.
+template <typename T, typename W>
+static void ScalarDense(const W* weights, size_t stride, size_t rows, size_t columns, const T* inputs,
+                        const T* biases, T* outputs) {
+    for (size_t row = 0; row != rows; ++row) {
+        const W* row_weights = weights + row * stride;
+        T sum = 0;
+        for (size_t column = 0; column != columns; ++column)
+            sum += inputs[column] * static_cast<T>(row_weights[column]);
+        outputs[row] = sum + biases[row];
+    }
+}
+
+template <typename T, typename W>
+static void ScalarSparseDense(const W* columns, size_t stride, size_t rows, const size_t* indices, const T* values,
+                              size_t count, const T* biases, T* outputs) {
+    if (outputs != biases)
+        std::copy_n(biases, rows, outputs);
+    for (size_t index = 0; index != count; ++index) {
+        const W* column = columns + indices[index] * stride;
+        for (size_t row = 0; row != rows; ++row)
+            outputs[row] += static_cast<T>(column[row]) * values[index];
+    }
+}
+
+template <typename T, typename W>
+static void ScalarCsrDense(const W* values, const std::uint32_t* indices, const std::uint32_t* offsets, size_t rows,
+                           const T* inputs, const T* biases, T* outputs) {
+    // Rows are short, four partial sums keep them from being a single chain of dependent additions.
+    for (size_t row = 0; row != rows; ++row) {
+        const size_t last = offsets[row + 1];
+        size_t index = offsets[row];
+        T sums[4] = {0, 0, 0, 0};
+        for (; index + 4 <= last; index += 4)
+            for (size_t lane = 0; lane != 4; ++lane)
+                sums[lane] += static_cast<T>(values[index + lane]) * inputs[indices[index + lane]];
+        for (; index != last; ++index)
+            sums[0] += static_cast<T>(values[index]) * inputs[indices[index]];
+        outputs[row] = biases[row] + ((sums[0] + sums[1]) + (sums[2] + sums[3]));
+    }
+}
+
+template <typename T, typename W>
+static void ScalarDenseBatch(const W* weights, size_t stride, size_t rows, size_t columns, const T* inputs,
+                             size_t inputs_stride, size_t samples, const T* biases, T* outputs, size_t outputs_stride) {
+    for (size_t sample = 0; sample != samples; ++sample)
+        ScalarDense(weights, stride, rows, columns, inputs + sample * inputs_stride, biases,
+                    outputs + sample * outputs_stride);
+}
+
+template <typename T, typename W>
+static void ScalarBackward(W* weights, size_t stride, size_t rows, size_t columns, const T* errors, const T* scales,
+                           const T* inputs, T* input_errors) {
+    for (size_t row = 0; row != rows; ++row) {
+        W* row_weights = weights + row * stride;
+        const T error = errors[row];
+        const T scale = scales[row];
+        for (size_t column = 0; column != columns; ++column) {
+            const T weight = static_cast<T>(row_weights[column]);
+            // Contribute to the error value of each input before changing the weight.
+            if (input_errors)
+                input_errors[column] += weight * error;
+            row_weights[column] = static_cast<W>(weight + scale * inputs[column]);
+        }
+    }
+}
+
+template <typename T, typename W>
+static void ScalarSparseUpdate(W* columns, size_t stride, size_t rows, const size_t* indices, const T* values,
+                               size_t count, const T* scales) {
+    for (size_t index = 0; index != count; ++index) {
+        W* column = columns + indices[index] * stride;
+        for (size_t row = 0; row != rows; ++row)
+            column[row] = static_cast<W>(static_cast<T>(column[row]) + scales[row] * values[index]);
+    }
+}
+
+template <typename T, typename W>
+static void ScalarBackwardBatch(const W* weights, size_t stride, size_t rows, size_t columns, const T* errors,
+                                size_t errors_stride, size_t samples, T* input_errors, size_t input_errors_stride) {
+    for (size_t sample = 0; sample != samples; ++sample) {
+        const T* sample_errors = errors + sample * errors_stride;
+        T* sample_input_errors = input_errors + sample * input_errors_stride;
+        for (size_t row = 0; row != rows; ++row) {
+            const W* row_weights = weights + row * stride;
+            for (size_t column = 0; column != columns; ++column)
+                sample_input_errors[column] += static_cast<T>(row_weights[column]) * sample_errors[row];
+        }
+    }
+}
+
+template <typename T>
+static void ScalarAccumulate(T* gradients, size_t stride, size_t rows, size_t columns, const T* deltas,
+                             size_t deltas_stride, const T* inputs, size_t inputs_stride, size_t samples) {
+    for (size_t row = 0; row != rows; ++row) {
+        T* row_gradients = gradients + row * stride;
+        for (size_t sample = 0; sample != samples; ++sample) {
+            const T delta = deltas[sample * deltas_stride + row];
+            const T* sample_inputs = inputs + sample * inputs_stride;
+            for (size_t column = 0; column != columns; ++column)
+                row_gradients[column] += delta * sample_inputs[column];
+        }
+    }
+}
+
+template <typename T, typename W>
+static void ScalarUpdate(W* weights, size_t stride, size_t rows, size_t columns, const T* gradients,
+                         size_t gradients_stride, T scale) {
+    for (size_t row = 0; row != rows; ++row) {
+        W* row_weights = weights + row * stride;
+        const T* row_gradients = gradients + row * gradients_stride;
+        for (size_t column = 0; column != columns; ++column)
+            row_weights[column] = static_cast<W>(static_cast<T>(row_weights[column]) + row_gradients[column] * scale);
+    }
+}
+
+template <typename T>
+static void ScalarMaximum(T* outputs, const T* inputs, size_t count) {
+    for (size_t index = 0; index != count; ++index)
+        outputs[index] = std::max(outputs[index], inputs[index]);
+}
+
+template <typename T, typename W>
+static void ScalarMomentumUpdate(W* weights, size_t stride, size_t rows, size_t columns, const T* gradients,
+                                 size_t gradients_stride, T* velocities, T gradient_scale, T rate, T momentum,
+                                 bool nesterov) {
+    for (size_t row = 0; row != rows; ++row) {
+        W* row_weights = weights + row * stride;
+        const T* row_gradients = gradients + row * gradients_stride;
+        T* row_velocities = velocities + row * gradients_stride;
+        for (size_t column = 0; column != columns; ++column) {
+            const T gradient = row_gradients[column] * gradient_scale;
+            const T velocity = momentum * row_velocities[column] + gradient;
+            row_velocities[column] = velocity;
+            const T step = nesterov ? momentum * velocity + gradient : velocity;
+            row_weights[column] = static_cast<W>(static_cast<T>(row_weights[column]) + rate * step);
+        }
+    }
+}
+
+template <typename T, typename W>
+static void ScalarAdamUpdate(W* weights, size_t stride, size_t rows, size_t columns, const T* gradients,
+                             size_t gradients_stride, T* moments, T* squares, T gradient_scale, T rate, T beta1,
+                             T beta2, T epsilon) {
+    for (size_t row = 0; row != rows; ++row) {
+        W* row_weights = weights + row * stride;
+        const T* row_gradients = gradients + row * gradients_stride;
+        T* row_moments = moments + row * gradients_stride;
+        T* row_squares = squares + row * gradients_stride;
+        for (size_t column = 0; column != columns; ++column) {
+            const T gradient = row_gradients[column] * gradient_scale;
+            const T moment = beta1 * row_moments[column] + (1 - beta1) * gradient;
+            const T square = beta2 * row_squares[column] + (1 - beta2) * gradient * gradient;
+            row_moments[column] = moment;
+            row_squares[column] = square;
+            row_weights[column] =
+                static_cast<W>(static_cast<T>(row_weights[column]) + rate * moment / (std::sqrt(square) + epsilon));
+        }
+    }
+}
+
+template <typename T>
+static void ScalarActivate(Activation approximation, T* values, size_t count) {
+    assert(approximation != Activation::Exact);
+    for (size_t index = 0; index != count; ++index) {
+        const T tanh = approximation == Activation::Fast ? FastTanh<ScalarOps<T>>(values[index])
+                                                         : PreciseTanh<ScalarOps<T>>(values[index]);
+        values[index] = T(0.5) * (tanh + 1);
+    }
+}
+
+template <typename T>
+static void ScalarSoftmax(T* values, size_t count) {
+    const T max_value = *std::max_element(values, values + count);
+    T sum = 0;
+    for (size_t index = 0; index != count; ++index) {
+        values[index] = Exp<ScalarOps<T>>(values[index] - max_value);
+        sum += values[index];
+    }
+    for (size_t index = 0; index != count; ++index)
+        values[index] /= sum;
+}
+
+template <typename T, typename W>
+const Table<T, W>& GetScalarTable() {
+    static const Table<T, W> table = {
+        InstructionSet::Scalar,     ScalarDense<T, W>,         ScalarDenseBatch<T, W>, ScalarSparseDense<T, W>,
+        ScalarCsrDense<T, W>,       ScalarBackward<T, W>,      ScalarSparseUpdate<T, W>,
+        ScalarBackwardBatch<T, W>,  ScalarAccumulate<T>,       ScalarUpdate<T, W>,
+        ScalarMaximum<T>,           ScalarActivate<T>,         ScalarSoftmax<T>,
+        ScalarMomentumUpdate<T, W>, ScalarAdamUpdate<T, W>,
+    };
+    return table;
+}
+
+static void ScalarQuantizedDense(const std::int8_t* weights, size_t stride, size_t rows, size_t columns,
+                                 const std::uint8_t* inputs, std::int32_t* outputs) {
+    for (size_t row = 0; row != rows; ++row) {
+        const std::int8_t* row_weights = weights + row * stride;
+        std::int32_t sum = 0;
+        for (size_t column = 0; column != columns; ++column)
+            sum += static_cast<std::int32_t>(inputs[column]) * row_weights[column];
+        outputs[row] = sum;
+    }
+}
+
+const QuantizedTable& GetScalarQuantizedTable() {
+    static const QuantizedTable table = {InstructionSet::Scalar, ScalarQuantizedDense};
+    return table;
+}
+
+const char* GetName(InstructionSet instruction_set) {
+    switch (instruction_set) {
+    case InstructionSet::Scalar:
+        return "Scalar";
+    case InstructionSet::Sse2:
+        return "SSE2";
+    case InstructionSet::Avx2:
+        return "AVX2";
+    case InstructionSet::Avx512:
+        return "AVX-512";
+    }
+    return "Unknown";
+}
+
+const char* GetName(Activation activation) {
+    switch (activation) {
+    case Activation::Fast:
+        return "Fast";
+    case Activation::Precise:
+        return "Precise";
+    case Activation::Exact:
+        return "Exact";
+    }
+    return "Unknown";
+}
+
+double GetMaxError(Activation activation) {
+    // Half of the tanh approximation error, with some room for rounding.
+    switch (activation) {
+    case Activation::Fast:
+        return 0.0125;
+    case Activation::Precise:
+        return 5e-7;
+    default:
+        return 0;
+    }
+}
+
+Activation SelectActivation(double max_error) {
+    for (auto activation : {Activation::Fast, Activation::Precise})
+        if (GetMaxError(activation) <= max_error)
+            return activation;
+    return Activation::Exact;
+}
+
+template <typename T, typename W>
+double MeasureMaxError(const Table<T, W>& table, Activation activation) {
+    // tanh(±10) is 1 even in double precision.
+    constexpr double range = 10;
+    constexpr size_t points_count = 1 << 20;
+
+    std::vector<T> values(points_count);
+    for (size_t index = 0; index != points_count; ++index)
+        values[index] = static_cast<T>(-range + 2 * range * index / (points_count - 1));
+    std::vector<T> approximations = values;
+    if (activation != Activation::Exact)
+        table.activate(activation, approximations.data(), approximations.size());
+    else
+        for (auto& value : approximations)
+            value = T(0.5) * (std::tanh(value) + 1);
+
+    double max_error = 0;
+    for (size_t index = 0; index != points_count; ++index) {
+        const double reference = 0.5 * (std::tanh(static_cast<double>(values[index])) + 1);
+        max_error = std::max(max_error, std::fabs(static_cast<double>(approximations[index]) - reference));
+    }
+    return max_error;
+}
+
+template <typename T, typename W>
+Throughput MeasureThroughput(const Table<T, W>& table, size_t samples, size_t rows, size_t columns) {
+    constexpr double min_seconds = 0.05;
+
+    Matrix<W> weights(rows, columns);
+    Matrix<T> gradients(rows, columns);
+    Matrix<T> inputs(samples, columns);
+    Matrix<T> input_errors(samples, columns);
+    Matrix<T> outputs(samples, rows);
+    std::vector<T> biases(rows, T(0.1));
+    // Any values will do as long as they stay finite over the repetitions.
+    for (size_t row = 0; row != rows; ++row)
+        for (size_t column = 0; column != columns; ++column)
+            weights(row, column) = static_cast<W>(static_cast<T>(((row + column) % 7) * 0.01));
+    for (size_t sample = 0; sample != samples; ++sample)
+        for (size_t column = 0; column != columns; ++column)
+            inputs(sample, column) = static_cast<T>(((sample * 3 + column) % 5) * 0.1);
+
+    // Repeat until the time adds up, starting with one run to warm the caches up.
+    const auto measure = [&](const auto& run) {
+        run();
+        size_t runs_count = 0;
+        const auto start_time = std::chrono::steady_clock::now();
+        double seconds = 0;
+        do {
+            run();
+            ++runs_count;
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        } while (seconds < min_seconds);
+        return 2.0 * samples * rows * columns * runs_count / seconds * 1e-9;
+    };
+
+    Throughput throughput;
+    throughput.forward = measure([&] {
+        table.dense_batch(weights.Data(), weights.Stride(), rows, columns, inputs.Data(), inputs.Stride(), samples,
+                          biases.data(), outputs.Data(), outputs.Stride());
+    });
+    // The outputs of the forward pass stand in for the errors.
+    throughput.backward = measure([&] {
+        table.backward_batch(weights.Data(), weights.Stride(), rows, columns, outputs.Data(), outputs.Stride(),
+                             samples, input_errors.Data(), input_errors.Stride());
+    });
+    throughput.accumulate = measure([&] {
+        table.accumulate(gradients.Data(), gradients.Stride(), rows, columns, outputs.Data(), outputs.Stride(),
+                         inputs.Data(), inputs.Stride(), samples);
+    });
+    return throughput;
+}
+
+bool IsSupported(InstructionSet instruction_set) {
+#ifdef NEURAL_X86_KERNELS
+    const auto& features = Cpu::GetFeatures();
+    switch (instruction_set) {
+    case InstructionSet::Scalar:
+        return true;
+    case InstructionSet::Sse2:
+        return features.sse2;
+    case InstructionSet::Avx2:
+        return features.avx2 && features.fma;
+    case InstructionSet::Avx512:
+        return features.avx512f && features.fma;
+    }
+    return false;
+#else
+    return instruction_set == InstructionSet::Scalar;
+#endif
+}
+
+static InstructionSet DetectBestInstructionSet() {
+    for (auto instruction_set : {InstructionSet::Avx512, InstructionSet::Avx2, InstructionSet::Sse2})
+        if (IsSupported(instruction_set))
+            return instruction_set;
+    return InstructionSet::Scalar;
+}
+
+InstructionSet GetBestInstructionSet() {
+    static const InstructionSet best = DetectBestInstructionSet();
+    return best;
+}
+
+template <typename T, typename W>
+const Table<T, W>& GetTable(InstructionSet instruction_set) {
+    assert(IsSupported(instruction_set));
+    switch (instruction_set) {
+#ifdef NEURAL_X86_KERNELS
+    case InstructionSet::Sse2:
+        return GetSse2Table<T, W>();
+    case InstructionSet::Avx2:
+        return GetAvx2Table<T, W>();
+    case InstructionSet::Avx512:
+        return GetAvx512Table<T, W>();
+#endif
+    default:
+        return GetScalarTable<T, W>();
+    }
+}
+
+const QuantizedTable& GetQuantizedTable(InstructionSet instruction_set) {
+    assert(IsSupported(instruction_set));
+    switch (instruction_set) {
+#ifdef NEURAL_X86_KERNELS
+    case InstructionSet::Sse2:
+        return GetSse2QuantizedTable();
+    // 512-bit integer multiplications need AVX-512BW on top of the detected foundation, stay with 256 bits.
+    case InstructionSet::Avx2:
+    case InstructionSet::Avx512:
+        return GetAvx2QuantizedTable();
+#endif
+    default:
+        return GetScalarQuantizedTable();
+    }
+}
+
+template double MeasureMaxError(const Table<float>&, Activation);
+template double MeasureMaxError(const Table<double>&, Activation);
+template double MeasureMaxError(const Table<float, BFloat16>&, Activation);
+
+template Throughput MeasureThroughput(const Table<float>&, size_t, size_t, size_t);
+template Throughput MeasureThroughput(const Table<double>&, size_t, size_t, size_t);
+template Throughput MeasureThroughput(const Table<float, BFloat16>&, size_t, size_t, size_t);
+
+template const Table<float>& GetTable<float>(InstructionSet);
+template const Table<double>& GetTable<double>(InstructionSet);
+template const Table<float, BFloat16>& GetTable<float, BFloat16>(InstructionSet);
+
+} // namespace Kernels
+} // namespace Neural
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace Neural {
+namespace Kernels {
+
+enum class InstructionSet {
+    Scalar,
+    Sse2,
+    Avx2,
+    Avx512,
+};
+
+// Ways to evaluate the activation function 0.5 * (tanh(x) + 1), from the cheapest to the reference one.
+enum class Activation {
+    Fast,
+    Precise,
+    // std::tanh, computed by the caller rather than by the kernels.
+    Exact,
+};
+
+// Low-level routines used by the network for its hot loops.
+// All matrices are row-major with rows `stride` elements apart.
+// Weights are stored as `W` but all the arithmetic is carried out in `T`.
+template <typename T, typename W = T>
+struct Table {
+    InstructionSet instruction_set;
+
+    // outputs[i] = dot(weights[i], inputs) + biases[i] for every row i.
+    void (*dense)(const W* weights, size_t stride, size_t rows, size_t columns, const T* inputs, const T* biases,
+                  T* outputs);
+
+    // The same for a batch of samples, one per row of `inputs` and `outputs`:
+    // outputs[s][i] = dot(weights[i], inputs[s]) + biases[i].
+    void (*dense_batch)(const W* weights, size_t stride, size_t rows, size_t columns, const T* inputs,
+                        size_t inputs_stride, size_t samples, const T* biases, T* outputs, size_t outputs_stride);
+
+    // The same for sparse inputs, given as `count` indices and values, with the weights stored transposed
+    // (one row per input): outputs[i] = biases[i] + sum over k of columns[indices[k]][i] * values[k].
+    // The outputs may be the biases themselves, to add the columns to sums computed before.
+    void (*sparse_dense)(const W* columns, size_t stride, size_t rows, const size_t* indices, const T* values,
+                         size_t count, const T* biases, T* outputs);
+
+    // The same for sparse weights, stored as a compressed sparse row matrix: the non-zero weights of row i are
+    // values[k] in column indices[k] for k in [offsets[i], offsets[i + 1]), so that
+    // outputs[i] = biases[i] + sum over those k of values[k] * inputs[indices[k]].
+    void (*csr_dense)(const W* values, const std::uint32_t* indices, const std::uint32_t* offsets, size_t rows,
+                      const T* inputs, const T* biases, T* outputs);
+
+    // For every row i, in a single pass over the weights:
+    // input_errors += weights[i] * errors[i] (using the old weights, skipped if input_errors is null),
+    // weights[i] += inputs * scales[i].
+    void (*backward)(W* weights, size_t stride, size_t rows, size_t columns, const T* errors, const T* scales,
+                     const T* inputs, T* input_errors);
+
+    // The weight update of backward for sparse inputs, with the weights stored transposed like for sparse_dense:
+    // columns[indices[k]][i] += scales[i] * values[k]. The columns of zero inputs would not change anyway.
+    void (*sparse_update)(W* columns, size_t stride, size_t rows, const size_t* indices, const T* values, size_t count,
+                          const T* scales);
+
+    // Error propagation for a batch of samples:
+    // input_errors[s] += sum over i of weights[i] * errors[s][i].
+    void (*backward_batch)(const W* weights, size_t stride, size_t rows, size_t columns, const T* errors,
+                           size_t errors_stride, size_t samples, T* input_errors, size_t input_errors_stride);
+
+    // Gradient accumulation for a batch of samples:
+    // gradients[i] += sum over s of deltas[s][i] * inputs[s].
+    void (*accumulate)(T* gradients, size_t stride, size_t rows, size_t columns, const T* deltas,
+                       size_t deltas_stride, const T* inputs, size_t inputs_stride, size_t samples);
+
+    // weights[i] += gradients[i] * scale for every row i.
+    void (*update)(W* weights, size_t stride, size_t rows, size_t columns, const T* gradients,
+                   size_t gradients_stride, T scale);
+
+    // outputs[i] = max(outputs[i], inputs[i]) for every i.
+    void (*maximum)(T* outputs, const T* inputs, size_t count);
+
+    // values[i] = 0.5 * (tanh(values[i]) + 1) for every i, using one of the approximations.
+    void (*activate)(Activation approximation, T* values, size_t count);
+
+    // values[i] = exp(values[i] - m) / sum over j of exp(values[j] - m), with m the largest value so that none of the
+    // exponentials overflows. They are computed to a few units in the last place, see Exp in activation.h.
+    void (*softmax)(T* values, size_t count);
+
+    // Fused optimizer steps for every row i, with g = gradients[i] * gradient_scale.
+    // The optimizer state rows are laid out like the gradient rows.
+    // Momentum: velocities[i] = momentum * velocities[i] + g, weights[i] += rate * velocities[i],
+    // or with Nesterov's look-ahead weights[i] += rate * (momentum * velocities[i] + g).
+    void (*momentum_update)(W* weights, size_t stride, size_t rows, size_t columns, const T* gradients,
+                            size_t gradients_stride, T* velocities, T gradient_scale, T rate, T momentum,
+                            bool nesterov);
+
+    // Adam: moments[i] = beta1 * moments[i] + (1 - beta1) * g, squares[i] = beta2 * squares[i] + (1 - beta2) * g^2,
+    // weights[i] += rate * moments[i] / (sqrt(squares[i]) + epsilon). Bias correction is folded into the rate.
+    void (*adam_update)(W* weights, size_t stride, size_t rows, size_t columns, const T* gradients,
+                        size_t gradients_stride, T* moments, T* squares, T gradient_scale, T rate, T beta1, T beta2,
+                        T epsilon);
+};
+
+// What a layer computes from its sums, in place: the activation function with the given approximation, or the
+// softmax over all of them for the last layer of a network trained with the cross-entropy loss. Every network type
+// goes through this, so that they all compute the same outputs from the same sums.
+template <typename T, typename W>
+inline void ActivateLayer(const Table<T, W>& table, Activation activation, bool softmax, T* values, size_t count) {
+    if (softmax)
+        table.softmax(values, count);
+    else if (activation != Activation::Exact)
+        table.activate(activation, values, count);
+    else
+        for (size_t index = 0; index != count; ++index)
+            values[index] = T(0.5) * (std::tanh(values[index]) + 1);
+}
+
+// Integer routines of the quantized network.
+struct QuantizedTable {
+    InstructionSet instruction_set;
+
+    // outputs[i] = dot(weights[i], inputs) for every row i, computed exactly in 32-bit integers.
+    // Products are at most 2^15 in magnitude, so rows of up to 2^16 columns cannot overflow.
+    void (*dense)(const std::int8_t* weights, size_t stride, size_t rows, size_t columns, const std::uint8_t* inputs,
+                  std::int32_t* outputs);
+};
+
+const char* GetName(InstructionSet);
+const char* GetName(Activation);
+
+// Upper bound of the absolute error of the activation function computed with an approximation, for any input.
+double GetMaxError(Activation);
+
+// The cheapest way to compute the activation function with an absolute error of at most the given one.
+Activation SelectActivation(double);
+
+// Largest absolute error of the activation function computed with the given kernels, found by comparing them with
+// std::tanh over a dense grid spanning the whole range where tanh is not yet saturated.
+// It has to stay within GetMaxError, this is how the bounds are checked.
+template <typename T, typename W = T>
+double MeasureMaxError(const Table<T, W>&, Activation);
+
+// Speed of the batched kernels in GFLOP/s, each counting one multiply and one add per weight and sample.
+struct Throughput {
+    double forward;
+    double backward;
+    double accumulate;
+};
+
+// Run the batched kernels of a (rows x columns) layer on a batch of samples for a while, timing each of them.
+template <typename T, typename W = T>
+Throughput MeasureThroughput(const Table<T, W>&, size_t, size_t, size_t);
+
+bool IsSupported(InstructionSet);
+
+// The widest instruction set supported by both the build and the CPU, detected once on first use.
+InstructionSet GetBestInstructionSet();
+
+// Tables are available for <float>, <double> and <float, BFloat16>.
+template <typename T, typename W = T>
+const Table<T, W>& GetTable(InstructionSet);
+
+template <typename T, typename W = T>
+inline const Table<T, W>& GetTable() {
+    return GetTable<T, W>(GetBestInstructionSet());
+}
+
+const QuantizedTable& GetQuantizedTable(InstructionSet);
+
+inline const QuantizedTable& GetQuantizedTable() {
+    return GetQuantizedTable(GetBestInstructionSet());
+}
+
+// Instruction set specific tables, each defined in its own translation unit built with the matching compiler flags.
+template <typename T, typename W>
+const Table<T, W>& GetScalarTable();
+template <typename T, typename W>
+const Table<T, W>& GetSse2Table();
+template <typename T, typename W>
+const Table<T, W>& GetAvx2Table();
+template <typename T, typename W>
+const Table<T, W>& GetAvx512Table();
+
+const QuantizedTable& GetScalarQuantizedTable();
+const QuantizedTable& GetSse2QuantizedTable();
+const QuantizedTable& GetAvx2QuantizedTable();
+
+} // namespace Kernels
+} // namespace Neural
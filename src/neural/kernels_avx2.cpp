@@ -0,0 +1,142 @@
+#include <immintrin.h>
+
+#include "kernels_simd.h"
+
+namespace Neural {
+namespace Kernels {
+
+namespace {
+
+template <typename T>
+struct Avx2;
+
+template <>
+struct Avx2<float> {
+    using Scalar = float;
+    using Register = __m256;
+    static constexpr size_t width = 8;
+
+    static inline Register Zero() { return _mm256_setzero_ps(); }
+    static inline Register Set(Scalar x) { return _mm256_set1_ps(x); }
+    static inline Register Load(const Scalar* p) { return _mm256_loadu_ps(p); }
+    static inline void Store(Scalar* p, Register x) { _mm256_storeu_ps(p, x); }
+    static inline Register MulAdd(Register a, Register b, Register c) { return _mm256_fmadd_ps(a, b, c); }
+    static inline Register Add(Register a, Register b) { return _mm256_add_ps(a, b); }
+    static inline Register Mul(Register a, Register b) { return _mm256_mul_ps(a, b); }
+    static inline Register Div(Register a, Register b) { return _mm256_div_ps(a, b); }
+    static inline Register Min(Register a, Register b) { return _mm256_min_ps(a, b); }
+    static inline Register Max(Register a, Register b) { return _mm256_max_ps(a, b); }
+    static inline Register Sqrt(Register x) { return _mm256_sqrt_ps(x); }
+    static inline Register PowerOfTwo(Register k) {
+        return _mm256_castsi256_ps(
+            _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(k), _mm256_set1_epi32(127)), 23));
+    }
+    static inline Register Gather(const Scalar* p, const std::uint32_t* indices) {
+        // The masked form with every lane enabled, as GCC's unmasked one warns about its undefined source.
+        const __m256i offsets = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices));
+        return _mm256_mask_i32gather_ps(Zero(), p, offsets, _mm256_castsi256_ps(_mm256_set1_epi32(-1)), 4);
+    }
+    static inline Scalar Sum(Register x) {
+        __m128 half = _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+        half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+        return _mm_cvtss_f32(_mm_add_ss(half, _mm_shuffle_ps(half, half, 1)));
+    }
+
+    static inline Register Load(const BFloat16* p) {
+        __m256i bits = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        return _mm256_castsi256_ps(_mm256_slli_epi32(bits, 16));
+    }
+    static inline void Store(BFloat16* p, Register x) {
+        __m256i bits = _mm256_castps_si256(x);
+        __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+        bits = _mm256_srai_epi32(_mm256_add_epi32(bits, _mm256_add_epi32(lsb, _mm256_set1_epi32(0x7fff))), 16);
+        // Packing works within 128-bit lanes, gather the two useful quarters back together.
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(bits, bits), 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(packed));
+    }
+};
+
+template <>
+struct Avx2<double> {
+    using Scalar = double;
+    using Register = __m256d;
+    static constexpr size_t width = 4;
+
+    static inline Register Zero() { return _mm256_setzero_pd(); }
+    static inline Register Set(Scalar x) { return _mm256_set1_pd(x); }
+    static inline Register Load(const Scalar* p) { return _mm256_loadu_pd(p); }
+    static inline void Store(Scalar* p, Register x) { _mm256_storeu_pd(p, x); }
+    static inline Register MulAdd(Register a, Register b, Register c) { return _mm256_fmadd_pd(a, b, c); }
+    static inline Register Add(Register a, Register b) { return _mm256_add_pd(a, b); }
+    static inline Register Mul(Register a, Register b) { return _mm256_mul_pd(a, b); }
+    static inline Register Div(Register a, Register b) { return _mm256_div_pd(a, b); }
+    static inline Register Min(Register a, Register b) { return _mm256_min_pd(a, b); }
+    static inline Register Max(Register a, Register b) { return _mm256_max_pd(a, b); }
+    static inline Register Sqrt(Register x) { return _mm256_sqrt_pd(x); }
+    static inline Register PowerOfTwo(Register k) {
+        const __m128i exponents = _mm_add_epi32(_mm256_cvtpd_epi32(k), _mm_set1_epi32(1023));
+        return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_cvtepi32_epi64(exponents), 52));
+    }
+    static inline Register Gather(const Scalar* p, const std::uint32_t* indices) {
+        const __m128i offsets = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices));
+        return _mm256_mask_i32gather_pd(Zero(), p, offsets, _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+    }
+    static inline Scalar Sum(Register x) {
+        __m128d half = _mm_add_pd(_mm256_castpd256_pd128(x), _mm256_extractf128_pd(x, 1));
+        return _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+    }
+};
+
+// Bytes are widened to 16 bits and multiplied with vpmaddwd, which unlike vpmaddubsw never saturates.
+// Four rows are processed at once, so every widened input vector is reused four times.
+void QuantizedDense(const std::int8_t* weights, size_t stride, size_t rows, size_t columns, const std::uint8_t* inputs,
+                    std::int32_t* outputs) {
+    constexpr size_t width = 16;
+    constexpr size_t row_block = 4;
+    const size_t vector_columns = columns - columns % width;
+
+    for (size_t first_row = 0; first_row < rows; first_row += row_block) {
+        const size_t block_rows = rows - first_row < row_block ? rows - first_row : row_block;
+        __m256i sums[row_block];
+        for (size_t row = 0; row != row_block; ++row)
+            sums[row] = _mm256_setzero_si256();
+        for (size_t column = 0; column != vector_columns; column += width) {
+            const __m256i x =
+                _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(inputs + column)));
+            for (size_t row = 0; row != block_rows; ++row) {
+                const __m256i w = _mm256_cvtepi8_epi16(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + (first_row + row) * stride + column)));
+                sums[row] = _mm256_add_epi32(sums[row], _mm256_madd_epi16(x, w));
+            }
+        }
+        for (size_t row = 0; row != block_rows; ++row) {
+            __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(sums[row]), _mm256_extracti128_si256(sums[row], 1));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+            std::int32_t result = _mm_cvtsi128_si32(sum);
+            const std::int8_t* row_weights = weights + (first_row + row) * stride;
+            for (size_t column = vector_columns; column != columns; ++column)
+                result += static_cast<std::int32_t>(inputs[column]) * row_weights[column];
+            outputs[first_row + row] = result;
+        }
+    }
+}
+
+} // namespace
+
+const QuantizedTable& GetAvx2QuantizedTable() {
+    static const QuantizedTable table = {InstructionSet::Avx2, QuantizedDense};
+    return table;
+}
+
+template <typename T, typename W>
+const Table<T, W>& GetAvx2Table() {
+    return Simd<Avx2<T>, W>::GetTable(InstructionSet::Avx2);
+}
+
+template const Table<float, float>& GetAvx2Table<float, float>();
+template const Table<double, double>& GetAvx2Table<double, double>();
+template const Table<float, BFloat16>& GetAvx2Table<float, BFloat16>();
+
+} // namespace Kernels
+} // namespace Neural
@@ -0,0 +1,90 @@
+#include <immintrin.h>
+
+#include "kernels_simd.h"
+
+namespace Neural {
+namespace Kernels {
+
+namespace {
+
+template <typename T>
+struct Avx512;
+
+template <>
+struct Avx512<float> {
+    using Scalar = float;
+    using Register = __m512;
+    static constexpr size_t width = 16;
+
+    static inline Register Zero() { return _mm512_setzero_ps(); }
+    static inline Register Set(Scalar x) { return _mm512_set1_ps(x); }
+    static inline Register Load(const Scalar* p) { return _mm512_loadu_ps(p); }
+    static inline void Store(Scalar* p, Register x) { _mm512_storeu_ps(p, x); }
+    static inline Register MulAdd(Register a, Register b, Register c) { return _mm512_fmadd_ps(a, b, c); }
+    static inline Register Add(Register a, Register b) { return _mm512_add_ps(a, b); }
+    static inline Register Mul(Register a, Register b) { return _mm512_mul_ps(a, b); }
+    static inline Register Div(Register a, Register b) { return _mm512_div_ps(a, b); }
+    static inline Register Min(Register a, Register b) { return _mm512_min_ps(a, b); }
+    static inline Register Max(Register a, Register b) { return _mm512_max_ps(a, b); }
+    static inline Register Sqrt(Register x) { return _mm512_sqrt_ps(x); }
+    static inline Register PowerOfTwo(Register k) {
+        return _mm512_castsi512_ps(
+            _mm512_slli_epi32(_mm512_add_epi32(_mm512_cvtps_epi32(k), _mm512_set1_epi32(127)), 23));
+    }
+    static inline Register Gather(const Scalar* p, const std::uint32_t* indices) {
+        return _mm512_i32gather_ps(_mm512_loadu_si512(indices), p, 4);
+    }
+    static inline Scalar Sum(Register x) { return _mm512_reduce_add_ps(x); }
+
+    static inline Register Load(const BFloat16* p) {
+        __m512i bits = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+        return _mm512_castsi512_ps(_mm512_slli_epi32(bits, 16));
+    }
+    static inline void Store(BFloat16* p, Register x) {
+        __m512i bits = _mm512_castps_si512(x);
+        __m512i lsb = _mm512_and_si512(_mm512_srli_epi32(bits, 16), _mm512_set1_epi32(1));
+        bits = _mm512_srli_epi32(_mm512_add_epi32(bits, _mm512_add_epi32(lsb, _mm512_set1_epi32(0x7fff))), 16);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm512_cvtepi32_epi16(bits));
+    }
+};
+
+template <>
+struct Avx512<double> {
+    using Scalar = double;
+    using Register = __m512d;
+    static constexpr size_t width = 8;
+
+    static inline Register Zero() { return _mm512_setzero_pd(); }
+    static inline Register Set(Scalar x) { return _mm512_set1_pd(x); }
+    static inline Register Load(const Scalar* p) { return _mm512_loadu_pd(p); }
+    static inline void Store(Scalar* p, Register x) { _mm512_storeu_pd(p, x); }
+    static inline Register MulAdd(Register a, Register b, Register c) { return _mm512_fmadd_pd(a, b, c); }
+    static inline Register Add(Register a, Register b) { return _mm512_add_pd(a, b); }
+    static inline Register Mul(Register a, Register b) { return _mm512_mul_pd(a, b); }
+    static inline Register Div(Register a, Register b) { return _mm512_div_pd(a, b); }
+    static inline Register Min(Register a, Register b) { return _mm512_min_pd(a, b); }
+    static inline Register Max(Register a, Register b) { return _mm512_max_pd(a, b); }
+    static inline Register Sqrt(Register x) { return _mm512_sqrt_pd(x); }
+    static inline Register PowerOfTwo(Register k) {
+        const __m256i exponents = _mm256_add_epi32(_mm512_cvtpd_epi32(k), _mm256_set1_epi32(1023));
+        return _mm512_castsi512_pd(_mm512_slli_epi64(_mm512_cvtepi32_epi64(exponents), 52));
+    }
+    static inline Register Gather(const Scalar* p, const std::uint32_t* indices) {
+        return _mm512_i32gather_pd(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices)), p, 8);
+    }
+    static inline Scalar Sum(Register x) { return _mm512_reduce_add_pd(x); }
+};
+
+} // namespace
+
+template <typename T, typename W>
+const Table<T, W>& GetAvx512Table() {
+    return Simd<Avx512<T>, W>::GetTable(InstructionSet::Avx512);
+}
+
+template const Table<float, float>& GetAvx512Table<float, float>();
+template const Table<double, double>& GetAvx512Table<double, double>();
+template const Table<float, BFloat16>& GetAvx512Table<float, BFloat16>();
+
+} // namespace Kernels
+} // namespace Neural
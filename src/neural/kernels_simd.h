@@ -0,0 +1,578 @@
+#pragma once
+
+// Generic vectorized kernel bodies, parameterized by a register traits type `V` providing:
+//     Scalar, Register, width, Zero(), Set(Scalar), MulAdd(a, b, c) = a * b + c, Sum(Register),
+//     Add, Mul, Div, Min, Max, Sqrt (element-wise, for the activation approximations and the optimizers),
+//     PowerOfTwo(k) = 2^k for integral k within the range of normal numbers, for the exponential,
+//     Load(const W*) and Store(W*, Register) for every supported weight storage type W,
+//     Gather(const Scalar* p, const std::uint32_t* indices) loading p[indices[i]] into every lane i.
+//
+// Only include this from the instruction set specific translation units (kernels_*.cpp).
+// Those are compiled with extended instruction sets, so the code here must not call inline functions shared with
+// the rest of the program: the linker is free to keep the copy built with, say, AVX-512 and use it everywhere.
+// Everything lives in an anonymous namespace for the same reason, and BFloat16 conversions are spelled out here
+// rather than going through its inline operators.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#include "activation.h"
+#include "bfloat16.h"
+#include "kernels.h"
+#include "matrix.h"
+
+namespace Neural {
+namespace Kernels {
+namespace {
+
+template <typename T>
+inline T LoadScalar(const T* pointer) {
+    return *pointer;
+}
+
+inline float LoadScalar(const BFloat16* pointer) {
+    std::uint32_t bits = static_cast<std::uint32_t>(pointer->bits) << 16;
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+template <typename T>
+inline void StoreScalar(T* pointer, T value) {
+    *pointer = value;
+}
+
+inline void StoreScalar(BFloat16* pointer, float value) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    bits += 0x7fff + ((bits >> 16) & 1);
+    pointer->bits = static_cast<std::uint16_t>(bits >> 16);
+}
+
+// Cache-blocked matrix multiplication C += A * B behind the batched kernels.
+// The loops follow the usual GotoBLAS / BLIS structure. B is copied in (kc x nc) blocks that stay in L3 and A in
+// (mc x kc) blocks that stay in L2, both rearranged into the order the micro-kernel reads them. The micro-kernel
+// keeps an (mr x nr) tile of C in registers while streaming an mr-wide sliver of A and an nr-wide sliver of B out
+// of L1. Packing also converts the weight storage type and makes transposed operands contiguous, so the same code
+// serves the forward pass (X * W^T), error propagation (E * W) and gradient accumulation (D^T * X).
+template <typename V>
+struct PackedGemm {
+    using T = typename V::Scalar;
+    using R = typename V::Register;
+    static constexpr size_t width = V::width;
+    // Register tile: mr broadcast values of A times two registers of B, which leaves room in 16 registers.
+    static constexpr size_t mr = 6;
+    static constexpr size_t nr = 2 * width;
+    // Cache blocks: an (kc x nr) sliver of B fits L1, an (mc x kc) block of A fits L2, a (kc x nc) block of B fits L3.
+    static constexpr size_t kc = 256;
+    static constexpr size_t mc = 16 * mr;
+    static constexpr size_t nc = 1024;
+    static_assert(nc % nr == 0);
+
+    // Packing space of the calling thread, allocated on first use and kept until the thread exits.
+    struct Buffer {
+        T* data = nullptr;
+
+        ~Buffer() {
+            if (data)
+                ::operator delete(data, std::align_val_t(cache_line_size));
+        }
+
+        T* Get(size_t count) {
+            if (!data)
+                data = static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(cache_line_size)));
+            return data;
+        }
+    };
+
+    // C[i][j] += sum over p of A[i][p] * B[p][j] for an (m x n) matrix C, where A[i][p] is
+    // a[i * a_row_stride + p * a_column_stride] and B[p][j] is b[p * b_row_stride + j * b_column_stride].
+    template <typename A, typename B>
+    static void Multiply(size_t m, size_t n, size_t k, const A* a, size_t a_row_stride, size_t a_column_stride,
+                         const B* b, size_t b_row_stride, size_t b_column_stride, T* c, size_t c_stride) {
+        static thread_local Buffer a_buffer;
+        static thread_local Buffer b_buffer;
+        T* a_pack = a_buffer.Get(mc * kc);
+        T* b_pack = b_buffer.Get(kc * nc);
+
+        for (size_t j = 0; j < n; j += nc) {
+            const size_t n_block = n - j < nc ? n - j : nc;
+            for (size_t p = 0; p < k; p += kc) {
+                const size_t k_block = k - p < kc ? k - p : kc;
+                PackB(b + p * b_row_stride + j * b_column_stride, b_row_stride, b_column_stride, k_block, n_block,
+                      b_pack);
+                for (size_t i = 0; i < m; i += mc) {
+                    const size_t m_block = m - i < mc ? m - i : mc;
+                    PackA(a + i * a_row_stride + p * a_column_stride, a_row_stride, a_column_stride, m_block, k_block,
+                          a_pack);
+                    for (size_t jr = 0; jr < n_block; jr += nr) {
+                        const size_t columns = n_block - jr < nr ? n_block - jr : nr;
+                        for (size_t ir = 0; ir < m_block; ir += mr) {
+                            const size_t rows = m_block - ir < mr ? m_block - ir : mr;
+                            MicroKernel(k_block, a_pack + ir * k_block, b_pack + jr * k_block,
+                                        c + (i + ir) * c_stride + j + jr, c_stride, rows, columns);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Rearrange an (m x k) block of A into slivers of mr rows, column after column, padding the last one with zeros.
+    template <typename A>
+    static void PackA(const A* a, size_t row_stride, size_t column_stride, size_t m, size_t k, T* pack) {
+        for (size_t i = 0; i < m; i += mr) {
+            const size_t rows = m - i < mr ? m - i : mr;
+            T* sliver = pack + i * k;
+            for (size_t row = 0; row != rows; ++row) {
+                const A* source = a + (i + row) * row_stride;
+                for (size_t p = 0; p != k; ++p)
+                    sliver[p * mr + row] = LoadScalar(source + p * column_stride);
+            }
+            for (size_t row = rows; row != mr; ++row)
+                for (size_t p = 0; p != k; ++p)
+                    sliver[p * mr + row] = 0;
+        }
+    }
+
+    // Rearrange a (k x n) block of B into slivers of nr columns, row after row, padding the last one with zeros.
+    template <typename B>
+    static void PackB(const B* b, size_t row_stride, size_t column_stride, size_t k, size_t n, T* pack) {
+        for (size_t j = 0; j < n; j += nr) {
+            const size_t columns = n - j < nr ? n - j : nr;
+            T* sliver = pack + j * k;
+            if (column_stride == 1 && columns == nr) {
+                // Rows of B are contiguous, copy them a register at a time.
+                for (size_t p = 0; p != k; ++p) {
+                    const B* source = b + p * row_stride + j;
+                    V::Store(sliver + p * nr, V::Load(source));
+                    V::Store(sliver + p * nr + width, V::Load(source + width));
+                }
+                continue;
+            }
+            for (size_t column = 0; column != columns; ++column) {
+                const B* source = b + (j + column) * column_stride;
+                for (size_t p = 0; p != k; ++p)
+                    sliver[p * nr + column] = LoadScalar(source + p * row_stride);
+            }
+            for (size_t column = columns; column != nr; ++column)
+                for (size_t p = 0; p != k; ++p)
+                    sliver[p * nr + column] = 0;
+        }
+    }
+
+    // One rank-1 update of the register tile, spelled out per row so that it stays in registers without unrolling.
+    template <size_t... Rows>
+    static inline void Step(const T* a, R b0, R b1, R (&sums)[mr][2], std::index_sequence<Rows...>) {
+        ((sums[Rows][0] = V::MulAdd(V::Set(a[Rows]), b0, sums[Rows][0]),
+          sums[Rows][1] = V::MulAdd(V::Set(a[Rows]), b1, sums[Rows][1])),
+         ...);
+    }
+
+    // Add the product of an mr-row sliver of A and an nr-column sliver of B to the top left (rows x columns) of C.
+    static inline void MicroKernel(size_t k, const T* a, const T* b, T* c, size_t c_stride, size_t rows,
+                                   size_t columns) {
+        R sums[mr][2];
+        for (size_t row = 0; row != mr; ++row)
+            sums[row][0] = sums[row][1] = V::Zero();
+
+        for (size_t p = 0; p != k; ++p) {
+            Step(a, V::Load(b), V::Load(b + width), sums, std::make_index_sequence<mr>());
+            a += mr;
+            b += nr;
+        }
+
+        if (rows == mr && columns == nr) {
+            for (size_t row = 0; row != mr; ++row) {
+                T* y = c + row * c_stride;
+                V::Store(y, V::Add(V::Load(y), sums[row][0]));
+                V::Store(y + width, V::Add(V::Load(y + width), sums[row][1]));
+            }
+            return;
+        }
+
+        // Partial tile at the bottom or right edge of C.
+        alignas(cache_line_size) T tile[mr * nr];
+        for (size_t row = 0; row != mr; ++row) {
+            V::Store(tile + row * nr, sums[row][0]);
+            V::Store(tile + row * nr + width, sums[row][1]);
+        }
+        for (size_t row = 0; row != rows; ++row)
+            for (size_t column = 0; column != columns; ++column)
+                c[row * c_stride + column] += tile[row * nr + column];
+    }
+};
+
+template <typename V, typename W>
+struct Simd {
+    using T = typename V::Scalar;
+    using R = typename V::Register;
+    static constexpr size_t width = V::width;
+    // Rows processed at once, each loaded input register is reused this many times.
+    static constexpr size_t row_block = 4;
+
+    // Computes a (Rows x Samples) block of dot products plus biases, keeping every sum in a register.
+    template <size_t Rows, size_t Samples>
+    static inline void Block(const W* weights, size_t stride, size_t columns, const T* inputs, size_t inputs_stride,
+                             const T* biases, T* outputs, size_t outputs_stride) {
+        const size_t vector_columns = columns - columns % width;
+
+        R sums[Rows][Samples];
+        for (size_t row = 0; row != Rows; ++row)
+            for (size_t sample = 0; sample != Samples; ++sample)
+                sums[row][sample] = V::Zero();
+
+        for (size_t column = 0; column != vector_columns; column += width) {
+            R x[Samples];
+            for (size_t sample = 0; sample != Samples; ++sample)
+                x[sample] = V::Load(inputs + sample * inputs_stride + column);
+            for (size_t row = 0; row != Rows; ++row) {
+                const R w = V::Load(weights + row * stride + column);
+                for (size_t sample = 0; sample != Samples; ++sample)
+                    sums[row][sample] = V::MulAdd(w, x[sample], sums[row][sample]);
+            }
+        }
+
+        for (size_t row = 0; row != Rows; ++row) {
+            const W* w = weights + row * stride;
+            for (size_t sample = 0; sample != Samples; ++sample) {
+                const T* x = inputs + sample * inputs_stride;
+                T sum = V::Sum(sums[row][sample]);
+                for (size_t column = vector_columns; column != columns; ++column)
+                    sum += LoadScalar(w + column) * x[column];
+                outputs[sample * outputs_stride + row] = sum + biases[row];
+            }
+        }
+    }
+
+    static void Dense(const W* weights, size_t stride, size_t rows, size_t columns, const T* inputs, const T* biases,
+                      T* outputs) {
+        size_t row = 0;
+        for (; row + row_block <= rows; row += row_block)
+            Block<row_block, 1>(weights + row * stride, stride, columns, inputs, 0, biases + row, outputs + row, 0);
+        for (; row != rows; ++row)
+            Block<1, 1>(weights + row * stride, stride, columns, inputs, 0, biases + row, outputs + row, 0);
+    }
+
+    static void DenseBatch(const W* weights, size_t stride, size_t rows, size_t columns, const T* inputs,
+                           size_t inputs_stride, size_t samples, const T* biases, T* outputs, size_t outputs_stride) {
+        // Layers narrower than a register tile would leave most of it idle, dot products do better there.
+        if (rows < PackedGemm<V>::nr) {
+            for (size_t sample = 0; sample != samples; ++sample)
+                Dense(weights, stride, rows, columns, inputs + sample * inputs_stride, biases,
+                      outputs + sample * outputs_stride);
+            return;
+        }
+        for (size_t sample = 0; sample != samples; ++sample)
+            std::memcpy(outputs + sample * outputs_stride, biases, rows * sizeof(T));
+        PackedGemm<V>::Multiply(samples, rows, columns, inputs, inputs_stride, 1, weights, 1, stride, outputs,
+                                outputs_stride);
+    }
+
+    // Keeps a block of Registers * width outputs in registers while adding up the columns of every non-zero input.
+    // Narrow blocks alternate between two sets of sums, otherwise every addition waits for the previous one.
+    template <size_t Registers>
+    static inline void SparseBlock(const W* columns, size_t stride, const size_t* indices, const T* values,
+                                   size_t count, const T* biases, T* outputs) {
+        constexpr size_t sets = Registers < 4 ? 2 : 1;
+        R sums[sets][Registers];
+        for (size_t r = 0; r != Registers; ++r) {
+            sums[0][r] = V::Load(biases + r * width);
+            for (size_t set = 1; set < sets; ++set)
+                sums[set][r] = V::Zero();
+        }
+        size_t index = 0;
+        for (; index + sets <= count; index += sets) {
+            for (size_t set = 0; set != sets; ++set) {
+                const W* column = columns + indices[index + set] * stride;
+                const R value = V::Set(values[index + set]);
+                for (size_t r = 0; r != Registers; ++r)
+                    sums[set][r] = V::MulAdd(V::Load(column + r * width), value, sums[set][r]);
+            }
+        }
+        // At most one input is left over from the pairs.
+        if (index < count) {
+            const W* column = columns + indices[index] * stride;
+            const R value = V::Set(values[index]);
+            for (size_t r = 0; r != Registers; ++r)
+                sums[0][r] = V::MulAdd(V::Load(column + r * width), value, sums[0][r]);
+        }
+        for (size_t set = 1; set < sets; ++set)
+            for (size_t r = 0; r != Registers; ++r)
+                sums[0][r] = V::Add(sums[0][r], sums[set][r]);
+        for (size_t r = 0; r != Registers; ++r)
+            V::Store(outputs + r * width, sums[0][r]);
+    }
+
+    static void SparseDense(const W* columns, size_t stride, size_t rows, const size_t* indices, const T* values,
+                            size_t count, const T* biases, T* outputs) {
+        constexpr size_t registers_block = 4;
+        size_t row = 0;
+        for (; row + registers_block * width <= rows; row += registers_block * width)
+            SparseBlock<registers_block>(columns + row, stride, indices, values, count, biases + row, outputs + row);
+        // The rest in one pass over the inputs rather than one per register.
+        switch ((rows - row) / width) {
+        case 3:
+            SparseBlock<3>(columns + row, stride, indices, values, count, biases + row, outputs + row);
+            row += 3 * width;
+            break;
+        case 2:
+            SparseBlock<2>(columns + row, stride, indices, values, count, biases + row, outputs + row);
+            row += 2 * width;
+            break;
+        case 1:
+            SparseBlock<1>(columns + row, stride, indices, values, count, biases + row, outputs + row);
+            row += width;
+            break;
+        }
+        for (; row != rows; ++row) {
+            T sum = biases[row];
+            for (size_t index = 0; index != count; ++index)
+                sum += LoadScalar(columns + indices[index] * stride + row) * values[index];
+            outputs[row] = sum;
+        }
+    }
+
+    // Two accumulators keep two gathers in flight, each row is usually only a few registers long.
+    static void CsrDense(const W* values, const std::uint32_t* indices, const std::uint32_t* offsets, size_t rows,
+                         const T* inputs, const T* biases, T* outputs) {
+        for (size_t row = 0; row != rows; ++row) {
+            const size_t last = offsets[row + 1];
+            size_t index = offsets[row];
+            R sum0 = V::Zero();
+            R sum1 = V::Zero();
+            for (; index + 2 * width <= last; index += 2 * width) {
+                sum0 = V::MulAdd(V::Load(values + index), V::Gather(inputs, indices + index), sum0);
+                sum1 = V::MulAdd(V::Load(values + index + width), V::Gather(inputs, indices + index + width), sum1);
+            }
+            if (index + width <= last) {
+                sum0 = V::MulAdd(V::Load(values + index), V::Gather(inputs, indices + index), sum0);
+                index += width;
+            }
+            // The tail can be as long as the vectorized part, split it too so that it is not one long dependency chain.
+            T tail0 = 0;
+            T tail1 = 0;
+            for (; index + 2 <= last; index += 2) {
+                tail0 += LoadScalar(values + index) * inputs[indices[index]];
+                tail1 += LoadScalar(values + index + 1) * inputs[indices[index + 1]];
+            }
+            if (index != last)
+                tail0 += LoadScalar(values + index) * inputs[indices[index]];
+            outputs[row] = biases[row] + V::Sum(V::Add(sum0, sum1)) + (tail0 + tail1);
+        }
+    }
+
+    static void Backward(W* weights, size_t stride, size_t rows, size_t columns, const T* errors, const T* scales,
+                         const T* inputs, T* input_errors) {
+        const size_t vector_columns = columns - columns % width;
+
+        for (size_t row = 0; row != rows; ++row) {
+            W* w = weights + row * stride;
+            const R error = V::Set(errors[row]);
+            const R scale = V::Set(scales[row]);
+            if (input_errors) {
+                for (size_t column = 0; column != vector_columns; column += width) {
+                    const R weight = V::Load(w + column);
+                    V::Store(input_errors + column, V::MulAdd(weight, error, V::Load(input_errors + column)));
+                    V::Store(w + column, V::MulAdd(V::Load(inputs + column), scale, weight));
+                }
+                for (size_t column = vector_columns; column != columns; ++column) {
+                    const T weight = LoadScalar(w + column);
+                    input_errors[column] += weight * errors[row];
+                    StoreScalar(w + column, weight + scales[row] * inputs[column]);
+                }
+            } else {
+                for (size_t column = 0; column != vector_columns; column += width)
+                    V::Store(w + column, V::MulAdd(V::Load(inputs + column), scale, V::Load(w + column)));
+                for (size_t column = vector_columns; column != columns; ++column)
+                    StoreScalar(w + column, LoadScalar(w + column) + scales[row] * inputs[column]);
+            }
+        }
+    }
+
+    static void SparseUpdate(W* columns, size_t stride, size_t rows, const size_t* indices, const T* values,
+                             size_t count, const T* scales) {
+        const size_t vector_rows = rows - rows % width;
+
+        for (size_t index = 0; index != count; ++index) {
+            W* column = columns + indices[index] * stride;
+            const R value = V::Set(values[index]);
+            for (size_t row = 0; row != vector_rows; row += width)
+                V::Store(column + row, V::MulAdd(V::Load(scales + row), value, V::Load(column + row)));
+            for (size_t row = vector_rows; row != rows; ++row)
+                StoreScalar(column + row, LoadScalar(column + row) + scales[row] * values[index]);
+        }
+    }
+
+    static void BackwardBatch(const W* weights, size_t stride, size_t rows, size_t columns, const T* errors,
+                              size_t errors_stride, size_t samples, T* input_errors, size_t input_errors_stride) {
+        PackedGemm<V>::Multiply(samples, columns, rows, errors, errors_stride, 1, weights, stride, 1, input_errors,
+                                input_errors_stride);
+    }
+
+    static void Accumulate(T* gradients, size_t stride, size_t rows, size_t columns, const T* deltas,
+                           size_t deltas_stride, const T* inputs, size_t inputs_stride, size_t samples) {
+        PackedGemm<V>::Multiply(rows, columns, samples, deltas, 1, deltas_stride, inputs, inputs_stride, 1, gradients,
+                                stride);
+    }
+
+    static void Update(W* weights, size_t stride, size_t rows, size_t columns, const T* gradients,
+                       size_t gradients_stride, T scale) {
+        const size_t vector_columns = columns - columns % width;
+        const R s = V::Set(scale);
+
+        for (size_t row = 0; row != rows; ++row) {
+            W* w = weights + row * stride;
+            const T* g = gradients + row * gradients_stride;
+            for (size_t column = 0; column != vector_columns; column += width)
+                V::Store(w + column, V::MulAdd(V::Load(g + column), s, V::Load(w + column)));
+            for (size_t column = vector_columns; column != columns; ++column)
+                StoreScalar(w + column, LoadScalar(w + column) + g[column] * scale);
+        }
+    }
+
+    static void Maximum(T* outputs, const T* inputs, size_t count) {
+        const size_t vector_count = count - count % width;
+        for (size_t index = 0; index != vector_count; index += width)
+            V::Store(outputs + index, V::Max(V::Load(outputs + index), V::Load(inputs + index)));
+        for (size_t index = vector_count; index != count; ++index)
+            outputs[index] = inputs[index] > outputs[index] ? inputs[index] : outputs[index];
+    }
+
+    static void MomentumUpdate(W* weights, size_t stride, size_t rows, size_t columns, const T* gradients,
+                               size_t gradients_stride, T* velocities, T gradient_scale, T rate, T momentum,
+                               bool nesterov) {
+        const size_t vector_columns = columns - columns % width;
+        const R s = V::Set(gradient_scale);
+        const R r = V::Set(rate);
+        const R mu = V::Set(momentum);
+
+        for (size_t row = 0; row != rows; ++row) {
+            W* w = weights + row * stride;
+            const T* g = gradients + row * gradients_stride;
+            T* v = velocities + row * gradients_stride;
+            for (size_t column = 0; column != vector_columns; column += width) {
+                const R gradient = V::Mul(V::Load(g + column), s);
+                const R velocity = V::MulAdd(V::Load(v + column), mu, gradient);
+                V::Store(v + column, velocity);
+                const R step = nesterov ? V::MulAdd(velocity, mu, gradient) : velocity;
+                V::Store(w + column, V::MulAdd(step, r, V::Load(w + column)));
+            }
+            for (size_t column = vector_columns; column != columns; ++column) {
+                const T gradient = g[column] * gradient_scale;
+                const T velocity = momentum * v[column] + gradient;
+                v[column] = velocity;
+                const T step = nesterov ? momentum * velocity + gradient : velocity;
+                StoreScalar(w + column, LoadScalar(w + column) + rate * step);
+            }
+        }
+    }
+
+    static void AdamUpdate(W* weights, size_t stride, size_t rows, size_t columns, const T* gradients,
+                           size_t gradients_stride, T* moments, T* squares, T gradient_scale, T rate, T beta1,
+                           T beta2, T epsilon) {
+        const size_t vector_columns = columns - columns % width;
+        const R s = V::Set(gradient_scale);
+        const R r = V::Set(rate);
+        const R b1 = V::Set(beta1);
+        const R b2 = V::Set(beta2);
+        const R one_minus_b1 = V::Set(1 - beta1);
+        const R one_minus_b2 = V::Set(1 - beta2);
+        const R e = V::Set(epsilon);
+
+        for (size_t row = 0; row != rows; ++row) {
+            W* w = weights + row * stride;
+            const T* g = gradients + row * gradients_stride;
+            T* m = moments + row * gradients_stride;
+            T* q = squares + row * gradients_stride;
+            for (size_t column = 0; column != vector_columns; column += width) {
+                const R gradient = V::Mul(V::Load(g + column), s);
+                const R moment = V::MulAdd(V::Load(m + column), b1, V::Mul(gradient, one_minus_b1));
+                const R square = V::MulAdd(V::Load(q + column), b2, V::Mul(V::Mul(gradient, gradient), one_minus_b2));
+                V::Store(m + column, moment);
+                V::Store(q + column, square);
+                const R step = V::Div(moment, V::Add(V::Sqrt(square), e));
+                V::Store(w + column, V::MulAdd(step, r, V::Load(w + column)));
+            }
+            for (size_t column = vector_columns; column != columns; ++column) {
+                const T gradient = g[column] * gradient_scale;
+                const T moment = beta1 * m[column] + (1 - beta1) * gradient;
+                const T square = beta2 * q[column] + (1 - beta2) * gradient * gradient;
+                m[column] = moment;
+                q[column] = square;
+                StoreScalar(w + column,
+                            LoadScalar(w + column) + rate * moment / (ScalarOps<T>::Sqrt(square) + epsilon));
+            }
+        }
+    }
+
+    template <R (*Tanh)(R), T (*ScalarTanh)(T)>
+    static inline void Activate(T* values, size_t count) {
+        const size_t vector_count = count - count % width;
+        const R half = V::Set(T(0.5));
+        for (size_t index = 0; index != vector_count; index += width)
+            V::Store(values + index, V::MulAdd(Tanh(V::Load(values + index)), half, half));
+        for (size_t index = vector_count; index != count; ++index)
+            values[index] = ScalarTanh(values[index]) * T(0.5) + T(0.5);
+    }
+
+    static void Activate(Activation approximation, T* values, size_t count) {
+        if (approximation == Activation::Fast)
+            Activate<FastTanh<V>, FastTanh<ScalarOps<T>>>(values, count);
+        else
+            Activate<PreciseTanh<V>, PreciseTanh<ScalarOps<T>>>(values, count);
+    }
+
+    // One pass for the largest value, one for the exponentials and their sum, and one dividing them by it.
+    static void Softmax(T* values, size_t count) {
+        const size_t vector_count = count - count % width;
+        T max_value = values[0];
+        if (vector_count != 0) {
+            R maximum = V::Load(values);
+            for (size_t index = width; index != vector_count; index += width)
+                maximum = V::Max(maximum, V::Load(values + index));
+            alignas(64) T lanes[width];
+            V::Store(lanes, maximum);
+            for (size_t lane = 0; lane != width; ++lane)
+                max_value = lanes[lane] > max_value ? lanes[lane] : max_value;
+        }
+        for (size_t index = vector_count; index != count; ++index)
+            max_value = values[index] > max_value ? values[index] : max_value;
+
+        const R shift = V::Set(-max_value);
+        R sums = V::Zero();
+        for (size_t index = 0; index != vector_count; index += width) {
+            const R exponential = Exp<V>(V::Add(V::Load(values + index), shift));
+            V::Store(values + index, exponential);
+            sums = V::Add(sums, exponential);
+        }
+        T sum = V::Sum(sums);
+        for (size_t index = vector_count; index != count; ++index) {
+            values[index] = Exp<ScalarOps<T>>(values[index] - max_value);
+            sum += values[index];
+        }
+
+        const T scale = 1 / sum;
+        const R scales = V::Set(scale);
+        for (size_t index = 0; index != vector_count; index += width)
+            V::Store(values + index, V::Mul(V::Load(values + index), scales));
+        for (size_t index = vector_count; index != count; ++index)
+            values[index] *= scale;
+    }
+
+    static const Table<T, W>& GetTable(InstructionSet instruction_set) {
+        static const Table<T, W> table = {
+            instruction_set, Dense,      DenseBatch, SparseDense, CsrDense, Backward, SparseUpdate,
+            BackwardBatch,   Accumulate, Update,     Maximum,     Activate, Softmax,  MomentumUpdate,
+            AdamUpdate,
+        };
+        return table;
+    }
+};
+
+} // namespace
+} // namespace Kernels
+} // namespace Neural
@@ -0,0 +1,136 @@
+#include <emmintrin.h>
+
+#include "kernels_simd.h"
+
+namespace Neural {
+namespace Kernels {
+
+namespace {
+
+template <typename T>
+struct Sse2;
+
+template <>
+struct Sse2<float> {
+    using Scalar = float;
+    using Register = __m128;
+    static constexpr size_t width = 4;
+
+    static inline Register Zero() { return _mm_setzero_ps(); }
+    static inline Register Set(Scalar x) { return _mm_set1_ps(x); }
+    static inline Register Load(const Scalar* p) { return _mm_loadu_ps(p); }
+    static inline void Store(Scalar* p, Register x) { _mm_storeu_ps(p, x); }
+    static inline Register MulAdd(Register a, Register b, Register c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static inline Register Add(Register a, Register b) { return _mm_add_ps(a, b); }
+    static inline Register Mul(Register a, Register b) { return _mm_mul_ps(a, b); }
+    static inline Register Div(Register a, Register b) { return _mm_div_ps(a, b); }
+    static inline Register Min(Register a, Register b) { return _mm_min_ps(a, b); }
+    static inline Register Max(Register a, Register b) { return _mm_max_ps(a, b); }
+    static inline Register Sqrt(Register x) { return _mm_sqrt_ps(x); }
+    static inline Register PowerOfTwo(Register k) {
+        return _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(k), _mm_set1_epi32(127)), 23));
+    }
+    static inline Register Gather(const Scalar* p, const std::uint32_t* indices) {
+        return _mm_set_ps(p[indices[3]], p[indices[2]], p[indices[1]], p[indices[0]]);
+    }
+    static inline Scalar Sum(Register x) {
+        Register half = _mm_add_ps(x, _mm_movehl_ps(x, x));
+        return _mm_cvtss_f32(_mm_add_ss(half, _mm_shuffle_ps(half, half, 1)));
+    }
+
+    static inline Register Load(const BFloat16* p) {
+        __m128i bits = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+        return _mm_castsi128_ps(_mm_unpacklo_epi16(_mm_setzero_si128(), bits));
+    }
+    static inline void Store(BFloat16* p, Register x) {
+        __m128i bits = _mm_castps_si128(x);
+        __m128i lsb = _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(1));
+        bits = _mm_srai_epi32(_mm_add_epi32(bits, _mm_add_epi32(lsb, _mm_set1_epi32(0x7fff))), 16);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packs_epi32(bits, bits));
+    }
+};
+
+template <>
+struct Sse2<double> {
+    using Scalar = double;
+    using Register = __m128d;
+    static constexpr size_t width = 2;
+
+    static inline Register Zero() { return _mm_setzero_pd(); }
+    static inline Register Set(Scalar x) { return _mm_set1_pd(x); }
+    static inline Register Load(const Scalar* p) { return _mm_loadu_pd(p); }
+    static inline void Store(Scalar* p, Register x) { _mm_storeu_pd(p, x); }
+    static inline Register MulAdd(Register a, Register b, Register c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+    static inline Register Add(Register a, Register b) { return _mm_add_pd(a, b); }
+    static inline Register Mul(Register a, Register b) { return _mm_mul_pd(a, b); }
+    static inline Register Div(Register a, Register b) { return _mm_div_pd(a, b); }
+    static inline Register Min(Register a, Register b) { return _mm_min_pd(a, b); }
+    static inline Register Max(Register a, Register b) { return _mm_max_pd(a, b); }
+    static inline Register Sqrt(Register x) { return _mm_sqrt_pd(x); }
+    static inline Register PowerOfTwo(Register k) {
+        // The exponents land in the low 32-bit halves, interleave them with zeros as the high halves of the doubles.
+        const __m128i exponents = _mm_slli_epi32(_mm_add_epi32(_mm_cvtpd_epi32(k), _mm_set1_epi32(1023)), 20);
+        return _mm_castsi128_pd(_mm_unpacklo_epi32(_mm_setzero_si128(), exponents));
+    }
+    static inline Register Gather(const Scalar* p, const std::uint32_t* indices) {
+        return _mm_set_pd(p[indices[1]], p[indices[0]]);
+    }
+    static inline Scalar Sum(Register x) { return _mm_cvtsd_f64(_mm_add_sd(x, _mm_unpackhi_pd(x, x))); }
+};
+
+// Bytes are widened to 16 bits and multiplied with pmaddwd, which unlike pmaddubsw never saturates.
+// Four rows are processed at once, so every widened input vector is reused four times.
+void QuantizedDense(const std::int8_t* weights, size_t stride, size_t rows, size_t columns, const std::uint8_t* inputs,
+                    std::int32_t* outputs) {
+    constexpr size_t width = 16;
+    constexpr size_t row_block = 4;
+    const size_t vector_columns = columns - columns % width;
+    const __m128i zero = _mm_setzero_si128();
+
+    for (size_t first_row = 0; first_row < rows; first_row += row_block) {
+        const size_t block_rows = rows - first_row < row_block ? rows - first_row : row_block;
+        __m128i sums[row_block] = {zero, zero, zero, zero};
+        for (size_t column = 0; column != vector_columns; column += width) {
+            const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputs + column));
+            const __m128i x_low = _mm_unpacklo_epi8(x, zero);
+            const __m128i x_high = _mm_unpackhi_epi8(x, zero);
+            for (size_t row = 0; row != block_rows; ++row) {
+                const __m128i w = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(weights + (first_row + row) * stride + column));
+                // Sign extension: duplicate each byte into the high half and shift it back arithmetically.
+                const __m128i w_low = _mm_srai_epi16(_mm_unpacklo_epi8(w, w), 8);
+                const __m128i w_high = _mm_srai_epi16(_mm_unpackhi_epi8(w, w), 8);
+                sums[row] = _mm_add_epi32(sums[row], _mm_madd_epi16(x_low, w_low));
+                sums[row] = _mm_add_epi32(sums[row], _mm_madd_epi16(x_high, w_high));
+            }
+        }
+        for (size_t row = 0; row != block_rows; ++row) {
+            __m128i sum = _mm_add_epi32(sums[row], _mm_shuffle_epi32(sums[row], 0x4e));
+            sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+            std::int32_t result = _mm_cvtsi128_si32(sum);
+            const std::int8_t* row_weights = weights + (first_row + row) * stride;
+            for (size_t column = vector_columns; column != columns; ++column)
+                result += static_cast<std::int32_t>(inputs[column]) * row_weights[column];
+            outputs[first_row + row] = result;
+        }
+    }
+}
+
+} // namespace
+
+const QuantizedTable& GetSse2QuantizedTable() {
+    static const QuantizedTable table = {InstructionSet::Sse2, QuantizedDense};
+    return table;
+}
+
+template <typename T, typename W>
+const Table<T, W>& GetSse2Table() {
+    return Simd<Sse2<T>, W>::GetTable(InstructionSet::Sse2);
+}
+
+template const Table<float, float>& GetSse2Table<float, float>();
+template const Table<double, double>& GetSse2Table<double, double>();
+template const Table<float, BFloat16>& GetSse2Table<float, BFloat16>();
+
+} // namespace Kernels
+} // namespace Neural
@@ -0,0 +1,220 @@
+#include "layers.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace Neural {
+
+Layer::~Layer() {}
+
+void Layer::ForwardBatch(MatrixView<const float> inputs, MatrixView<float> outputs, LayerPass& pass) const {
+    assert(inputs.Rows() == outputs.Rows());
+    for (size_t sample_index = 0; sample_index != inputs.Rows(); ++sample_index)
+        Forward(inputs.Row(sample_index), outputs.Row(sample_index), pass);
+}
+
+void Layer::ForwardInPlace(float*, size_t, LayerPass&) const {
+    assert(!"Not an element-wise layer");
+}
+
+void Layer::ForwardRange(const float*, float*, size_t, size_t, LayerPass&) const {
+    assert(!"The outputs of the layer depend on each other");
+}
+
+DenseLayer::DenseLayer(size_t inputs_count, size_t outputs_count)
+    : m_weights(outputs_count, inputs_count), m_biases(outputs_count) {
+    assert(inputs_count != 0 && outputs_count != 0);
+}
+
+std::unique_ptr<Layer> DenseLayer::Clone() const {
+    return std::make_unique<DenseLayer>(*this);
+}
+
+size_t DenseLayer::GetParametersCount() const {
+    return m_weights.Rows() * m_weights.Columns() + m_biases.size();
+}
+
+void DenseLayer::Randomize(Random::Prng<>& random) {
+    // Scaled by the number of inputs like in ConvolutionalNetwork, so that wide layers do not start out saturated.
+    const float range = std::sqrt(3.0f / m_weights.Columns());
+    for (size_t neuron_index = 0; neuron_index != m_weights.Rows(); ++neuron_index)
+        for (size_t input_index = 0; input_index != m_weights.Columns(); ++input_index)
+            m_weights(neuron_index, input_index) = random.NextFloat<float>(-range, range);
+    for (auto& bias : m_biases)
+        bias = random.NextFloat<float>(-range, range);
+}
+
+void DenseLayer::Forward(const float* inputs, float* outputs, LayerPass& pass) const {
+    pass.kernels->dense(m_weights.Data(), m_weights.Stride(), m_weights.Rows(), m_weights.Columns(), inputs,
+                        m_biases.data(), outputs);
+}
+
+void DenseLayer::ForwardBatch(MatrixView<const float> inputs, MatrixView<float> outputs, LayerPass& pass) const {
+    assert(inputs.Rows() == outputs.Rows());
+    pass.kernels->dense_batch(m_weights.Data(), m_weights.Stride(), m_weights.Rows(), m_weights.Columns(),
+                              inputs.Data(), inputs.Stride(), inputs.Rows(), m_biases.data(), outputs.Data(),
+                              outputs.Stride());
+}
+
+void DenseLayer::ForwardRange(const float* inputs, float* outputs, size_t first, size_t count,
+                              LayerPass& pass) const {
+    assert(first + count <= m_weights.Rows());
+    pass.kernels->dense(m_weights.Row(first), m_weights.Stride(), count, m_weights.Columns(), inputs,
+                        m_biases.data() + first, outputs + first);
+}
+
+void DenseLayer::Backward(const float* inputs, const float*, float* errors, float* input_errors, float rate,
+                          LayerPass& pass) {
+    float* scales = pass.scratch;
+    for (size_t neuron_index = 0; neuron_index != m_weights.Rows(); ++neuron_index) {
+        scales[neuron_index] = rate * errors[neuron_index];
+        m_biases[neuron_index] += scales[neuron_index];
+    }
+    if (input_errors)
+        std::fill_n(input_errors, m_weights.Columns(), 0.0f);
+    pass.kernels->backward(m_weights.Data(), m_weights.Stride(), m_weights.Rows(), m_weights.Columns(), errors,
+                           scales, inputs, input_errors);
+}
+
+void ElementwiseLayer::Forward(const float* inputs, float* outputs, LayerPass& pass) const {
+    if (outputs != inputs)
+        std::copy_n(inputs, m_size, outputs);
+    ForwardInPlace(outputs, m_size, pass);
+}
+
+std::unique_ptr<Layer> ActivationLayer::Clone() const {
+    return std::make_unique<ActivationLayer>(*this);
+}
+
+void ActivationLayer::ForwardInPlace(float* values, size_t count, LayerPass& pass) const {
+    // The softmax is a layer of its own.
+    Kernels::ActivateLayer(*pass.kernels, m_activation, false, values, count);
+}
+
+void ActivationLayer::Backward(const float*, const float* outputs, float* errors, float* input_errors, float,
+                               LayerPass&) {
+    // The derivative of the displaced tanh follows from its value.
+    if (input_errors)
+        for (size_t index = 0; index != GetOutputsCount(); ++index)
+            input_errors[index] = errors[index] * 2 * outputs[index] * (1 - outputs[index]);
+}
+
+DropoutLayer::DropoutLayer(size_t size, float probability) : ElementwiseLayer(size), m_probability(probability) {
+    assert(probability >= 0 && probability < 1);
+}
+
+std::unique_ptr<Layer> DropoutLayer::Clone() const {
+    return std::make_unique<DropoutLayer>(*this);
+}
+
+void DropoutLayer::ForwardInPlace(float* values, size_t count, LayerPass& pass) const {
+    if (!pass.learning)
+        return;
+    const float scale = 1 / (1 - m_probability);
+    for (size_t index = 0; index != count; ++index) {
+        pass.saved[index] = pass.random->NextFloat<float>() < m_probability ? 0 : scale;
+        values[index] *= pass.saved[index];
+    }
+}
+
+void DropoutLayer::Backward(const float*, const float*, float* errors, float* input_errors, float, LayerPass& pass) {
+    if (input_errors)
+        for (size_t index = 0; index != GetOutputsCount(); ++index)
+            input_errors[index] = errors[index] * pass.saved[index];
+}
+
+std::unique_ptr<Layer> SoftmaxLayer::Clone() const {
+    return std::make_unique<SoftmaxLayer>(*this);
+}
+
+void SoftmaxLayer::Forward(const float* inputs, float* outputs, LayerPass& pass) const {
+    std::copy(inputs, inputs + m_size, outputs);
+    pass.kernels->softmax(outputs, m_size);
+}
+
+void SoftmaxLayer::Backward(const float*, const float* outputs, float* errors, float* input_errors, float,
+                            LayerPass&) {
+    if (!input_errors)
+        return;
+    // Every output depends on every input: input_errors[i] = outputs[i] * (errors[i] - sum of errors[j] * outputs[j]).
+    float weighted_sum = 0;
+    for (size_t index = 0; index != m_size; ++index)
+        weighted_sum += errors[index] * outputs[index];
+    for (size_t index = 0; index != m_size; ++index)
+        input_errors[index] = outputs[index] * (errors[index] - weighted_sum);
+}
+
+namespace {
+
+// Added to the variance, so that constant inputs do not divide by zero.
+constexpr float normalization_epsilon = 1e-5f;
+
+} // namespace
+
+NormalizationLayer::NormalizationLayer(size_t size) : m_gains(size, 1.0f), m_biases(size, 0.0f) {
+    assert(size != 0);
+}
+
+std::unique_ptr<Layer> NormalizationLayer::Clone() const {
+    return std::make_unique<NormalizationLayer>(*this);
+}
+
+void NormalizationLayer::Randomize(Random::Prng<>&) {
+    std::fill(m_gains.begin(), m_gains.end(), 1.0f);
+    std::fill(m_biases.begin(), m_biases.end(), 0.0f);
+}
+
+void NormalizationLayer::Forward(const float* inputs, float* outputs, LayerPass& pass) const {
+    const size_t size = m_gains.size();
+    float mean = 0;
+    for (size_t index = 0; index != size; ++index)
+        mean += inputs[index];
+    mean /= size;
+    float variance = 0;
+    for (size_t index = 0; index != size; ++index)
+        variance += (inputs[index] - mean) * (inputs[index] - mean);
+    variance /= size;
+    const float inverse_deviation = 1 / std::sqrt(variance + normalization_epsilon);
+
+    for (size_t index = 0; index != size; ++index)
+        outputs[index] = m_gains[index] * (inputs[index] - mean) * inverse_deviation + m_biases[index];
+    if (pass.learning) {
+        pass.saved[0] = mean;
+        pass.saved[1] = inverse_deviation;
+    }
+}
+
+void NormalizationLayer::Backward(const float* inputs, const float*, float* errors, float* input_errors, float rate,
+                                  LayerPass& pass) {
+    const size_t size = m_gains.size();
+    const float mean = pass.saved[0];
+    const float inverse_deviation = pass.saved[1];
+
+    // The mean and the deviation depend on every input, which takes away the average of the normalized errors and
+    // their part along the normalized inputs.
+    if (input_errors) {
+        float errors_mean = 0;
+        float projection_mean = 0;
+        for (size_t index = 0; index != size; ++index) {
+            const float normalized = (inputs[index] - mean) * inverse_deviation;
+            errors_mean += errors[index] * m_gains[index];
+            projection_mean += errors[index] * m_gains[index] * normalized;
+        }
+        errors_mean /= size;
+        projection_mean /= size;
+        for (size_t index = 0; index != size; ++index) {
+            const float normalized = (inputs[index] - mean) * inverse_deviation;
+            input_errors[index] =
+                inverse_deviation * (errors[index] * m_gains[index] - errors_mean - normalized * projection_mean);
+        }
+    }
+
+    for (size_t index = 0; index != size; ++index) {
+        const float normalized = (inputs[index] - mean) * inverse_deviation;
+        m_gains[index] += rate * errors[index] * normalized;
+        m_biases[index] += rate * errors[index];
+    }
+}
+
+} // namespace Neural
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "kernels.h"
+#include "matrix.h"
+#include "span.h"
+
+#include <util/random.h>
+
+namespace Neural {
+
+// What the layers of a SequentialNetwork share during a forward or backward pass.
+struct LayerPass {
+    const Kernels::Table<float>* kernels;
+    // Training pass: dropout drops inputs, and the layers save what their backward pass needs.
+    bool learning;
+    Random::Prng<>* random;
+    // The layer's own values kept from the forward pass for the backward one, see Layer::GetSavedCount.
+    float* saved;
+    // Scratch memory as large as the widest layer.
+    float* scratch;
+};
+
+// Building block of a SequentialNetwork, computing its outputs from the outputs of the layer before it.
+// Errors are the negative loss gradients of the outputs, like the target minus the output of the last layer.
+class Layer {
+public:
+    virtual ~Layer();
+
+    virtual std::unique_ptr<Layer> Clone() const = 0;
+
+    virtual size_t GetInputsCount() const = 0;
+    virtual size_t GetOutputsCount() const = 0;
+    // Number of trained parameters.
+    virtual size_t GetParametersCount() const { return 0; }
+    // Number of values the forward pass of a training sample keeps for the backward pass.
+    virtual size_t GetSavedCount() const { return 0; }
+
+    virtual void Randomize(Random::Prng<>&) {}
+
+    virtual void Forward(const float*, float*, LayerPass&) const = 0;
+    // The forward pass of a batch of samples, one per row, outside of training. One sample at a time by default.
+    virtual void ForwardBatch(MatrixView<const float>, MatrixView<float>, LayerPass&) const;
+    // Correct the parameters from the errors of the outputs, which may be overwritten, and write the errors of the
+    // inputs unless they are null. The inputs and outputs are those of the last forward pass.
+    virtual void Backward(const float*, const float*, float*, float*, float, LayerPass&) = 0;
+
+    // Element-wise layers compute every output from the input at the same index, in place, and propagate the errors
+    // from their outputs and saved values alone: their backward pass may be given no inputs, and the errors of their
+    // outputs as those of their inputs.
+    virtual bool IsElementwise() const { return false; }
+    virtual void ForwardInPlace(float*, size_t, LayerPass&) const;
+
+    // Layers whose outputs do not depend on each other can compute a range of them at a time, which lets an
+    // element-wise layer after them work on each range while it is still in the cache. Their backward pass is
+    // given no outputs, as those are overwritten by the element-wise layer.
+    virtual bool HasIndependentOutputs() const { return false; }
+    virtual void ForwardRange(const float*, float*, size_t, size_t, LayerPass&) const;
+};
+
+// Fully connected layer: outputs = weights * inputs + biases.
+class DenseLayer : public Layer {
+public:
+    DenseLayer(size_t, size_t);
+
+    std::unique_ptr<Layer> Clone() const override;
+
+    inline size_t GetInputsCount() const override { return m_weights.Columns(); }
+    inline size_t GetOutputsCount() const override { return m_weights.Rows(); }
+    size_t GetParametersCount() const override;
+
+    void Randomize(Random::Prng<>&) override;
+
+    void Forward(const float*, float*, LayerPass&) const override;
+    // All the samples at once with the batched kernel, which loads every weight once per block of samples.
+    void ForwardBatch(MatrixView<const float>, MatrixView<float>, LayerPass&) const override;
+    void Backward(const float*, const float*, float*, float*, float, LayerPass&) override;
+
+    inline bool HasIndependentOutputs() const override { return true; }
+    void ForwardRange(const float*, float*, size_t, size_t, LayerPass&) const override;
+
+    // Weights as a (outputs x inputs) row-major matrix.
+    inline MatrixView<float> GetWeights() { return m_weights.View(); }
+    inline MatrixView<const float> GetWeights() const { return m_weights.View(); }
+    inline Span<float> GetBiases() { return m_biases; }
+    inline Span<const float> GetBiases() const { return m_biases; }
+
+private:
+    Matrix<float> m_weights;
+    AlignedVector<float> m_biases;
+};
+
+// Element-wise layers have as many outputs as inputs and compute them in place.
+class ElementwiseLayer : public Layer {
+public:
+    explicit ElementwiseLayer(size_t size) : m_size(size) {}
+
+    inline size_t GetInputsCount() const override { return m_size; }
+    inline size_t GetOutputsCount() const override { return m_size; }
+
+    void Forward(const float*, float*, LayerPass&) const final;
+
+    inline bool IsElementwise() const override { return true; }
+
+private:
+    size_t m_size;
+};
+
+// The displaced tanh of Network, 0.5 * (tanh(x) + 1), evaluated with the given approximation.
+class ActivationLayer : public ElementwiseLayer {
+public:
+    ActivationLayer(size_t size, Kernels::Activation activation) : ElementwiseLayer(size), m_activation(activation) {}
+
+    std::unique_ptr<Layer> Clone() const override;
+
+    void Backward(const float*, const float*, float*, float*, float, LayerPass&) override;
+    void ForwardInPlace(float*, size_t, LayerPass&) const override;
+
+    inline Kernels::Activation GetActivation() const { return m_activation; }
+
+private:
+    Kernels::Activation m_activation;
+};
+
+// Zeroes every input with the given probability while learning and scales the others up to keep their expected sum,
+// so that the layers after it do not come to rely on any single one. Passes the inputs through otherwise.
+class DropoutLayer : public ElementwiseLayer {
+public:
+    DropoutLayer(size_t, float);
+
+    std::unique_ptr<Layer> Clone() const override;
+
+    // The factor of every input, zero or the scale.
+    inline size_t GetSavedCount() const override { return GetOutputsCount(); }
+
+    void Backward(const float*, const float*, float*, float*, float, LayerPass&) override;
+    void ForwardInPlace(float*, size_t, LayerPass&) const override;
+
+    inline float GetProbability() const { return m_probability; }
+
+private:
+    float m_probability;
+};
+
+// Exponentials of the inputs divided by their sum, so that the outputs are positive and add up to one.
+class SoftmaxLayer : public Layer {
+public:
+    explicit SoftmaxLayer(size_t size) : m_size(size) {}
+
+    std::unique_ptr<Layer> Clone() const override;
+
+    inline size_t GetInputsCount() const override { return m_size; }
+    inline size_t GetOutputsCount() const override { return m_size; }
+
+    void Forward(const float*, float*, LayerPass&) const override;
+    void Backward(const float*, const float*, float*, float*, float, LayerPass&) override;
+
+private:
+    size_t m_size;
+};
+
+// Layer normalization: the inputs are shifted and scaled to a mean of zero and a variance of one over the layer,
+// then every one is multiplied by a gain and offset by a bias, both learned. Keeps the sums of the next layer in
+// the range where the activation function still learns, whatever the scale of the inputs.
+class NormalizationLayer : public Layer {
+public:
+    explicit NormalizationLayer(size_t);
+
+    std::unique_ptr<Layer> Clone() const override;
+
+    inline size_t GetInputsCount() const override { return m_gains.size(); }
+    inline size_t GetOutputsCount() const override { return m_gains.size(); }
+    inline size_t GetParametersCount() const override { return 2 * m_gains.size(); }
+    // The mean and the inverse of the standard deviation of the inputs.
+    inline size_t GetSavedCount() const override { return 2; }
+
+    // Starts over from passing the normalized inputs through.
+    void Randomize(Random::Prng<>&) override;
+
+    void Forward(const float*, float*, LayerPass&) const override;
+    void Backward(const float*, const float*, float*, float*, float, LayerPass&) override;
+
+private:
+    AlignedVector<float> m_gains;
+    AlignedVector<float> m_biases;
+};
+
+} // namespace Neural
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Neural {
+
+// Rows of every matrix start on a cache line boundary, which is also wide enough for any SIMD load.
+constexpr size_t cache_line_size = 64;
+
+template <typename T, size_t A = cache_line_size>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, A>;
+    };
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, A>&) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(A))); }
+    void deallocate(T* pointer, size_t) { ::operator delete(pointer, std::align_val_t(A)); }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, A>&) const {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, A>&) const {
+        return false;
+    }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+// Non-owning view of a row-major matrix whose rows are `stride` elements apart.
+template <typename T>
+class MatrixView {
+public:
+    MatrixView() : m_data(nullptr), m_rows(0), m_columns(0), m_stride(0) {}
+    MatrixView(T* data, size_t rows, size_t columns, size_t stride)
+        : m_data(data), m_rows(rows), m_columns(columns), m_stride(stride) {}
+
+    // Allow implicit conversion from a mutable view to a read-only one.
+    template <typename U, typename = std::enable_if_t<std::is_same_v<const U, T>>>
+    MatrixView(const MatrixView<U>& other)
+        : m_data(other.Data()), m_rows(other.Rows()), m_columns(other.Columns()), m_stride(other.Stride()) {}
+
+    inline T* Row(size_t row) const {
+        assert(row < m_rows);
+        return m_data + row * m_stride;
+    }
+
+    inline T& operator()(size_t row, size_t column) const {
+        assert(column < m_columns);
+        return Row(row)[column];
+    }
+
+    // View of `count` consecutive rows starting from `first`.
+    inline MatrixView RowRange(size_t first, size_t count) const {
+        assert(first + count <= m_rows);
+        return MatrixView(m_data + first * m_stride, count, m_columns, m_stride);
+    }
+
+    inline T* Data() const { return m_data; }
+    inline size_t Rows() const { return m_rows; }
+    inline size_t Columns() const { return m_columns; }
+    inline size_t Stride() const { return m_stride; }
+
+private:
+    T* m_data;
+    size_t m_rows;
+    size_t m_columns;
+    size_t m_stride;
+};
+
+// Owning row-major matrix stored as a single aligned block.
+// Each row is padded with zeros up to a whole number of cache lines.
+template <typename T>
+class Matrix {
+public:
+    Matrix() : m_data(), m_rows(0), m_columns(0), m_stride(0) {}
+    Matrix(size_t rows, size_t columns)
+        : m_data(rows * PaddedStride(columns)), m_rows(rows), m_columns(columns), m_stride(PaddedStride(columns)) {}
+
+    inline MatrixView<T> View() { return MatrixView<T>(m_data.data(), m_rows, m_columns, m_stride); }
+    inline MatrixView<const T> View() const { return MatrixView<const T>(m_data.data(), m_rows, m_columns, m_stride); }
+
+    inline T* Row(size_t row) { return View().Row(row); }
+    inline const T* Row(size_t row) const { return View().Row(row); }
+
+    inline T& operator()(size_t row, size_t column) { return View()(row, column); }
+    inline const T& operator()(size_t row, size_t column) const { return View()(row, column); }
+
+    inline T* Data() { return m_data.data(); }
+    inline const T* Data() const { return m_data.data(); }
+    inline size_t Rows() const { return m_rows; }
+    inline size_t Columns() const { return m_columns; }
+    inline size_t Stride() const { return m_stride; }
+
+    void Swap(Matrix& other) {
+        m_data.swap(other.m_data);
+        std::swap(m_rows, other.m_rows);
+        std::swap(m_columns, other.m_columns);
+        std::swap(m_stride, other.m_stride);
+    }
+
+    static constexpr size_t PaddedStride(size_t columns) {
+        constexpr size_t line_elements = cache_line_size / sizeof(T);
+        static_assert(line_elements * sizeof(T) == cache_line_size);
+        return (columns + line_elements - 1) / line_elements * line_elements;
+    }
+
+private:
+    AlignedVector<T> m_data;
+    size_t m_rows;
+    size_t m_columns;
+    size_t m_stride;
+};
+
+} // namespace Neural
@@ -0,0 +1,87 @@
+#include "model_file.h"
+
+#include <cassert>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Neural {
+namespace ModelFile {
+
+std::uint64_t Checksum(const void* data, size_t size, std::uint64_t hash) {
+    assert(size % sizeof(std::uint64_t) == 0);
+    const auto* bytes = static_cast<const std::byte*>(data);
+    for (size_t offset = 0; offset != size; offset += sizeof(std::uint64_t)) {
+        std::uint64_t word;
+        std::memcpy(&word, bytes + offset, sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3;
+    }
+    return hash;
+}
+
+MappedFile::MappedFile(std::byte* data, size_t size) : m_data(data), m_size(size) {}
+
+#ifdef _WIN32
+
+std::unique_ptr<MappedFile> MappedFile::Open(const std::string& path) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return nullptr;
+    }
+    // A copy-on-write view needs a mapping created with read-only page protection.
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+        return nullptr;
+    void* data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data)
+        return nullptr;
+    return std::unique_ptr<MappedFile>(new MappedFile(static_cast<std::byte*>(data), size.QuadPart));
+}
+
+MappedFile::~MappedFile() {
+    UnmapViewOfFile(m_data);
+}
+
+#else
+
+std::unique_ptr<MappedFile> MappedFile::Open(const std::string& path) {
+    int file = open(path.c_str(), O_RDONLY);
+    if (file == -1)
+        return nullptr;
+    struct stat status;
+    if (fstat(file, &status) != 0 || status.st_size == 0) {
+        close(file);
+        return nullptr;
+    }
+    void* data = mmap(nullptr, status.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    // The mapping stays valid after the descriptor is closed.
+    close(file);
+    if (data == MAP_FAILED)
+        return nullptr;
+    return std::unique_ptr<MappedFile>(new MappedFile(static_cast<std::byte*>(data), status.st_size));
+}
+
+MappedFile::~MappedFile() {
+    munmap(m_data, m_size);
+}
+
+#endif
+
+} // namespace ModelFile
+} // namespace Neural
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "bfloat16.h"
+
+namespace Neural {
+namespace ModelFile {
+
+// Layout of a model file, all numbers in the byte order of the machine that wrote it:
+//     Header
+//     uint32_t layer sizes[layers_count], zero padded to a multiple of `block_alignment` bytes from the file start
+//     for every layer:
+//         weights, (layer size x inputs) row-major with rows zero padded to whole cache lines like in Matrix
+//         biases, zero padded to a multiple of `block_alignment` bytes
+// Every block starts on a `block_alignment` boundary, so a mapped file can be used in place. Weights are not byte
+// swapped for the same reason: a machine of the other byte order reads the version with its bytes reversed and
+// rejects the file.
+constexpr char magic[8] = {'A', 'I', 'D', 'H', 'W', 'I', 'N', 'N'};
+constexpr std::uint32_t version = 1;
+constexpr size_t block_alignment = 64;
+
+enum class ScalarType : std::uint32_t {
+    Float32 = 1,
+    Float64 = 2,
+    BFloat16 = 3,
+};
+
+template <typename T>
+constexpr ScalarType scalar_type_of = ScalarType::Float32;
+template <>
+constexpr ScalarType scalar_type_of<double> = ScalarType::Float64;
+template <>
+constexpr ScalarType scalar_type_of<BFloat16> = ScalarType::BFloat16;
+
+struct Header {
+    char magic[8];
+    // Also marks the byte order, see above.
+    std::uint32_t version;
+    // Arithmetic type of the biases and weight storage type.
+    ScalarType scalar_type;
+    ScalarType weight_type;
+    std::uint32_t inputs_count;
+    std::uint32_t layers_count;
+    // Loss the network was trained with, which decides what its last layer computes, as a Loss value: zero is the
+    // squared error.
+    std::uint32_t loss;
+    // Size of the whole file.
+    std::uint64_t file_size;
+    // Checksum of everything after the header.
+    std::uint64_t checksum;
+};
+
+static_assert(sizeof(Header) == 48);
+
+constexpr size_t AlignBlock(size_t size) {
+    return (size + block_alignment - 1) / block_alignment * block_alignment;
+}
+
+// FNV-1a over 64-bit words, `size` must be a multiple of 8. Chain calls by passing the previous result.
+std::uint64_t Checksum(const void*, size_t, std::uint64_t = 0xcbf29ce484222325);
+
+// Contents of a file mapped into memory privately: the pages are only read from disk when touched,
+// and writing to them modifies a copy rather than the file.
+class MappedFile {
+public:
+    // Returns null if the file cannot be opened or mapped.
+    static std::unique_ptr<MappedFile> Open(const std::string&);
+    ~MappedFile();
+
+    inline std::byte* Data() const { return m_data; }
+    inline size_t Size() const { return m_size; }
+
+private:
+    std::byte* m_data;
+    size_t m_size;
+
+    MappedFile(std::byte*, size_t);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+};
+
+} // namespace ModelFile
+} // namespace Neural
@@ -1,152 +1,1102 @@
 #include "network.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <ctime>
+#include <fstream>
 #include <vector>
 
 #include <util/random.h>
 
+#include "model_file.h"
+
 namespace Neural {
 
-Network::Network(size_t inputs_count, const std::vector<size_t>& layer_sizes)
-    : m_weights(), m_biases(), m_max_layer_size(inputs_count) {
+namespace {
+
+// The first layer is computed as a gather over the columns of the non-zero inputs when at most 1 / ratio of the inputs
+// are. Beyond that, the columns of all of them cost more to load than a dot product over the rows.
+constexpr size_t sparse_forward_ratio = 3;
+// Without the column-major copy, Learn updates only the first layer's weights of the non-zero inputs when at most
+// 1 / ratio of the inputs are, otherwise the vectorized update of whole rows is faster than scattering into them.
+// The scatter rounds the product and the sum apart, while the AVX2 and AVX-512 kernels fuse them into one rounding,
+// so there the trained weights can differ in the last bit depending on which side of the ratio the samples fall.
+// With the copy, the changed columns have to be copied into the rows anyway, so it always updates the columns.
+constexpr size_t sparse_update_ratio = 12;
+// ComputeOutputIncremental computes the first layer's sums in full again after this many delta updates, each of which
+// adds its rounding errors to them.
+constexpr size_t incremental_updates_limit = 256;
+
+// Shared by all networks, so that an incremental state never matches the parameters of another one by accident.
+std::atomic<std::uint64_t> last_parameters_version(0);
+
+// Relaxed atomic access to parameters shared between LearnAsync callers.
+// Plain loads and stores of naturally aligned values are atomic on every supported target,
+// this only keeps the compiler from tearing, caching or reordering them.
+template <typename T>
+inline T RelaxedLoad(const T* pointer) {
+#if defined(__GNUC__) || defined(__clang__)
+    T value;
+    __atomic_load(pointer, &value, __ATOMIC_RELAXED);
+    return value;
+#else
+    return *const_cast<const volatile T*>(pointer);
+#endif
+}
+
+template <typename T>
+inline void RelaxedStore(T* pointer, T value) {
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_store(pointer, &value, __ATOMIC_RELAXED);
+#else
+    *const_cast<volatile T*>(pointer) = value;
+#endif
+}
+
+// Copy weights between the first layer's rows and its column-major copy, for the inputs given by the indices, or
+// for all of them if there are none. Neurons are taken a cache line of the copy at a time: both strides are
+// multiples of the cache line size and go through few cache sets, so a whole column or row would thrash them.
+template <bool ToColumns, typename W>
+void CopyFirstLayerColumns(MatrixView<W> rows, MatrixView<W> columns, const size_t* indices, size_t count) {
+    constexpr size_t neurons_block = cache_line_size / sizeof(W);
+    for (size_t first_neuron = 0; first_neuron < rows.Rows(); first_neuron += neurons_block) {
+        const size_t last_neuron = std::min(first_neuron + neurons_block, rows.Rows());
+        for (size_t index = 0; index != count; ++index) {
+            const size_t input_index = indices ? indices[index] : index;
+            W* column = columns.Row(input_index);
+            for (size_t neuron_index = first_neuron; neuron_index != last_neuron; ++neuron_index) {
+                W& weight = rows.Row(neuron_index)[input_index];
+                if constexpr (ToColumns)
+                    column[neuron_index] = weight;
+                else
+                    weight = column[neuron_index];
+            }
+        }
+    }
+}
+
+} // namespace
+
+template <typename T, typename W>
+BasicNetwork<T, W>::BasicNetwork(size_t inputs_count, const std::vector<size_t>& layer_sizes)
+    : m_weights(), m_biases(), m_max_layer_size(inputs_count), m_kernels(&Kernels::GetTable<T, W>()),
+      m_activation(Kernels::Activation::Exact), m_loss(Loss::SquaredError), m_weights_storage(), m_optimizer(),
+      m_optimizer_state(), m_optimizer_steps(0), m_sample_gradients(), m_first_layer_columns(),
+      m_parameters_version(++last_parameters_version) {
     assert(layer_sizes.size() > 0);
 
-    m_weights.reserve(layer_sizes.size());
-    m_biases.reserve(m_weights.size());
+    AllocateWeights(inputs_count, layer_sizes);
+    m_biases.reserve(layer_sizes.size());
     for (auto layer_size : layer_sizes) {
-        m_weights.emplace_back(layer_size, std::vector<double>(inputs_count));
         m_biases.emplace_back(layer_size);
-        inputs_count = layer_size;
 
         if (m_max_layer_size < layer_size)
             m_max_layer_size = layer_size;
     }
 }
 
-Network::~Network() {}
+template <typename T, typename W>
+BasicNetwork<T, W>::BasicNetwork()
+    : m_weights(), m_biases(), m_max_layer_size(0), m_kernels(&Kernels::GetTable<T, W>()),
+      m_activation(Kernels::Activation::Exact), m_loss(Loss::SquaredError), m_weights_storage(), m_optimizer(),
+      m_optimizer_state(), m_optimizer_steps(0), m_sample_gradients(), m_first_layer_columns(),
+      m_parameters_version(++last_parameters_version) {}
+
+template <typename T, typename W>
+BasicNetwork<T, W>::BasicNetwork(const BasicNetwork& other)
+    : m_weights(), m_biases(other.m_biases), m_max_layer_size(other.m_max_layer_size), m_kernels(other.m_kernels),
+      m_activation(other.m_activation), m_loss(other.m_loss), m_weights_storage(), m_optimizer(other.m_optimizer),
+      m_optimizer_state(other.m_optimizer_state), m_optimizer_steps(other.m_optimizer_steps), m_sample_gradients(),
+      m_first_layer_columns(other.m_first_layer_columns), m_parameters_version(other.m_parameters_version) {
+    std::vector<size_t> layer_sizes;
+    for (const auto& layer_weights : other.m_weights)
+        layer_sizes.push_back(layer_weights.Rows());
+    AllocateWeights(other.GetInputsCount(), layer_sizes);
+    // Both blocks have the same layout, padding included.
+    for (size_t layer_index = 0; layer_index != m_weights.size(); ++layer_index) {
+        const auto& layer_weights = m_weights[layer_index];
+        std::copy_n(other.m_weights[layer_index].Data(), layer_weights.Rows() * layer_weights.Stride(),
+                    layer_weights.Data());
+    }
+}
+
+template <typename T, typename W>
+BasicNetwork<T, W>::~BasicNetwork() {}
+
+template <typename T, typename W>
+BasicNetwork<T, W>& BasicNetwork<T, W>::operator=(const BasicNetwork& other) {
+    if (this != &other)
+        *this = BasicNetwork(other);
+    return *this;
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::AllocateWeights(size_t inputs_count, const std::vector<size_t>& layer_sizes) {
+    size_t weights_count = 0;
+    for (size_t layer_index = 0; layer_index != layer_sizes.size(); ++layer_index)
+        weights_count += layer_sizes[layer_index] *
+                         Matrix<W>::PaddedStride(layer_index != 0 ? layer_sizes[layer_index - 1] : inputs_count);
 
-void Network::Randomize(std::uint64_t seed) {
-    Random::Prng rng(seed);
+    auto storage = std::make_shared<AlignedVector<W>>(weights_count);
+    W* layer_data = storage->data();
+    m_weights.clear();
+    m_weights.reserve(layer_sizes.size());
+    for (auto layer_size : layer_sizes) {
+        const size_t stride = Matrix<W>::PaddedStride(inputs_count);
+        m_weights.emplace_back(layer_data, layer_size, inputs_count, stride);
+        layer_data += layer_size * stride;
+        inputs_count = layer_size;
+    }
+    m_weights_storage = std::move(storage);
+}
+
+template <typename T, typename W>
+std::optional<BasicNetwork<T, W>> BasicNetwork<T, W>::LoadFromFile(const std::string& path, bool verify_checksum) {
+    using namespace ModelFile;
+
+    auto file = MappedFile::Open(path);
+    if (!file || file->Size() < sizeof(Header))
+        return std::nullopt;
+
+    Header header;
+    std::memcpy(&header, file->Data(), sizeof(header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version ||
+        header.scalar_type != scalar_type_of<T> || header.weight_type != scalar_type_of<W> ||
+        header.file_size != file->Size() || header.inputs_count == 0 || header.layers_count == 0 ||
+        header.loss > static_cast<std::uint32_t>(Loss::CrossEntropy))
+        return std::nullopt;
+
+    // Check that the topology accounts for exactly the whole file before looking at any of the blocks. Every block is
+    // taken from what is left of the file, and sizes are compared by division first, so that none of the products of
+    // corrupted sizes can overflow.
+    if (header.layers_count > (file->Size() - sizeof(Header)) / sizeof(std::uint32_t))
+        return std::nullopt;
+    const size_t sizes_end = AlignBlock(sizeof(Header) + header.layers_count * sizeof(std::uint32_t));
+    if (sizes_end > file->Size())
+        return std::nullopt;
+    size_t remaining_size = file->Size() - sizes_end;
+    const auto take = [&remaining_size](size_t count, size_t element_size) {
+        if (count > remaining_size / element_size || AlignBlock(count * element_size) > remaining_size)
+            return false;
+        remaining_size -= AlignBlock(count * element_size);
+        return true;
+    };
+    std::vector<size_t> layer_sizes(header.layers_count);
+    size_t inputs_count = header.inputs_count;
+    for (size_t layer_index = 0; layer_index != layer_sizes.size(); ++layer_index) {
+        std::uint32_t layer_size;
+        std::memcpy(&layer_size, file->Data() + sizeof(Header) + layer_index * sizeof(layer_size), sizeof(layer_size));
+        // Rows are padded to whole cache lines, so each of them takes at least as many bytes as its inputs.
+        if (layer_size == 0 || inputs_count > remaining_size / sizeof(W) ||
+            !take(layer_size, Matrix<W>::PaddedStride(inputs_count) * sizeof(W)) || !take(layer_size, sizeof(T)))
+            return std::nullopt;
+        layer_sizes[layer_index] = layer_size;
+        inputs_count = layer_size;
+    }
+    if (remaining_size != 0)
+        return std::nullopt;
+
+    if (verify_checksum && Checksum(file->Data() + sizeof(Header), file->Size() - sizeof(Header)) != header.checksum)
+        return std::nullopt;
+
+    BasicNetwork network;
+    network.m_loss = static_cast<Loss>(header.loss);
+    network.m_max_layer_size = header.inputs_count;
+    network.m_weights.reserve(layer_sizes.size());
+    network.m_biases.reserve(layer_sizes.size());
+    size_t offset = sizes_end;
+    inputs_count = header.inputs_count;
+    for (auto layer_size : layer_sizes) {
+        const size_t stride = Matrix<W>::PaddedStride(inputs_count);
+        network.m_weights.emplace_back(reinterpret_cast<W*>(file->Data() + offset), layer_size, inputs_count, stride);
+        offset += layer_size * stride * sizeof(W);
+
+        // Biases are small, they are simply copied.
+        const T* biases = reinterpret_cast<const T*>(file->Data() + offset);
+        network.m_biases.emplace_back(biases, biases + layer_size);
+        offset += AlignBlock(layer_size * sizeof(T));
+
+        network.m_max_layer_size = std::max(network.m_max_layer_size, layer_size);
+        inputs_count = layer_size;
+    }
+    network.m_weights_storage = std::shared_ptr<MappedFile>(std::move(file));
+    return network;
+}
+
+template <typename T, typename W>
+bool BasicNetwork<T, W>::DumpToFile(const std::string& path) const {
+    using namespace ModelFile;
+
+    // The file is written as a list of blocks, each a multiple of 8 bytes long so that they can be checksummed
+    // one after another.
+    std::vector<std::uint32_t> layer_sizes((AlignBlock(sizeof(Header) + m_weights.size() * sizeof(std::uint32_t)) -
+                                            sizeof(Header)) /
+                                           sizeof(std::uint32_t));
+    for (size_t layer_index = 0; layer_index != m_weights.size(); ++layer_index)
+        layer_sizes[layer_index] = static_cast<std::uint32_t>(m_weights[layer_index].Rows());
+    std::vector<std::vector<std::byte>> padded_biases(m_biases.size());
+    for (size_t layer_index = 0; layer_index != m_biases.size(); ++layer_index) {
+        padded_biases[layer_index].resize(AlignBlock(m_biases[layer_index].size() * sizeof(T)));
+        std::memcpy(padded_biases[layer_index].data(), m_biases[layer_index].data(),
+                    m_biases[layer_index].size() * sizeof(T));
+    }
+
+    std::vector<std::pair<const void*, size_t>> blocks;
+    blocks.emplace_back(layer_sizes.data(), layer_sizes.size() * sizeof(std::uint32_t));
+    for (size_t layer_index = 0; layer_index != m_weights.size(); ++layer_index) {
+        const auto& layer_weights = m_weights[layer_index];
+        blocks.emplace_back(layer_weights.Data(), layer_weights.Rows() * layer_weights.Stride() * sizeof(W));
+        blocks.emplace_back(padded_biases[layer_index].data(), padded_biases[layer_index].size());
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.scalar_type = scalar_type_of<T>;
+    header.weight_type = scalar_type_of<W>;
+    header.inputs_count = static_cast<std::uint32_t>(GetInputsCount());
+    header.layers_count = static_cast<std::uint32_t>(m_weights.size());
+    header.loss = static_cast<std::uint32_t>(m_loss);
+    header.file_size = sizeof(header);
+    header.checksum = Checksum(nullptr, 0);
+    for (const auto& [data, size] : blocks) {
+        header.file_size += size;
+        header.checksum = Checksum(data, size, header.checksum);
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const auto& [data, size] : blocks)
+        out.write(static_cast<const char*>(data), size);
+    out.close();
+    return !out.fail();
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::Randomize(std::uint64_t seed) {
+    Random::Prng<> rng(seed);
     // Randomize weights
     for (auto& layer : m_weights)
-        for (auto& neuron : layer)
-            for (auto& weight : neuron)
-                weight = rng.NextFloat<double>(-1, 1);
+        for (size_t neuron_index = 0; neuron_index != layer.Rows(); ++neuron_index)
+            for (size_t input_index = 0; input_index != layer.Columns(); ++input_index)
+                layer(neuron_index, input_index) = static_cast<W>(rng.NextFloat<T>(-1, 1));
     // Randomize biases
     for (auto& layer : m_biases)
         for (auto& bias : layer)
-            bias = rng.NextFloat<double>(-1, 1);
+            bias = rng.NextFloat<T>(-1, 1);
+    SyncFirstLayerColumns();
+    ParametersChanged();
 }
 
-void Network::Randomize() {
+template <typename T, typename W>
+void BasicNetwork<T, W>::Randomize() {
     Randomize(std::time(nullptr));
 }
 
-void Network::ComputeOutputForLayer(size_t layer_index, const std::vector<double>& inputs,
-                                    std::vector<double>& outputs) const {
-    assert(m_weights.size() == m_biases.size());
+template <typename T, typename W>
+void BasicNetwork<T, W>::ZeroWeights(size_t layer_index, MatrixView<const std::uint8_t> mask) {
     assert(layer_index < m_weights.size());
+    const auto& layer_weights = m_weights[layer_index];
+    assert(mask.Rows() == layer_weights.Rows() && mask.Columns() == layer_weights.Columns());
 
+    for (size_t neuron_index = 0; neuron_index != layer_weights.Rows(); ++neuron_index) {
+        W* row_weights = layer_weights.Row(neuron_index);
+        const std::uint8_t* row_mask = mask.Row(neuron_index);
+        for (size_t input_index = 0; input_index != layer_weights.Columns(); ++input_index)
+            if (row_mask[input_index] == 0)
+                row_weights[input_index] = static_cast<W>(T(0));
+    }
+    if (layer_index == 0)
+        SyncFirstLayerColumns();
+    ParametersChanged();
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::SetInstructionSet(Kernels::InstructionSet instruction_set) {
+    m_kernels = &Kernels::GetTable<T, W>(instruction_set);
+}
+
+template <typename T, typename W>
+typename BasicNetwork<T, W>::Workspace BasicNetwork<T, W>::CreateWorkspace() const {
+    Workspace workspace;
+    workspace.outputs.reserve(m_weights.size());
+    for (const auto& layer_weights : m_weights)
+        workspace.outputs.emplace_back(layer_weights.Rows());
+    workspace.errors.resize(m_max_layer_size);
+    workspace.next_errors.resize(m_max_layer_size);
+    workspace.scales.resize(m_max_layer_size);
+    workspace.active_inputs.reserve(GetInputsCount());
+    workspace.active_values.reserve(GetInputsCount());
+    return workspace;
+}
+
+template <typename T, typename W>
+typename BasicNetwork<T, W>::IncrementalState BasicNetwork<T, W>::CreateIncrementalState() const {
+    IncrementalState state;
+    state.inputs.resize(GetInputsCount());
+    state.sums.resize(GetLayerSize(0));
+    return state;
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::ReserveBatch(Workspace& workspace, size_t samples_count) const {
+    if (workspace.batch_outputs.size() == m_weights.size() && workspace.batch_errors.Rows() >= samples_count)
+        return;
+
+    workspace.batch_outputs.clear();
+    workspace.batch_outputs.reserve(m_weights.size());
+    for (const auto& layer_weights : m_weights)
+        workspace.batch_outputs.emplace_back(samples_count, layer_weights.Rows());
+    workspace.batch_errors = Matrix<T>(samples_count, m_max_layer_size);
+    workspace.batch_next_errors = Matrix<T>(samples_count, m_max_layer_size);
+    workspace.batch_deltas = Matrix<T>(samples_count, m_max_layer_size);
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::ComputeLayer(size_t layer_index, const T* inputs, T* outputs) const {
     const auto& layer_weights = m_weights[layer_index];
-    const auto& layer_biases = m_biases[layer_index];
+    m_kernels->dense(layer_weights.Data(), layer_weights.Stride(), layer_weights.Rows(), layer_weights.Columns(),
+                     inputs, m_biases[layer_index].data(), outputs);
+    ActivateLayer(layer_index, outputs);
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::ComputeFirstLayer(const T* inputs, T* outputs, Workspace& workspace) const {
+    if (!GetSparseInputs()) {
+        ComputeLayer(0, inputs, outputs);
+        return;
+    }
+
+    // Learn needs all of them for the update of the columns, even when they are too many for the gather.
+    CollectActiveInputs(inputs, GetInputsCount(), workspace);
+    if (workspace.active_inputs.size() * sparse_forward_ratio > GetInputsCount()) {
+        ComputeLayer(0, inputs, outputs);
+        return;
+    }
+    ComputeFirstLayerSparse(workspace.active_inputs.data(), workspace.active_values.data(),
+                            workspace.active_inputs.size(), outputs);
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::ComputeFirstLayerSparse(const size_t* indices, const T* values, size_t count,
+                                                 T* outputs) const {
+    AddFirstLayerColumns(indices, values, count, m_biases.front().data(), outputs);
+    ActivateLayer(0, outputs);
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::AddFirstLayerColumns(const size_t* indices, const T* values, size_t count, const T* sums,
+                                              T* outputs) const {
+    const auto& layer_weights = m_weights.front();
+    if (GetSparseInputs()) {
+        m_kernels->sparse_dense(m_first_layer_columns.Data(), m_first_layer_columns.Stride(), layer_weights.Rows(),
+                                indices, values, count, sums, outputs);
+        return;
+    }
+
+    for (size_t neuron_index = 0; neuron_index != layer_weights.Rows(); ++neuron_index) {
+        const W* row_weights = layer_weights.Row(neuron_index);
+        T sum = sums[neuron_index];
+        for (size_t index = 0; index != count; ++index)
+            sum += static_cast<T>(row_weights[indices[index]]) * values[index];
+        outputs[neuron_index] = sum;
+    }
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::CollectActiveInputs(const T* inputs, size_t max_count, Workspace& workspace) const {
+    workspace.active_inputs.clear();
+    workspace.active_values.clear();
+    for (size_t input_index = 0; input_index != GetInputsCount(); ++input_index) {
+        if (inputs[input_index] != 0) {
+            if (workspace.active_inputs.size() > max_count)
+                return;
+            workspace.active_inputs.push_back(input_index);
+            workspace.active_values.push_back(inputs[input_index]);
+        }
+    }
+}
 
-    assert(inputs.size() >= layer_weights.front().size());
-    assert(outputs.size() >= layer_weights.size());
+template <typename T, typename W>
+void BasicNetwork<T, W>::UpdateFirstLayerSparse(const T* scales, const Workspace& workspace) {
+    const auto& layer_weights = m_weights.front();
+    const auto& indices = workspace.active_inputs;
+    const auto& values = workspace.active_values;
+    if (GetSparseInputs()) {
+        // The columns are contiguous per input, so update them and copy the changed ones back into the rows.
+        m_kernels->sparse_update(m_first_layer_columns.Data(), m_first_layer_columns.Stride(), layer_weights.Rows(),
+                                 indices.data(), values.data(), indices.size(), scales);
+        CopyFirstLayerColumns<false>(layer_weights, m_first_layer_columns.View(), indices.data(), indices.size());
+        return;
+    }
 
-    for (size_t neuron_index = 0; neuron_index != layer_weights.size(); ++neuron_index) {
-        const auto& neuron_weights = layer_weights[neuron_index];
-        auto& neuron_output = outputs[neuron_index];
+    for (size_t neuron_index = 0; neuron_index != layer_weights.Rows(); ++neuron_index) {
+        W* row_weights = layer_weights.Row(neuron_index);
+        const T scale = scales[neuron_index];
+        for (size_t index = 0; index != indices.size(); ++index) {
+            const size_t input_index = indices[index];
+            row_weights[input_index] = static_cast<W>(static_cast<T>(row_weights[input_index]) + scale * values[index]);
+        }
+    }
+}
 
-        neuron_output = 0;
-        for (size_t input_index = 0; input_index != neuron_weights.size(); ++input_index)
-            neuron_output += inputs[input_index] * neuron_weights[input_index];
-        neuron_output += layer_biases[neuron_index];
-        neuron_output = ActivationFunction(neuron_output);
+template <typename T, typename W>
+void BasicNetwork<T, W>::SetSparseInputs(bool enabled) {
+    if (!enabled) {
+        m_first_layer_columns = Matrix<W>();
+        return;
     }
+    m_first_layer_columns = Matrix<W>(GetInputsCount(), GetLayerSize(0));
+    SyncFirstLayerColumns();
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::SyncFirstLayerColumns(const std::vector<size_t>& input_indices) {
+    if (!GetSparseInputs())
+        return;
+    CopyFirstLayerColumns<true>(m_weights.front(), m_first_layer_columns.View(), input_indices.data(),
+                                input_indices.size());
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::SyncFirstLayerColumns() {
+    if (!GetSparseInputs())
+        return;
+    CopyFirstLayerColumns<true>(m_weights.front(), m_first_layer_columns.View(), nullptr, GetInputsCount());
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::ComputeOutputForLayer(size_t layer_index, const std::vector<T>& inputs,
+                                               std::vector<T>& outputs) const {
+    assert(m_weights.size() == m_biases.size());
+    assert(layer_index < m_weights.size());
+    assert(inputs.size() >= m_weights[layer_index].Columns());
+    assert(outputs.size() >= m_weights[layer_index].Rows());
+
+    ComputeLayer(layer_index, inputs.data(), outputs.data());
+}
+
+template <typename T, typename W>
+std::vector<T> BasicNetwork<T, W>::ComputeOutput(Span<const T> inputs) const {
+    auto workspace = CreateWorkspace();
+    std::vector<T> outputs(GetOutputsCount());
+    ComputeOutput(inputs, workspace, outputs);
+    return outputs;
 }
 
-std::vector<double> Network::ComputeOutput(const std::vector<double>& inputs) const {
+template <typename T, typename W>
+void BasicNetwork<T, W>::ComputeOutput(Span<const T> inputs, Workspace& workspace, Span<T> outputs) const {
     assert(m_weights.size() > 0);
     assert(m_weights.size() == m_biases.size());
-    assert(inputs.size() == m_weights.front().front().size());
+    assert(workspace.outputs.size() == m_weights.size());
+    assert(inputs.Size() == GetInputsCount());
+    assert(outputs.Size() == GetOutputsCount());
 
-    std::vector<double> input_buffer(m_max_layer_size);
-    std::copy(inputs.begin(), inputs.end(), input_buffer.begin());
+    const T* layer_inputs = inputs.Data();
+    for (size_t layer_index = 0; layer_index != m_weights.size(); ++layer_index) {
+        // The last layer writes straight into the destination.
+        T* layer_outputs = layer_index + 1 != m_weights.size() ? workspace.outputs[layer_index].data() : outputs.Data();
+        if (layer_index == 0)
+            ComputeFirstLayer(layer_inputs, layer_outputs, workspace);
+        else
+            ComputeLayer(layer_index, layer_inputs, layer_outputs);
+        // The outputs of this layer will become the inputs for the next one.
+        layer_inputs = layer_outputs;
+    }
+}
 
-    std::vector<double> output_buffer(m_max_layer_size);
+template <typename T, typename W>
+void BasicNetwork<T, W>::ComputeOutputSparse(Span<const size_t> input_indices, Span<const T> input_values,
+                                             Workspace& workspace, Span<T> outputs) const {
+    assert(m_weights.size() > 0);
+    assert(m_weights.size() == m_biases.size());
+    assert(workspace.outputs.size() == m_weights.size());
+    assert(input_indices.Size() == input_values.Size());
+    assert(outputs.Size() == GetOutputsCount());
 
+    const T* layer_inputs = nullptr;
     for (size_t layer_index = 0; layer_index != m_weights.size(); ++layer_index) {
-        ComputeOutputForLayer(layer_index, input_buffer, output_buffer);
+        T* layer_outputs = layer_index + 1 != m_weights.size() ? workspace.outputs[layer_index].data() : outputs.Data();
+        if (layer_index == 0)
+            ComputeFirstLayerSparse(input_indices.Data(), input_values.Data(), input_indices.Size(), layer_outputs);
+        else
+            ComputeLayer(layer_index, layer_inputs, layer_outputs);
+        layer_inputs = layer_outputs;
+    }
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::ComputeOutputIncremental(Span<const T> inputs, IncrementalState& state, Workspace& workspace,
+                                                  Span<T> outputs) const {
+    assert(m_weights.size() > 0);
+    assert(m_weights.size() == m_biases.size());
+    assert(workspace.outputs.size() == m_weights.size());
+    assert(state.inputs.size() == GetInputsCount() && state.sums.size() == GetLayerSize(0));
+    assert(inputs.Size() == GetInputsCount());
+    assert(outputs.Size() == GetOutputsCount());
+
+    // Collect the changes of the inputs, as long as adding their columns costs less than computing the layer anew.
+    auto& changed_inputs = workspace.active_inputs;
+    auto& changes = workspace.active_values;
+    const size_t max_changed_count = GetInputsCount() / sparse_forward_ratio;
+    bool full = state.parameters_version != m_parameters_version || state.updates_count == incremental_updates_limit;
+    changed_inputs.clear();
+    changes.clear();
+    for (size_t input_index = 0; input_index != GetInputsCount() && !full; ++input_index) {
+        if (inputs[input_index] != state.inputs[input_index]) {
+            changed_inputs.push_back(input_index);
+            changes.push_back(inputs[input_index] - state.inputs[input_index]);
+            full = changed_inputs.size() > max_changed_count;
+        }
+    }
+
+    const auto& layer_weights = m_weights.front();
+    if (full) {
+        m_kernels->dense(layer_weights.Data(), layer_weights.Stride(), layer_weights.Rows(), layer_weights.Columns(),
+                         inputs.Data(), m_biases.front().data(), state.sums.data());
+        std::copy_n(inputs.Data(), GetInputsCount(), state.inputs.data());
+        state.parameters_version = m_parameters_version;
+        state.updates_count = 0;
+    } else if (!changed_inputs.empty()) {
+        AddFirstLayerColumns(changed_inputs.data(), changes.data(), changed_inputs.size(), state.sums.data(),
+                             state.sums.data());
+        for (size_t input_index : changed_inputs)
+            state.inputs[input_index] = inputs[input_index];
+        ++state.updates_count;
+    }
+
+    T* layer_outputs = m_weights.size() != 1 ? workspace.outputs.front().data() : outputs.Data();
+    std::copy_n(state.sums.data(), layer_weights.Rows(), layer_outputs);
+    ActivateLayer(0, layer_outputs);
+    const T* layer_inputs = layer_outputs;
+    for (size_t layer_index = 1; layer_index != m_weights.size(); ++layer_index) {
+        layer_outputs = layer_index + 1 != m_weights.size() ? workspace.outputs[layer_index].data() : outputs.Data();
+        ComputeLayer(layer_index, layer_inputs, layer_outputs);
+        layer_inputs = layer_outputs;
+    }
+}
+
+template <typename T, typename W>
+Span<const typename BasicNetwork<T, W>::Candidate> BasicNetwork<T, W>::TopK(Span<const T> inputs, size_t k,
+                                                                            Workspace& workspace) const {
+    ComputeOutput(inputs, workspace, workspace.outputs.back());
+    return SelectTopK(k, workspace);
+}
+
+template <typename T, typename W>
+Span<const typename BasicNetwork<T, W>::Candidate>
+BasicNetwork<T, W>::TopKIncremental(Span<const T> inputs, size_t k, IncrementalState& state,
+                                    Workspace& workspace) const {
+    ComputeOutputIncremental(inputs, state, workspace, workspace.outputs.back());
+    return SelectTopK(k, workspace);
+}
+
+template <typename T, typename W>
+Span<const typename BasicNetwork<T, W>::Candidate> BasicNetwork<T, W>::SelectTopK(size_t k,
+                                                                                  Workspace& workspace) const {
+    const auto& outputs = workspace.outputs.back();
+    auto& candidates = workspace.candidates;
+    candidates.clear();
+    if (k == 0)
+        return candidates;
+
+    // The candidates are kept as a heap with the weakest one on top, which any stronger output replaces. Equal outputs
+    // are ranked by their index, so a later one has to be strictly stronger.
+    const auto is_stronger = [](const Candidate& a, const Candidate& b) {
+        return a.confidence > b.confidence || (a.confidence == b.confidence && a.index < b.index);
+    };
+    T sum = 0;
+    const size_t candidates_count = std::min(k, outputs.size());
+    for (size_t output_index = 0; output_index != candidates_count; ++output_index) {
+        candidates.push_back({output_index, outputs[output_index]});
+        sum += outputs[output_index];
+    }
+    std::make_heap(candidates.begin(), candidates.end(), is_stronger);
+    for (size_t output_index = candidates_count; output_index != outputs.size(); ++output_index) {
+        const T output = outputs[output_index];
+        sum += output;
+        if (output > candidates.front().confidence) {
+            std::pop_heap(candidates.begin(), candidates.end(), is_stronger);
+            candidates.back() = {output_index, output};
+            std::push_heap(candidates.begin(), candidates.end(), is_stronger);
+        }
+    }
+    std::sort_heap(candidates.begin(), candidates.end(), is_stronger);
+
+    for (auto& candidate : candidates)
+        candidate.confidence = sum > 0 ? candidate.confidence / sum : 0;
+    return candidates;
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::ComputeOutputBatch(MatrixView<const T> inputs, MatrixView<T> outputs) const {
+    auto workspace = CreateWorkspace();
+    ComputeOutputBatch(inputs, outputs, workspace);
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::ComputeOutputBatch(MatrixView<const T> inputs, MatrixView<T> outputs,
+                                            Workspace& workspace) const {
+    assert(m_weights.size() > 0);
+    assert(m_weights.size() == m_biases.size());
+    assert(inputs.Columns() == GetInputsCount());
+    assert(outputs.Columns() == GetOutputsCount());
+    assert(inputs.Rows() == outputs.Rows());
+
+    const size_t samples_count = inputs.Rows();
+    ReserveBatch(workspace, samples_count);
+
+    MatrixView<const T> layer_inputs = inputs;
+    for (size_t layer_index = 0; layer_index != m_weights.size(); ++layer_index) {
+        const auto& layer_weights = m_weights[layer_index];
+        // The last layer writes straight into the destination.
+        MatrixView<T> layer_outputs = layer_index + 1 != m_weights.size()
+                                          ? workspace.batch_outputs[layer_index].View().RowRange(0, samples_count)
+                                          : outputs;
+
+        m_kernels->dense_batch(layer_weights.Data(), layer_weights.Stride(), layer_weights.Rows(),
+                               layer_weights.Columns(), layer_inputs.Data(), layer_inputs.Stride(), samples_count,
+                               m_biases[layer_index].data(), layer_outputs.Data(), layer_outputs.Stride());
+        for (size_t sample_index = 0; sample_index != samples_count; ++sample_index)
+            ActivateLayer(layer_index, layer_outputs.Row(sample_index));
+
         // The outputs of this layer will become the inputs for the next one.
-        output_buffer.swap(input_buffer);
+        layer_inputs = layer_outputs;
     }
+}
 
-    // As the input and output buffers are swapped at the end of each iteration,
-    // we have to return the input one as a result.
-    input_buffer.resize(m_weights.back().size());
-    return input_buffer;
+template <typename T, typename W>
+void BasicNetwork<T, W>::Learn(Span<const T> inputs, Span<const T> target_outputs, T rate) {
+    auto workspace = CreateWorkspace();
+    Learn(inputs, target_outputs, rate, workspace);
 }
 
-void Network::Learn(const std::vector<double>& inputs, const std::vector<double>& target_outputs, double rate) {
-    assert(rate > 0.0 && rate <= 1.0);
+template <typename T, typename W>
+void BasicNetwork<T, W>::Learn(Span<const T> inputs, Span<const T> target_outputs, T rate, Workspace& workspace) {
+    assert(rate > 0 && rate <= 1);
     assert(m_weights.size() > 0);
     assert(m_weights.size() == m_biases.size());
-    assert(inputs.size() == m_weights.front().front().size());
-    assert(target_outputs.size() == m_weights.back().size());
+    assert(workspace.outputs.size() == m_weights.size());
+    assert(inputs.Size() == GetInputsCount());
+    assert(target_outputs.Size() == GetOutputsCount());
+
+    if (m_optimizer.type != Optimizer::Type::Sgd) {
+        if (!m_sample_gradients)
+            m_sample_gradients = std::make_unique<Gradients>(CreateGradients());
+        m_sample_gradients->Clear();
+        const MatrixView<const T> sample_inputs(inputs.Data(), 1, inputs.Size(), inputs.Size());
+        const MatrixView<const T> sample_targets(target_outputs.Data(), 1, target_outputs.Size(),
+                                                 target_outputs.Size());
+        AccumulateGradients(sample_inputs, sample_targets, *m_sample_gradients, workspace);
+        ApplyGradients(*m_sample_gradients, rate);
+        return;
+    }
 
     // Perform the forward propagation pass and remember all the outputs.
-    std::vector<std::vector<double>> outputs(m_weights.size());
-    const auto* input_buffer = &inputs;
+    const auto& outputs = workspace.outputs;
+    const T* input_buffer = inputs.Data();
     for (size_t layer_index = 0; layer_index != m_weights.size(); ++layer_index) {
-        auto& output_buffer = outputs[layer_index];
-        output_buffer.resize(m_weights[layer_index].size());
-        ComputeOutputForLayer(layer_index, *input_buffer, output_buffer);
-        input_buffer = &output_buffer;
+        if (layer_index == 0)
+            ComputeFirstLayer(input_buffer, workspace.outputs[layer_index].data(), workspace);
+        else
+            ComputeLayer(layer_index, input_buffer, workspace.outputs[layer_index].data());
+        input_buffer = outputs[layer_index].data();
     }
+    // The first layer's update only needs the non-zero inputs, ComputeFirstLayer has collected them if enabled.
+    // Otherwise collecting them stops as soon as there are too many for the sparse update to pay off.
+    if (!GetSparseInputs())
+        CollectActiveInputs(inputs.Data(), GetInputsCount() / sparse_update_ratio, workspace);
+    const bool sparse_update =
+        GetSparseInputs() || workspace.active_inputs.size() * sparse_update_ratio <= GetInputsCount();
 
-    std::vector<double> error_buffer(m_max_layer_size);
-    std::vector<double> next_error_buffer(m_max_layer_size);
+    auto& error_buffer = workspace.errors;
+    auto& next_error_buffer = workspace.next_errors;
+    auto& scale_buffer = workspace.scales;
 
-    for (size_t output_index = 0; output_index != target_outputs.size(); ++output_index)
+    for (size_t output_index = 0; output_index != target_outputs.Size(); ++output_index)
         error_buffer[output_index] = target_outputs[output_index] - outputs.back()[output_index];
 
     // Perform the backwards propagation pass and correct the weights according to the amount of error for each neuron.
-    // The error values for the next layer are calculated on the fly.
+    // The error values for the next layer are calculated on the fly, there is no need for them on the first layer.
     for (size_t layer_index = m_weights.size(); layer_index-- != 0;) {
-        input_buffer = layer_index != 0 ? &outputs[layer_index - 1] : &inputs;
+        input_buffer = layer_index != 0 ? outputs[layer_index - 1].data() : inputs.Data();
         auto& layer_weights = m_weights[layer_index];
         auto& layer_biases = m_biases[layer_index];
         const auto& layer_outputs = outputs[layer_index];
-        std::fill_n(next_error_buffer.begin(), layer_weights.front().size(), 0);
-        for (size_t output_index = 0; output_index != layer_weights.size(); ++output_index) {
-            auto& output_weights = layer_weights[output_index];
-            const auto& output_derivative = ActivationDerivativeFromValue(layer_outputs[output_index]);
-            double error_value = error_buffer[output_index];
-            for (size_t weight_index = 0; weight_index != output_weights.size(); ++weight_index) {
-                auto& weight = output_weights[weight_index];
-                // Contribute to the error value of each input before changing the weight.
-                next_error_buffer[weight_index] += weight * error_value;
-                // Correct the weight.
-                weight += rate * error_value * output_derivative * input_buffer->at(weight_index);
-            }
+        const bool softmax_layer = IsSoftmaxLayer(layer_index);
+        for (size_t output_index = 0; output_index != layer_weights.Rows(); ++output_index) {
+            const T output_derivative = softmax_layer ? 1 : ActivationDerivativeFromValue(layer_outputs[output_index]);
+            scale_buffer[output_index] = rate * error_buffer[output_index] * output_derivative;
             // Bias is a special case as it does not contribute to any error value.
-            layer_biases[output_index] += rate * error_value * output_derivative;
+            layer_biases[output_index] += scale_buffer[output_index];
+        }
+        if (layer_index == 0 && sparse_update) {
+            UpdateFirstLayerSparse(scale_buffer.data(), workspace);
+            break;
         }
+        std::fill_n(next_error_buffer.begin(), layer_weights.Columns(), 0);
+        m_kernels->backward(layer_weights.Data(), layer_weights.Stride(), layer_weights.Rows(), layer_weights.Columns(),
+                            error_buffer.data(), scale_buffer.data(), input_buffer,
+                            layer_index != 0 ? next_error_buffer.data() : nullptr);
         error_buffer.swap(next_error_buffer);
     }
+    ParametersChanged();
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::LearnBatch(MatrixView<const T> inputs, MatrixView<const T> target_outputs, T rate) {
+    auto gradients = CreateGradients();
+    AccumulateGradients(inputs, target_outputs, gradients);
+    ApplyGradients(gradients, rate);
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::LearnAsync(MatrixView<const T> inputs, MatrixView<const T> target_outputs, T rate) {
+    auto workspace = CreateWorkspace();
+    LearnAsync(inputs, target_outputs, rate, workspace);
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::LearnAsync(MatrixView<const T> inputs, MatrixView<const T> target_outputs, T rate,
+                                    Workspace& workspace) {
+    assert(rate > 0 && rate <= 1);
+    assert(m_weights.size() > 0);
+    assert(m_weights.size() == m_biases.size());
+    assert(workspace.outputs.size() == m_weights.size());
+    assert(inputs.Columns() == GetInputsCount());
+    assert(target_outputs.Columns() == GetOutputsCount());
+    assert(inputs.Rows() == target_outputs.Rows());
+
+    auto& outputs = workspace.outputs;
+    auto& error_buffer = workspace.errors;
+    auto& next_error_buffer = workspace.next_errors;
+    auto& active_inputs = workspace.active_inputs;
+
+    for (size_t sample_index = 0; sample_index != inputs.Rows(); ++sample_index) {
+        const T* sample_inputs = inputs.Row(sample_index);
+        active_inputs.clear();
+        for (size_t input_index = 0; input_index != GetInputsCount(); ++input_index)
+            if (sample_inputs[input_index] != 0)
+                active_inputs.push_back(input_index);
+
+        // Forward pass, the first layer only looks at the non-zero inputs.
+        for (size_t layer_index = 0; layer_index != m_weights.size(); ++layer_index) {
+            const auto& layer_weights = m_weights[layer_index];
+            const auto& layer_biases = m_biases[layer_index];
+            const T* layer_inputs = layer_index != 0 ? outputs[layer_index - 1].data() : sample_inputs;
+            auto& layer_outputs = outputs[layer_index];
+            for (size_t neuron_index = 0; neuron_index != layer_weights.Rows(); ++neuron_index) {
+                const W* row_weights = layer_weights.Row(neuron_index);
+                T sum = RelaxedLoad(&layer_biases[neuron_index]);
+                if (layer_index == 0) {
+                    for (size_t input_index : active_inputs)
+                        sum += static_cast<T>(RelaxedLoad(row_weights + input_index)) * layer_inputs[input_index];
+                } else {
+                    for (size_t input_index = 0; input_index != layer_weights.Columns(); ++input_index)
+                        sum += static_cast<T>(RelaxedLoad(row_weights + input_index)) * layer_inputs[input_index];
+                }
+                layer_outputs[neuron_index] = sum;
+            }
+            ActivateLayer(layer_index, layer_outputs.data());
+        }
+
+        const T* sample_target_outputs = target_outputs.Row(sample_index);
+        for (size_t output_index = 0; output_index != GetOutputsCount(); ++output_index)
+            error_buffer[output_index] = sample_target_outputs[output_index] - outputs.back()[output_index];
+
+        // Backward pass, the same as in Learn. Weights of zero inputs would not change, so they are not written.
+        for (size_t layer_index = m_weights.size(); layer_index-- != 0;) {
+            auto& layer_weights = m_weights[layer_index];
+            auto& layer_biases = m_biases[layer_index];
+            const auto& layer_outputs = outputs[layer_index];
+            const T* layer_inputs = layer_index != 0 ? outputs[layer_index - 1].data() : sample_inputs;
+            if (layer_index != 0)
+                std::fill_n(next_error_buffer.begin(), layer_weights.Columns(), 0);
+
+            const bool softmax_layer = IsSoftmaxLayer(layer_index);
+            for (size_t neuron_index = 0; neuron_index != layer_weights.Rows(); ++neuron_index) {
+                const T error = error_buffer[neuron_index];
+                const T derivative = softmax_layer ? 1 : ActivationDerivativeFromValue(layer_outputs[neuron_index]);
+                const T scale = rate * error * derivative;
+                RelaxedStore(&layer_biases[neuron_index], RelaxedLoad(&layer_biases[neuron_index]) + scale);
+
+                W* row_weights = layer_weights.Row(neuron_index);
+                if (layer_index == 0) {
+                    for (size_t input_index : active_inputs) {
+                        const T weight = static_cast<T>(RelaxedLoad(row_weights + input_index));
+                        const W new_weight = static_cast<W>(weight + scale * layer_inputs[input_index]);
+                        RelaxedStore(row_weights + input_index, new_weight);
+                        if (GetSparseInputs())
+                            RelaxedStore(&m_first_layer_columns(input_index, neuron_index), new_weight);
+                    }
+                } else {
+                    for (size_t input_index = 0; input_index != layer_weights.Columns(); ++input_index) {
+                        const T weight = static_cast<T>(RelaxedLoad(row_weights + input_index));
+                        next_error_buffer[input_index] += weight * error;
+                        RelaxedStore(row_weights + input_index,
+                                     static_cast<W>(weight + scale * layer_inputs[input_index]));
+                    }
+                }
+            }
+            error_buffer.swap(next_error_buffer);
+        }
+    }
+    ParametersChanged();
+}
+
+template <typename T, typename W>
+typename BasicNetwork<T, W>::Gradients BasicNetwork<T, W>::CreateGradients() const {
+    Gradients gradients;
+    gradients.weights.reserve(m_weights.size());
+    gradients.biases.reserve(m_biases.size());
+    for (const auto& layer_weights : m_weights) {
+        gradients.weights.emplace_back(layer_weights.Rows(), layer_weights.Columns());
+        gradients.biases.emplace_back(layer_weights.Rows());
+    }
+    gradients.samples_count = 0;
+    return gradients;
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::AccumulateGradients(MatrixView<const T> inputs, MatrixView<const T> target_outputs,
+                                             Gradients& gradients) const {
+    auto workspace = CreateWorkspace();
+    AccumulateGradients(inputs, target_outputs, gradients, workspace);
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::AccumulateGradients(MatrixView<const T> inputs, MatrixView<const T> target_outputs,
+                                             Gradients& gradients, Workspace& workspace) const {
+    assert(m_weights.size() > 0);
+    assert(m_weights.size() == m_biases.size());
+    assert(gradients.weights.size() == m_weights.size());
+    assert(inputs.Columns() == GetInputsCount());
+    assert(target_outputs.Columns() == GetOutputsCount());
+    assert(inputs.Rows() == target_outputs.Rows());
+
+    const size_t samples_count = inputs.Rows();
+    ReserveBatch(workspace, samples_count);
+    auto& outputs = workspace.batch_outputs;
+
+    // Perform the forward propagation pass for the whole batch and remember all the outputs.
+    MatrixView<const T> layer_inputs = inputs;
+    for (size_t layer_index = 0; layer_index != m_weights.size(); ++layer_index) {
+        const auto& layer_weights = m_weights[layer_index];
+        const auto layer_outputs = outputs[layer_index].View().RowRange(0, samples_count);
+        m_kernels->dense_batch(layer_weights.Data(), layer_weights.Stride(), layer_weights.Rows(),
+                               layer_weights.Columns(), layer_inputs.Data(), layer_inputs.Stride(), samples_count,
+                               m_biases[layer_index].data(), layer_outputs.Data(), layer_outputs.Stride());
+        for (size_t sample_index = 0; sample_index != samples_count; ++sample_index)
+            ActivateLayer(layer_index, layer_outputs.Row(sample_index));
+        layer_inputs = layer_outputs;
+    }
+
+    auto& error_buffer = workspace.batch_errors;
+    auto& next_error_buffer = workspace.batch_next_errors;
+    auto& delta_buffer = workspace.batch_deltas;
+
+    for (size_t sample_index = 0; sample_index != samples_count; ++sample_index)
+        for (size_t output_index = 0; output_index != GetOutputsCount(); ++output_index)
+            error_buffer(sample_index, output_index) =
+                target_outputs(sample_index, output_index) - outputs.back()(sample_index, output_index);
+
+    // Perform the backwards propagation pass, the same as in Learn but without touching the weights.
+    for (size_t layer_index = m_weights.size(); layer_index-- != 0;) {
+        layer_inputs = layer_index != 0 ? outputs[layer_index - 1].View() : inputs;
+        const auto& layer_weights = m_weights[layer_index];
+        const auto& layer_outputs = outputs[layer_index];
+        auto& layer_bias_gradients = gradients.biases[layer_index];
+        const bool softmax_layer = IsSoftmaxLayer(layer_index);
+
+        for (size_t sample_index = 0; sample_index != samples_count; ++sample_index) {
+            for (size_t output_index = 0; output_index != layer_weights.Rows(); ++output_index) {
+                const T output = layer_outputs(sample_index, output_index);
+                const T derivative = softmax_layer ? 1 : ActivationDerivativeFromValue(output);
+                const T delta = error_buffer(sample_index, output_index) * derivative;
+                delta_buffer(sample_index, output_index) = delta;
+                layer_bias_gradients[output_index] += delta;
+            }
+        }
+
+        if (layer_index != 0) {
+            for (size_t sample_index = 0; sample_index != samples_count; ++sample_index)
+                std::fill_n(next_error_buffer.Row(sample_index), layer_weights.Columns(), 0);
+            m_kernels->backward_batch(layer_weights.Data(), layer_weights.Stride(), layer_weights.Rows(),
+                                      layer_weights.Columns(), error_buffer.Data(), error_buffer.Stride(),
+                                      samples_count, next_error_buffer.Data(), next_error_buffer.Stride());
+        }
+
+        auto& layer_gradients = gradients.weights[layer_index];
+        m_kernels->accumulate(layer_gradients.Data(), layer_gradients.Stride(), layer_gradients.Rows(),
+                              layer_gradients.Columns(), delta_buffer.Data(), delta_buffer.Stride(),
+                              layer_inputs.Data(), layer_inputs.Stride(), samples_count);
+
+        error_buffer.Swap(next_error_buffer);
+    }
+
+    gradients.samples_count += samples_count;
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::ApplyGradients(const Gradients& gradients, T rate) {
+    assert(rate > 0 && rate <= 1);
+    assert(gradients.weights.size() == m_weights.size());
+
+    if (gradients.samples_count == 0)
+        return;
+
+    if (m_optimizer.type != Optimizer::Type::Sgd) {
+        const size_t slots_count = GetOptimizerSlotsCount();
+        size_t state_size = 0;
+        for (size_t layer_index = 0; layer_index != m_weights.size(); ++layer_index) {
+            const auto& layer_gradients = gradients.weights[layer_index];
+            state_size += slots_count * (layer_gradients.Rows() * layer_gradients.Stride() +
+                                         Matrix<T>::PaddedStride(m_biases[layer_index].size()));
+        }
+        if (m_optimizer_state.size() != state_size) {
+            m_optimizer_state.assign(state_size, 0);
+            m_optimizer_steps = 0;
+        }
+        ++m_optimizer_steps;
+
+        const T gradient_scale = 1 / static_cast<T>(gradients.samples_count);
+        const T momentum = static_cast<T>(m_optimizer.momentum);
+        const bool nesterov = m_optimizer.type == Optimizer::Type::Nesterov;
+        const T beta1 = static_cast<T>(m_optimizer.beta1);
+        const T beta2 = static_cast<T>(m_optimizer.beta2);
+        const T epsilon = static_cast<T>(m_optimizer.epsilon);
+        // Adam's bias correction of both averages folded into the rate.
+        const T corrected_rate = static_cast<T>(
+            rate * std::sqrt(1 - std::pow(m_optimizer.beta2, static_cast<double>(m_optimizer_steps))) /
+            (1 - std::pow(m_optimizer.beta1, static_cast<double>(m_optimizer_steps))));
+        // Biases are a single row of a matrix with scalar weights.
+        const auto& bias_kernels = Kernels::GetTable<T, T>(m_kernels->instruction_set);
+
+        T* state = m_optimizer_state.data();
+        for (size_t layer_index = 0; layer_index != m_weights.size(); ++layer_index) {
+            auto& layer_weights = m_weights[layer_index];
+            const auto& layer_gradients = gradients.weights[layer_index];
+            const size_t weights_state_size = layer_gradients.Rows() * layer_gradients.Stride();
+            T* weights_state = state;
+            state += slots_count * weights_state_size;
+
+            auto& layer_biases = m_biases[layer_index];
+            const size_t biases_state_size = Matrix<T>::PaddedStride(layer_biases.size());
+            T* biases_state = state;
+            state += slots_count * biases_state_size;
+
+            if (m_optimizer.type == Optimizer::Type::Adam) {
+                m_kernels->adam_update(layer_weights.Data(), layer_weights.Stride(), layer_weights.Rows(),
+                                       layer_weights.Columns(), layer_gradients.Data(), layer_gradients.Stride(),
+                                       weights_state, weights_state + weights_state_size, gradient_scale,
+                                       corrected_rate, beta1, beta2, epsilon);
+                bias_kernels.adam_update(layer_biases.data(), 0, 1, layer_biases.size(),
+                                         gradients.biases[layer_index].data(), 0, biases_state,
+                                         biases_state + biases_state_size, gradient_scale, corrected_rate, beta1,
+                                         beta2, epsilon);
+            } else {
+                m_kernels->momentum_update(layer_weights.Data(), layer_weights.Stride(), layer_weights.Rows(),
+                                           layer_weights.Columns(), layer_gradients.Data(), layer_gradients.Stride(),
+                                           weights_state, gradient_scale, rate, momentum, nesterov);
+                bias_kernels.momentum_update(layer_biases.data(), 0, 1, layer_biases.size(),
+                                             gradients.biases[layer_index].data(), 0, biases_state, gradient_scale,
+                                             rate, momentum, nesterov);
+            }
+        }
+        SyncFirstLayerColumns();
+        ParametersChanged();
+        return;
+    }
+
+    const T scale = rate / static_cast<T>(gradients.samples_count);
+    for (size_t layer_index = 0; layer_index != m_weights.size(); ++layer_index) {
+        auto& layer_weights = m_weights[layer_index];
+        const auto& layer_gradients = gradients.weights[layer_index];
+        m_kernels->update(layer_weights.Data(), layer_weights.Stride(), layer_weights.Rows(), layer_weights.Columns(),
+                          layer_gradients.Data(), layer_gradients.Stride(), scale);
+
+        auto& layer_biases = m_biases[layer_index];
+        const auto& layer_bias_gradients = gradients.biases[layer_index];
+        for (size_t neuron_index = 0; neuron_index != layer_biases.size(); ++neuron_index)
+            layer_biases[neuron_index] += layer_bias_gradients[neuron_index] * scale;
+    }
+    SyncFirstLayerColumns();
+    ParametersChanged();
 }
 
-double Network::ActivationFunction(double x) {
-    // Displaced tanh seems to be pretty fast and relatively easy to differentiate.
-    return 0.5 * (std::tanh(x) + 1);
+template <typename T, typename W>
+void BasicNetwork<T, W>::ParametersChanged() {
+    // LearnAsync callers may get here at the same time.
+    RelaxedStore(&m_parameters_version, ++last_parameters_version);
 }
 
-double Network::ActivationDerivativeFromValue(double y) {
-    return 2.0 * y * (1.0 - y);
+template <typename T, typename W>
+void BasicNetwork<T, W>::SetOptimizer(const Optimizer& optimizer) {
+    m_optimizer = optimizer;
+    m_optimizer_state.clear();
+    m_optimizer_steps = 0;
 }
 
+template <typename T, typename W>
+size_t BasicNetwork<T, W>::GetOptimizerSlotsCount() const {
+    switch (m_optimizer.type) {
+    case Optimizer::Type::Sgd:
+        return 0;
+    case Optimizer::Type::Momentum:
+    case Optimizer::Type::Nesterov:
+        return 1;
+    case Optimizer::Type::Adam:
+        return 2;
+    }
+    return 0;
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::Gradients::Clear() {
+    for (auto& layer_weights : weights)
+        for (size_t row = 0; row != layer_weights.Rows(); ++row)
+            std::fill_n(layer_weights.Row(row), layer_weights.Columns(), 0);
+    for (auto& layer_biases : biases)
+        std::fill(layer_biases.begin(), layer_biases.end(), 0);
+    samples_count = 0;
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::Gradients::Add(const Gradients& other) {
+    assert(weights.size() == other.weights.size());
+    for (size_t layer_index = 0; layer_index != weights.size(); ++layer_index) {
+        auto& layer_weights = weights[layer_index];
+        const auto& other_weights = other.weights[layer_index];
+        for (size_t row = 0; row != layer_weights.Rows(); ++row) {
+            T* row_weights = layer_weights.Row(row);
+            const T* other_row_weights = other_weights.Row(row);
+            for (size_t column = 0; column != layer_weights.Columns(); ++column)
+                row_weights[column] += other_row_weights[column];
+        }
+        for (size_t neuron_index = 0; neuron_index != biases[layer_index].size(); ++neuron_index)
+            biases[layer_index][neuron_index] += other.biases[layer_index][neuron_index];
+    }
+    samples_count += other.samples_count;
+}
+
+template <typename T, typename W>
+void BasicNetwork<T, W>::ActivateLayer(size_t layer_index, T* values) const {
+    Kernels::ActivateLayer(*m_kernels, m_activation, IsSoftmaxLayer(layer_index), values,
+                           m_weights[layer_index].Rows());
+}
+
+template <typename T, typename W>
+T BasicNetwork<T, W>::ActivationDerivativeFromValue(T y) {
+    return 2 * y * (1 - y);
+}
+
+template class BasicNetwork<float>;
+template class BasicNetwork<double>;
+template class BasicNetwork<float, BFloat16>;
+
 } // namespace Neural
@@ -3,40 +3,322 @@
 #include <cstddef>
 #include <cstdint>
 #include <initializer_list>
+#include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 
+#include "bfloat16.h"
+#include "kernels.h"
+#include "matrix.h"
+#include "optimizer.h"
+#include "span.h"
+
 namespace Neural {
 
-class Network {
+// Loss minimized by training, between the outputs of the last layer and the target outputs.
+// The values are stored in model files.
+enum class Loss : std::uint32_t {
+    // Half the sum of the squared differences, the last layer going through the activation function.
+    SquaredError = 0,
+    // Minus the sum of the targets times the logarithms of the outputs, the last layer computing softmax instead of
+    // the activation function so that the outputs are probabilities adding up to one. Suits one-hot targets.
+    CrossEntropy = 1,
+};
+
+inline const char* GetName(Loss loss) {
+    switch (loss) {
+    case Loss::SquaredError:
+        return "Squared error";
+    case Loss::CrossEntropy:
+        return "Cross-entropy";
+    }
+    return "Unknown";
+}
+
+// One of the strongest outputs of a network, with its share of the sum of all outputs: the probability of the output
+// for the cross-entropy loss.
+template <typename T>
+struct BasicCandidate {
+    size_t index;
+    T confidence;
+};
+
+// Scratch memory of the forward and backward passes. A network creates one sized for itself with CreateWorkspace,
+// and the calls taking it reuse its buffers instead of allocating their own. It must not be shared between threads.
+template <typename T>
+struct BasicWorkspace {
+    // Per sample: outputs of every layer, errors of the current and the previous layer and weight correction scales.
+    std::vector<AlignedVector<T>> outputs;
+    AlignedVector<T> errors;
+    AlignedVector<T> next_errors;
+    AlignedVector<T> scales;
+    // Indices and values of the non-zero inputs of the current sample.
+    std::vector<size_t> active_inputs;
+    std::vector<T> active_values;
+    // The strongest outputs chosen by TopK.
+    std::vector<BasicCandidate<T>> candidates;
+
+    // The same for batches, one sample per row. Grown on demand, so only a batch larger than all before allocates.
+    std::vector<Matrix<T>> batch_outputs;
+    Matrix<T> batch_errors;
+    Matrix<T> batch_next_errors;
+    Matrix<T> batch_deltas;
+};
+
+// State of ComputeOutputIncremental between calls: the inputs of the last one and the first layer's sums for them,
+// before the activation. A network creates one sized for itself with CreateIncrementalState.
+template <typename T>
+struct BasicIncrementalState {
+    AlignedVector<T> inputs;
+    AlignedVector<T> sums;
+    // Parameters the sums were computed with, and delta updates applied to them since they were computed in full.
+    std::uint64_t parameters_version = 0;
+    size_t updates_count = 0;
+};
+
+// Fully connected feed-forward network computing in `T`, with weights stored as `W`.
+// Narrower weight storage (e.g. BFloat16 with float arithmetic) halves the memory traffic of the forward pass. It is
+// meant for inference: training rounds every corrected weight back to the storage type, and with the 8 significant
+// bits of BFloat16 a correction below 1/256 of the weight is lost. Train with weights stored as `T` and convert the
+// trained network instead.
+template <typename T, typename W = T>
+class BasicNetwork {
 public:
-    Network(size_t, const std::vector<size_t>&);
-    ~Network();
+    using Scalar = T;
+    using Weight = W;
+
+    // Weight and bias corrections (i.e. the negative loss gradient) summed over a number of samples,
+    // laid out like the parameters of the network they were created for.
+    struct Gradients {
+        std::vector<Matrix<T>> weights;
+        std::vector<AlignedVector<T>> biases;
+        size_t samples_count;
+
+        void Clear();
+        void Add(const Gradients&);
+    };
+
+    BasicNetwork(size_t, const std::vector<size_t>&);
+    // Convert a network with a different weight storage type, e.g. to pack a trained model into BFloat16.
+    template <typename OW>
+    explicit BasicNetwork(const BasicNetwork<T, OW>&);
+    BasicNetwork(const BasicNetwork&);
+    BasicNetwork(BasicNetwork&&) = default;
+    ~BasicNetwork();
+
+    BasicNetwork& operator=(const BasicNetwork&);
+    BasicNetwork& operator=(BasicNetwork&&) = default;
+
+    // Read a model written by DumpToFile with the same scalar and weight types, along with its loss.
+    // The file is mapped into memory and its weights are used in place: pages are read as they are first touched,
+    // and training modifies private copies of them, so loading takes the same time for any model size. Verifying the
+    // checksum reads the whole file and is only done when asked. Returns nothing if the file is missing, was written
+    // for other types or on a machine of the other byte order, or its sizes do not add up to the file's.
+    static std::optional<BasicNetwork> LoadFromFile(const std::string&, bool = false);
+    bool DumpToFile(const std::string&) const;
 
     void Randomize(std::uint64_t);
     // Randomize using current time as a seed.
     void Randomize();
 
-    void ComputeOutputForLayer(size_t, const std::vector<double>&, std::vector<double>&) const;
+    using Workspace = BasicWorkspace<T>;
+
+    Workspace CreateWorkspace() const;
+
+    using IncrementalState = BasicIncrementalState<T>;
+
+    IncrementalState CreateIncrementalState() const;
+
+    void ComputeOutputForLayer(size_t, const std::vector<T>&, std::vector<T>&) const;
+
+    std::vector<T> ComputeOutput(Span<const T>) const;
+    // Write the outputs into the given span, using the workspace instead of allocating.
+    void ComputeOutput(Span<const T>, Workspace&, Span<T>) const;
+    // The same for sparse inputs given as the indices of the non-zero ones and their values, all others being zero.
+    void ComputeOutputSparse(Span<const size_t>, Span<const T>, Workspace&, Span<T>) const;
+    // The same for inputs that change a few at a time, e.g. a glyph while it is drawn. The first layer's sums are kept
+    // in the state and only the weights of the inputs that changed since the last call are added to them, scaled by
+    // the change, before the deeper layers are computed as usual. They are computed in full on the first call, after
+    // the parameters changed, when too many inputs changed for the update to pay off, and every so many calls to keep
+    // rounding errors from accumulating.
+    void ComputeOutputIncremental(Span<const T>, IncrementalState&, Workspace&, Span<T>) const;
 
-    std::vector<double> ComputeOutput(const std::vector<double>&) const;
+    using Candidate = BasicCandidate<T>;
 
-    void Learn(const std::vector<double>&, const std::vector<double>&, double);
+    // The given number of strongest outputs, from the strongest one down, or all of them if there are fewer. They are
+    // chosen in a single pass over the outputs that also sums them up for the confidences, without sorting the others,
+    // and are kept in the workspace until the next call. The outputs are computed into the workspace too.
+    Span<const Candidate> TopK(Span<const T>, size_t, Workspace&) const;
+    // The same for inputs that change a few at a time, see ComputeOutputIncremental.
+    Span<const Candidate> TopKIncremental(Span<const T>, size_t, IncrementalState&, Workspace&) const;
 
-    inline const auto& GetWeights() const { return m_weights; }
-    inline const auto& GetBiases() const { return m_biases; }
+    // Compute the outputs for a batch of samples at once, one sample per row of the (samples x inputs) and
+    // (samples x outputs) matrices. Each layer's weights are loaded once per block of samples instead of per sample.
+    void ComputeOutputBatch(MatrixView<const T>, MatrixView<T>) const;
+    void ComputeOutputBatch(MatrixView<const T>, MatrixView<T>, Workspace&) const;
 
+    // Only the first layer's weights of non-zero inputs are updated, when there are few enough of them to be worth it.
+    // With an optimizer other than Sgd every sample goes through AccumulateGradients and ApplyGradients.
+    void Learn(Span<const T>, Span<const T>, T);
+    void Learn(Span<const T>, Span<const T>, T, Workspace&);
+
+    // Mini-batch training, one sample per row of the inputs and target outputs matrices.
+    // The corrections of the whole batch are accumulated first and then applied at once, averaged over the batch.
+    void LearnBatch(MatrixView<const T>, MatrixView<const T>, T);
+
+    // Hogwild-style training: per-sample updates like Learn, one sample per row, but the parameters are only accessed
+    // with relaxed atomic loads and stores, so several threads may train the same network at once without locking.
+    // Concurrent updates of the same parameter may overwrite each other. Zero inputs are skipped, so sparse samples
+    // mostly touch disjoint first layer weights. Always plain SGD, regardless of the optimizer.
+    void LearnAsync(MatrixView<const T>, MatrixView<const T>, T);
+    void LearnAsync(MatrixView<const T>, MatrixView<const T>, T, Workspace&);
+
+    Gradients CreateGradients() const;
+    // Run the forward and backward passes for a batch and add its corrections to the gradients, leaving weights as is.
+    void AccumulateGradients(MatrixView<const T>, MatrixView<const T>, Gradients&) const;
+    void AccumulateGradients(MatrixView<const T>, MatrixView<const T>, Gradients&, Workspace&) const;
+    // Apply the average of the accumulated corrections scaled by the learning rate, following the optimizer.
+    void ApplyGradients(const Gradients&, T);
+
+    // Setting the optimizer resets its state.
+    void SetOptimizer(const Optimizer&);
+    inline const Optimizer& GetOptimizer() const { return m_optimizer; }
+
+    // Weights of a layer as a (neurons x inputs) row-major matrix.
+    inline MatrixView<const W> GetWeights(size_t layer_index) const { return m_weights[layer_index]; }
+    inline const auto& GetBiases(size_t layer_index) const { return m_biases[layer_index]; }
+
+    // Zero the weights of a layer wherever the (neurons x inputs) mask is zero, e.g. to prune them.
+    void ZeroWeights(size_t, MatrixView<const std::uint8_t>);
+
+    inline size_t GetLayersCount() const { return m_weights.size(); }
+    inline size_t GetLayerSize(size_t layer_index) const { return m_weights[layer_index].Rows(); }
     inline size_t GetMaxLayerSize() const { return m_max_layer_size; }
 
-    inline size_t GetInputsCount() const { return m_weights.front().front().size(); }
-    inline size_t GetOutputsCount() const { return m_weights.back().size(); }
+    inline size_t GetInputsCount() const { return m_weights.front().Columns(); }
+    inline size_t GetOutputsCount() const { return m_weights.back().Rows(); }
+
+    // Kernels are chosen at construction to match the CPU, this allows to override the choice.
+    void SetInstructionSet(Kernels::InstructionSet);
+    inline Kernels::InstructionSet GetInstructionSet() const { return m_kernels->instruction_set; }
+
+    // The activation function is the std::tanh one by default, a vectorized approximation can be chosen instead.
+    // Its derivative is computed from the activation values, so it follows whichever is chosen.
+    inline void SetActivation(Kernels::Activation activation) { m_activation = activation; }
+    inline Kernels::Activation GetActivation() const { return m_activation; }
+
+    // Setting the loss changes what the last layer computes, see Loss. With the cross-entropy the errors of the
+    // softmax sums are the targets minus the outputs, its exact gradient, in place of going through the derivative
+    // of the activation function, which all but stops the learning of saturated outputs that are wrong.
+    inline void SetLoss(Loss loss) { m_loss = loss; }
+    inline Loss GetLoss() const { return m_loss; }
+
+    // Keep a column-major copy of the first layer's weights, so that inputs which are mostly zeros are computed as a
+    // gather over the columns of the non-zero ones. ComputeOutput and Learn take that path when at most a third of the
+    // inputs are non-zero, and Learn updates the copy for them. It takes as much memory as the first layer and
+    // training keeps it up to date.
+    void SetSparseInputs(bool);
+    inline bool GetSparseInputs() const { return m_first_layer_columns.Rows() != 0; }
 
 private:
-    std::vector<std::vector<std::vector<double>>> m_weights;
-    std::vector<std::vector<double>> m_biases;
+    // Views into a single block holding the weights of every layer one after another, laid out like Matrix.
+    std::vector<MatrixView<W>> m_weights;
+    std::vector<AlignedVector<T>> m_biases;
     size_t m_max_layer_size;
+    const Kernels::Table<T, W>* m_kernels;
+    Kernels::Activation m_activation;
+    Loss m_loss;
+    // Keeps the weights block alive, it is either owned by the network or a mapped model file.
+    std::shared_ptr<void> m_weights_storage;
+    Optimizer m_optimizer;
+    // Per layer, the optimizer's state slots for the weights, laid out like Gradients, followed by those for the
+    // biases. Allocated on the first step that needs it. It is kept apart from the weights rather than interleaved with
+    // them: the weights block may be a mapped model file, the state is stored as `T` even when the weights are not,
+    // and interleaving would widen the rows that the forward pass streams through with values it never reads.
+    AlignedVector<T> m_optimizer_state;
+    size_t m_optimizer_steps;
+    // Single sample corrections of Learn when it goes through the optimizer.
+    std::unique_ptr<Gradients> m_sample_gradients;
+    // Column-major copy of the first layer's weights, one row per input, while sparse inputs are enabled.
+    Matrix<W> m_first_layer_columns;
+    // Unique among all networks for every set of parameters, so that incremental states know when to start over.
+    std::uint64_t m_parameters_version;
+
+    BasicNetwork();
+
+    // Point the weight views at a new zeroed block for the given topology.
+    void AllocateWeights(size_t, const std::vector<size_t>&);
+
+    void ComputeLayer(size_t, const T*, T*) const;
+    // The first layer, as a gather over the non-zero inputs when there are few enough of them.
+    void ComputeFirstLayer(const T*, T*, Workspace&) const;
+    void ComputeFirstLayerSparse(const size_t*, const T*, size_t, T*) const;
+    // The sums of the first layer before the activation, starting from the given ones instead of the biases.
+    void AddFirstLayerColumns(const size_t*, const T*, size_t, const T*, T*) const;
+    // Correct the first layer's weights of the active inputs of the workspace only, the others have zero inputs.
+    void UpdateFirstLayerSparse(const T*, const Workspace&);
+    // Fill the active inputs of the workspace with the non-zero inputs of a sample, stopping as soon as there are more
+    // than the given number of them.
+    void CollectActiveInputs(const T*, size_t, Workspace&) const;
+    // Copy the first layer's weights of the given inputs (or all of them) into the column-major copy, if enabled.
+    void SyncFirstLayerColumns(const std::vector<size_t>&);
+    void SyncFirstLayerColumns();
+    // Make sure the batch buffers of the workspace fit the given number of samples.
+    void ReserveBatch(Workspace&, size_t) const;
+    // Choose the strongest outputs of the last layer in the workspace, for TopK.
+    Span<const Candidate> SelectTopK(size_t, Workspace&) const;
+    // Give the parameters a new version after they have been modified.
+    void ParametersChanged();
+
+    // Number of state values the optimizer keeps per parameter.
+    size_t GetOptimizerSlotsCount() const;
 
-    static double ActivationFunction(double);
-    static double ActivationDerivativeFromValue(double);
+    // Apply what a layer computes from its sums in place, see Kernels::ActivateLayer.
+    void ActivateLayer(size_t, T*) const;
+    // Whether the outputs of a layer are computed with softmax.
+    inline bool IsSoftmaxLayer(size_t layer_index) const {
+        return m_loss == Loss::CrossEntropy && layer_index + 1 == m_weights.size();
+    }
+
+    // Derivative of the displaced tanh, computed from its value.
+    static T ActivationDerivativeFromValue(T);
 };
 
+template <typename T, typename W>
+template <typename OW>
+BasicNetwork<T, W>::BasicNetwork(const BasicNetwork<T, OW>& other)
+    : m_weights(), m_biases(), m_max_layer_size(other.GetMaxLayerSize()), m_kernels(&Kernels::GetTable<T, W>()),
+      m_activation(other.GetActivation()), m_loss(other.GetLoss()), m_weights_storage(),
+      m_optimizer(other.GetOptimizer()), m_optimizer_state(), m_optimizer_steps(0), m_sample_gradients(),
+      m_first_layer_columns(), m_parameters_version(0) {
+    std::vector<size_t> layer_sizes;
+    for (size_t layer_index = 0; layer_index != other.GetLayersCount(); ++layer_index)
+        layer_sizes.push_back(other.GetLayerSize(layer_index));
+    AllocateWeights(other.GetInputsCount(), layer_sizes);
+
+    m_biases.reserve(other.GetLayersCount());
+    for (size_t layer_index = 0; layer_index != other.GetLayersCount(); ++layer_index) {
+        const auto other_weights = other.GetWeights(layer_index);
+        const auto& layer_weights = m_weights[layer_index];
+        for (size_t neuron_index = 0; neuron_index != other_weights.Rows(); ++neuron_index)
+            for (size_t input_index = 0; input_index != other_weights.Columns(); ++input_index)
+                layer_weights(neuron_index, input_index) =
+                    static_cast<W>(static_cast<T>(other_weights(neuron_index, input_index)));
+        m_biases.emplace_back(other.GetBiases(layer_index));
+    }
+    SetSparseInputs(other.GetSparseInputs());
+    ParametersChanged();
+}
+
+extern template class BasicNetwork<float>;
+extern template class BasicNetwork<double>;
+extern template class BasicNetwork<float, BFloat16>;
+
+// Single precision is accurate enough for the task and twice as fast as double.
+using Network = BasicNetwork<float>;
+using Workspace = BasicWorkspace<float>;
+using IncrementalState = BasicIncrementalState<float>;
+using Candidate = BasicCandidate<float>;
+
 } // namespace Neural
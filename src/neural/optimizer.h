@@ -0,0 +1,42 @@
+#pragma once
+
+namespace Neural {
+
+// Rule turning the corrections of Learn, LearnBatch and ApplyGradients into parameter updates.
+// Every rule but Sgd keeps per-parameter state, which the network stores in a block laid out like its weights.
+struct Optimizer {
+    enum class Type {
+        // weights += rate * corrections
+        Sgd,
+        // Accumulate the corrections into a decaying velocity and step along it.
+        Momentum,
+        // Momentum evaluated at the look-ahead position, which overshoots less.
+        Nesterov,
+        // Per-parameter rates from running averages of the corrections and their squares.
+        Adam,
+    };
+
+    Type type = Type::Sgd;
+    // Velocity decay of Momentum and Nesterov.
+    double momentum = 0.9;
+    // Decays of Adam's first and second moment averages, and the term keeping its steps finite.
+    double beta1 = 0.9;
+    double beta2 = 0.999;
+    double epsilon = 1e-8;
+};
+
+inline const char* GetName(Optimizer::Type type) {
+    switch (type) {
+    case Optimizer::Type::Sgd:
+        return "SGD";
+    case Optimizer::Type::Momentum:
+        return "Momentum";
+    case Optimizer::Type::Nesterov:
+        return "Nesterov";
+    case Optimizer::Type::Adam:
+        return "Adam";
+    }
+    return "Unknown";
+}
+
+} // namespace Neural
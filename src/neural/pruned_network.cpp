@@ -0,0 +1,174 @@
+#include "pruned_network.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace Neural {
+
+WeightPruning::WeightPruning(const Network& network, double sparsity) : m_masks() {
+    assert(sparsity >= 0 && sparsity <= 1);
+
+    std::vector<float> magnitudes;
+    m_masks.reserve(network.GetLayersCount());
+    for (size_t layer_index = 0; layer_index != network.GetLayersCount(); ++layer_index) {
+        const auto weights = network.GetWeights(layer_index);
+        auto& mask = m_masks.emplace_back(weights.Rows(), weights.Columns());
+
+        const size_t weights_count = weights.Rows() * weights.Columns();
+        size_t pruned_count = std::min(static_cast<size_t>(std::lround(weights_count * sparsity)), weights_count);
+
+        // Everything below the magnitude of the last pruned weight goes, and as many as needed of those equal to it.
+        magnitudes.clear();
+        for (size_t neuron_index = 0; neuron_index != weights.Rows(); ++neuron_index)
+            for (size_t input_index = 0; input_index != weights.Columns(); ++input_index)
+                magnitudes.push_back(std::fabs(weights(neuron_index, input_index)));
+        float threshold = -1;
+        if (pruned_count != 0) {
+            std::nth_element(magnitudes.begin(), magnitudes.begin() + (pruned_count - 1), magnitudes.end());
+            threshold = magnitudes[pruned_count - 1];
+        }
+        size_t below_count = 0;
+        for (size_t neuron_index = 0; neuron_index != weights.Rows(); ++neuron_index)
+            for (size_t input_index = 0; input_index != weights.Columns(); ++input_index)
+                below_count += std::fabs(weights(neuron_index, input_index)) < threshold;
+
+        size_t ties_count = pruned_count - below_count;
+        for (size_t neuron_index = 0; neuron_index != weights.Rows(); ++neuron_index) {
+            for (size_t input_index = 0; input_index != weights.Columns(); ++input_index) {
+                const float magnitude = std::fabs(weights(neuron_index, input_index));
+                bool pruned = magnitude < threshold;
+                if (magnitude == threshold && ties_count != 0) {
+                    pruned = true;
+                    --ties_count;
+                }
+                mask(neuron_index, input_index) = pruned ? 0 : 1;
+            }
+        }
+    }
+}
+
+void WeightPruning::Apply(Network& network) const {
+    assert(network.GetLayersCount() == m_masks.size());
+    for (size_t layer_index = 0; layer_index != m_masks.size(); ++layer_index)
+        network.ZeroWeights(layer_index, m_masks[layer_index].View());
+}
+
+void WeightPruning::FineTune(Network& network, MatrixView<const float> inputs, MatrixView<const float> target_outputs,
+                             float rate, size_t batch_size, size_t epochs_count) const {
+    assert(inputs.Rows() == target_outputs.Rows());
+    assert(batch_size > 0);
+
+    Apply(network);
+    for (size_t epoch = 0; epoch != epochs_count; ++epoch) {
+        for (size_t first_sample = 0; first_sample < inputs.Rows(); first_sample += batch_size) {
+            const size_t samples_count = std::min(batch_size, inputs.Rows() - first_sample);
+            network.LearnBatch(inputs.RowRange(first_sample, samples_count),
+                               target_outputs.RowRange(first_sample, samples_count), rate);
+            Apply(network);
+        }
+    }
+}
+
+double WeightPruning::GetSparsity() const {
+    size_t weights_count = 0;
+    size_t pruned_count = 0;
+    for (const auto& mask : m_masks) {
+        weights_count += mask.Rows() * mask.Columns();
+        for (size_t neuron_index = 0; neuron_index != mask.Rows(); ++neuron_index)
+            pruned_count += std::count(mask.Row(neuron_index), mask.Row(neuron_index) + mask.Columns(), 0);
+    }
+    return weights_count != 0 ? static_cast<double>(pruned_count) / weights_count : 0;
+}
+
+PrunedNetwork::PrunedNetwork(const Network& network)
+    : m_layers(network.GetLayersCount()), m_max_layer_size(network.GetMaxLayerSize()),
+      m_kernels(&Kernels::GetTable<float>(network.GetInstructionSet())), m_activation(network.GetActivation()),
+      m_loss(network.GetLoss()) {
+    for (size_t layer_index = 0; layer_index != m_layers.size(); ++layer_index) {
+        const auto weights = network.GetWeights(layer_index);
+        auto& layer = m_layers[layer_index];
+        assert(weights.Rows() * weights.Columns() <= std::numeric_limits<std::uint32_t>::max());
+
+        layer.columns = weights.Columns();
+        layer.offsets.reserve(weights.Rows() + 1);
+        layer.offsets.push_back(0);
+        for (size_t neuron_index = 0; neuron_index != weights.Rows(); ++neuron_index) {
+            const float* row_weights = weights.Row(neuron_index);
+            for (size_t input_index = 0; input_index != weights.Columns(); ++input_index) {
+                if (row_weights[input_index] != 0) {
+                    layer.values.push_back(row_weights[input_index]);
+                    layer.indices.push_back(static_cast<std::uint32_t>(input_index));
+                }
+            }
+            layer.offsets.push_back(static_cast<std::uint32_t>(layer.values.size()));
+        }
+        layer.biases.assign(network.GetBiases(layer_index).begin(), network.GetBiases(layer_index).end());
+    }
+}
+
+PrunedNetwork::~PrunedNetwork() {}
+
+void PrunedNetwork::SetInstructionSet(Kernels::InstructionSet instruction_set) {
+    m_kernels = &Kernels::GetTable<float>(instruction_set);
+}
+
+size_t PrunedNetwork::GetWeightsCount() const {
+    size_t count = 0;
+    for (const auto& layer : m_layers)
+        count += layer.values.size();
+    return count;
+}
+
+size_t PrunedNetwork::GetParametersSize() const {
+    size_t size = 0;
+    for (const auto& layer : m_layers)
+        size += layer.values.size() * (sizeof(float) + sizeof(std::uint32_t)) +
+                layer.offsets.size() * sizeof(std::uint32_t) + layer.biases.size() * sizeof(float);
+    return size;
+}
+
+std::vector<float> PrunedNetwork::ComputeOutput(const std::vector<float>& inputs) const {
+    assert(inputs.size() == GetInputsCount());
+
+    std::vector<float> outputs(GetOutputsCount());
+    std::vector<float> input_buffer(m_max_layer_size);
+    std::vector<float> output_buffer(m_max_layer_size);
+    ComputeSample(inputs.data(), outputs.data(), input_buffer, output_buffer);
+    return outputs;
+}
+
+void PrunedNetwork::ComputeOutputBatch(MatrixView<const float> inputs, MatrixView<float> outputs) const {
+    assert(inputs.Columns() == GetInputsCount());
+    assert(outputs.Columns() == GetOutputsCount());
+    assert(inputs.Rows() == outputs.Rows());
+
+    std::vector<float> input_buffer(m_max_layer_size);
+    std::vector<float> output_buffer(m_max_layer_size);
+    for (size_t sample_index = 0; sample_index != inputs.Rows(); ++sample_index)
+        ComputeSample(inputs.Row(sample_index), outputs.Row(sample_index), input_buffer, output_buffer);
+}
+
+void PrunedNetwork::ComputeSample(const float* inputs, float* outputs, std::vector<float>& input_buffer,
+                                  std::vector<float>& output_buffer) const {
+    const float* layer_inputs = inputs;
+    for (size_t layer_index = 0; layer_index != m_layers.size(); ++layer_index) {
+        const auto& layer = m_layers[layer_index];
+        const size_t outputs_count = layer.biases.size();
+
+        // The last layer writes straight into the destination.
+        float* layer_outputs = layer_index + 1 != m_layers.size() ? output_buffer.data() : outputs;
+        m_kernels->csr_dense(layer.values.data(), layer.indices.data(), layer.offsets.data(), outputs_count,
+                             layer_inputs, layer.biases.data(), layer_outputs);
+        Kernels::ActivateLayer(*m_kernels, m_activation,
+                               layer_index + 1 == m_layers.size() && m_loss == Loss::CrossEntropy, layer_outputs,
+                               outputs_count);
+
+        // The outputs of this layer are gathered from by the next one, which writes into the other buffer.
+        input_buffer.swap(output_buffer);
+        layer_inputs = input_buffer.data();
+    }
+}
+
+} // namespace Neural
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "kernels.h"
+#include "matrix.h"
+#include "network.h"
+
+namespace Neural {
+
+// Magnitude pruning of a trained network: in every layer, the given fraction of the weights with the smallest
+// magnitude is chosen to be zeroed. The choice is kept, so that fine-tuning can zero the same weights again after
+// every step instead of letting them grow back.
+class WeightPruning {
+public:
+    WeightPruning(const Network&, double);
+
+    // Zero the pruned weights.
+    void Apply(Network&) const;
+
+    // Train the remaining weights on the samples, one per row, in mini-batches of the given size with LearnBatch,
+    // for the given number of epochs. The pruned weights are zeroed after every batch.
+    void FineTune(Network&, MatrixView<const float>, MatrixView<const float>, float, size_t, size_t) const;
+
+    // Fraction of all the weights that are pruned.
+    double GetSparsity() const;
+
+private:
+    // Per layer, 1 for the weights that are kept and 0 for the pruned ones.
+    std::vector<Matrix<std::uint8_t>> m_masks;
+};
+
+// Inference-only copy of a network that keeps only its non-zero weights, stored as compressed sparse rows: the
+// values and column indices of the non-zero weights of each neuron, one neuron after another, and the offset of
+// each neuron's first one. Once most weights are pruned it takes a fraction of the memory of the dense network,
+// and each neuron costs one gathered multiply-add per remaining weight.
+class PrunedNetwork {
+public:
+    explicit PrunedNetwork(const Network&);
+    ~PrunedNetwork();
+
+    std::vector<float> ComputeOutput(const std::vector<float>&) const;
+
+    // One sample per row of the (samples x inputs) and (samples x outputs) matrices.
+    void ComputeOutputBatch(MatrixView<const float>, MatrixView<float>) const;
+
+    inline size_t GetLayersCount() const { return m_layers.size(); }
+    inline size_t GetInputsCount() const { return m_layers.front().columns; }
+    inline size_t GetOutputsCount() const { return m_layers.back().biases.size(); }
+
+    // Number of non-zero weights kept.
+    size_t GetWeightsCount() const;
+    // Bytes taken by the parameters and the indices.
+    size_t GetParametersSize() const;
+
+    void SetInstructionSet(Kernels::InstructionSet);
+    inline Kernels::InstructionSet GetInstructionSet() const { return m_kernels->instruction_set; }
+
+    inline void SetActivation(Kernels::Activation activation) { m_activation = activation; }
+    inline Kernels::Activation GetActivation() const { return m_activation; }
+
+    inline void SetLoss(Loss loss) { m_loss = loss; }
+    inline Loss GetLoss() const { return m_loss; }
+
+private:
+    struct Layer {
+        size_t columns;
+        std::vector<float> values;
+        std::vector<std::uint32_t> indices;
+        // One more than the neurons, the last one being the number of non-zero weights.
+        std::vector<std::uint32_t> offsets;
+        std::vector<float> biases;
+    };
+
+    std::vector<Layer> m_layers;
+    size_t m_max_layer_size;
+    const Kernels::Table<float>* m_kernels;
+    Kernels::Activation m_activation;
+    Loss m_loss;
+
+    void ComputeSample(const float*, float*, std::vector<float>&, std::vector<float>&) const;
+};
+
+} // namespace Neural
@@ -0,0 +1,151 @@
+#include "quantized_network.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace Neural {
+
+namespace {
+
+constexpr std::int32_t input_levels = std::numeric_limits<std::uint8_t>::max();
+constexpr std::int32_t weight_levels = std::numeric_limits<std::int8_t>::max();
+
+} // namespace
+
+QuantizedNetwork::QuantizedNetwork(const Network& network, MatrixView<const float> calibration_inputs)
+    : m_layers(network.GetLayersCount()), m_max_layer_size(network.GetMaxLayerSize()),
+      m_kernels(&Kernels::GetQuantizedTable()), m_float_kernels(&Kernels::GetTable<float>()),
+      m_activation(network.GetActivation()), m_loss(network.GetLoss()) {
+    assert(calibration_inputs.Rows() == 0 || calibration_inputs.Columns() == network.GetInputsCount());
+
+    // Observe the range of the inputs of every layer, i.e. of the network inputs and every hidden layer's outputs.
+    std::vector<float> minimums(m_layers.size(), 0);
+    std::vector<float> maximums(m_layers.size(), 1);
+    if (calibration_inputs.Rows() != 0) {
+        std::fill(minimums.begin(), minimums.end(), std::numeric_limits<float>::max());
+        std::fill(maximums.begin(), maximums.end(), std::numeric_limits<float>::lowest());
+    }
+    std::vector<float> input_buffer(m_max_layer_size);
+    std::vector<float> output_buffer(m_max_layer_size);
+    for (size_t sample_index = 0; sample_index != calibration_inputs.Rows(); ++sample_index) {
+        const float* sample_inputs = calibration_inputs.Row(sample_index);
+        std::copy(sample_inputs, sample_inputs + calibration_inputs.Columns(), input_buffer.begin());
+        for (size_t layer_index = 0; layer_index != m_layers.size(); ++layer_index) {
+            const size_t inputs_count = network.GetWeights(layer_index).Columns();
+            const auto [minimum, maximum] =
+                std::minmax_element(input_buffer.begin(), input_buffer.begin() + inputs_count);
+            minimums[layer_index] = std::min(minimums[layer_index], *minimum);
+            maximums[layer_index] = std::max(maximums[layer_index], *maximum);
+            network.ComputeOutputForLayer(layer_index, input_buffer, output_buffer);
+            output_buffer.swap(input_buffer);
+        }
+    }
+
+    for (size_t layer_index = 0; layer_index != m_layers.size(); ++layer_index) {
+        const auto weights = network.GetWeights(layer_index);
+        auto& layer = m_layers[layer_index];
+
+        // Zero must be exactly representable, zero inputs then contribute nothing just like in float.
+        const float minimum = std::min(minimums[layer_index], 0.0f);
+        const float maximum = std::max(maximums[layer_index], 0.0f);
+        layer.input_scale = maximum > minimum ? (maximum - minimum) / input_levels : 1;
+        layer.input_zero_point = static_cast<std::int32_t>(std::lround(-minimum / layer.input_scale));
+
+        layer.weights = Matrix<std::int8_t>(weights.Rows(), weights.Columns());
+        layer.weight_scales.resize(weights.Rows());
+        layer.weight_sums.resize(weights.Rows());
+        layer.biases.assign(network.GetBiases(layer_index).begin(), network.GetBiases(layer_index).end());
+        for (size_t neuron_index = 0; neuron_index != weights.Rows(); ++neuron_index) {
+            const float* row_weights = weights.Row(neuron_index);
+            float largest = 0;
+            for (size_t input_index = 0; input_index != weights.Columns(); ++input_index)
+                largest = std::max(largest, std::fabs(row_weights[input_index]));
+            const float scale = largest > 0 ? largest / weight_levels : 1;
+
+            std::int8_t* quantized_weights = layer.weights.Row(neuron_index);
+            std::int32_t sum = 0;
+            for (size_t input_index = 0; input_index != weights.Columns(); ++input_index) {
+                quantized_weights[input_index] =
+                    static_cast<std::int8_t>(std::lround(row_weights[input_index] / scale));
+                sum += quantized_weights[input_index];
+            }
+            layer.weight_scales[neuron_index] = scale;
+            layer.weight_sums[neuron_index] = sum;
+        }
+    }
+}
+
+QuantizedNetwork::~QuantizedNetwork() {}
+
+void QuantizedNetwork::SetInstructionSet(Kernels::InstructionSet instruction_set) {
+    m_kernels = &Kernels::GetQuantizedTable(instruction_set);
+    m_float_kernels = &Kernels::GetTable<float>(instruction_set);
+}
+
+size_t QuantizedNetwork::GetParametersSize() const {
+    size_t size = 0;
+    for (const auto& layer : m_layers)
+        size += layer.weights.Rows() * layer.weights.Columns() * sizeof(std::int8_t) +
+                layer.weights.Rows() * (sizeof(float) + sizeof(std::int32_t) + sizeof(float));
+    return size;
+}
+
+std::vector<float> QuantizedNetwork::ComputeOutput(const std::vector<float>& inputs) const {
+    assert(inputs.size() == GetInputsCount());
+
+    std::vector<float> outputs(GetOutputsCount());
+    std::vector<std::uint8_t> quantized_buffer(m_max_layer_size);
+    std::vector<std::int32_t> sum_buffer(m_max_layer_size);
+    std::vector<float> value_buffer(m_max_layer_size);
+    ComputeSample(inputs.data(), outputs.data(), quantized_buffer, sum_buffer, value_buffer);
+    return outputs;
+}
+
+void QuantizedNetwork::ComputeOutputBatch(MatrixView<const float> inputs, MatrixView<float> outputs) const {
+    assert(inputs.Columns() == GetInputsCount());
+    assert(outputs.Columns() == GetOutputsCount());
+    assert(inputs.Rows() == outputs.Rows());
+
+    std::vector<std::uint8_t> quantized_buffer(m_max_layer_size);
+    std::vector<std::int32_t> sum_buffer(m_max_layer_size);
+    std::vector<float> value_buffer(m_max_layer_size);
+    for (size_t sample_index = 0; sample_index != inputs.Rows(); ++sample_index)
+        ComputeSample(inputs.Row(sample_index), outputs.Row(sample_index), quantized_buffer, sum_buffer, value_buffer);
+}
+
+void QuantizedNetwork::ComputeSample(const float* inputs, float* outputs, std::vector<std::uint8_t>& quantized_buffer,
+                                     std::vector<std::int32_t>& sum_buffer, std::vector<float>& value_buffer) const {
+    const float* layer_inputs = inputs;
+    for (size_t layer_index = 0; layer_index != m_layers.size(); ++layer_index) {
+        const auto& layer = m_layers[layer_index];
+        const size_t inputs_count = layer.weights.Columns();
+        const size_t outputs_count = layer.weights.Rows();
+
+        // Inputs outside of the calibrated range are clamped.
+        const float inverse_scale = 1 / layer.input_scale;
+        for (size_t input_index = 0; input_index != inputs_count; ++input_index) {
+            const auto level = std::lround(layer_inputs[input_index] * inverse_scale) + layer.input_zero_point;
+            quantized_buffer[input_index] = static_cast<std::uint8_t>(std::clamp<long>(level, 0, input_levels));
+        }
+
+        m_kernels->dense(layer.weights.Data(), layer.weights.Stride(), outputs_count, inputs_count,
+                         quantized_buffer.data(), sum_buffer.data());
+
+        // The last layer writes straight into the destination.
+        const bool last_layer = layer_index + 1 == m_layers.size();
+        float* layer_outputs = !last_layer ? value_buffer.data() : outputs;
+        for (size_t neuron_index = 0; neuron_index != outputs_count; ++neuron_index) {
+            const std::int32_t sum =
+                sum_buffer[neuron_index] - layer.input_zero_point * layer.weight_sums[neuron_index];
+            const float scale = layer.weight_scales[neuron_index] * layer.input_scale;
+            layer_outputs[neuron_index] = static_cast<float>(sum) * scale + layer.biases[neuron_index];
+        }
+        Kernels::ActivateLayer(*m_float_kernels, m_activation, last_layer && m_loss == Loss::CrossEntropy,
+                               layer_outputs, outputs_count);
+        layer_inputs = layer_outputs;
+    }
+}
+
+} // namespace Neural
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "kernels.h"
+#include "matrix.h"
+#include "network.h"
+
+namespace Neural {
+
+// Post-training int8 quantization of a trained network, for inference only.
+// Weights are stored as int8 with a scale per neuron, and the inputs of every layer as uint8 with a scale and
+// zero point per layer, calibrated on representative samples. Dot products are accumulated exactly in int32 and
+// dequantized before adding the bias and applying the activation, which is computed in float with the network's
+// approximation and kernels, as is the softmax of the last layer for the cross-entropy loss.
+class QuantizedNetwork {
+public:
+    // Calibrate the input ranges on the given samples, one per row. Without samples the range is [0, 1].
+    QuantizedNetwork(const Network&, MatrixView<const float>);
+    ~QuantizedNetwork();
+
+    std::vector<float> ComputeOutput(const std::vector<float>&) const;
+
+    // One sample per row of the (samples x inputs) and (samples x outputs) matrices.
+    void ComputeOutputBatch(MatrixView<const float>, MatrixView<float>) const;
+
+    inline size_t GetLayersCount() const { return m_layers.size(); }
+    inline size_t GetInputsCount() const { return m_layers.front().weights.Columns(); }
+    inline size_t GetOutputsCount() const { return m_layers.back().weights.Rows(); }
+
+    // Bytes taken by the parameters, without the row padding.
+    size_t GetParametersSize() const;
+
+    void SetInstructionSet(Kernels::InstructionSet);
+    inline Kernels::InstructionSet GetInstructionSet() const { return m_kernels->instruction_set; }
+
+    inline void SetActivation(Kernels::Activation activation) { m_activation = activation; }
+    inline Kernels::Activation GetActivation() const { return m_activation; }
+
+private:
+    struct Layer {
+        Matrix<std::int8_t> weights;
+        std::vector<float> weight_scales;
+        // Sum of every row of quantized weights, to take the input zero point out of the dot products.
+        std::vector<std::int32_t> weight_sums;
+        std::vector<float> biases;
+        float input_scale;
+        std::int32_t input_zero_point;
+    };
+
+    std::vector<Layer> m_layers;
+    size_t m_max_layer_size;
+    const Kernels::QuantizedTable* m_kernels;
+    // For the activation of the dequantized sums, computed like in Network.
+    const Kernels::Table<float>* m_float_kernels;
+    Kernels::Activation m_activation;
+    Loss m_loss;
+
+    void ComputeSample(const float*, float*, std::vector<std::uint8_t>&, std::vector<std::int32_t>&,
+                       std::vector<float>&) const;
+};
+
+} // namespace Neural
@@ -0,0 +1,230 @@
+#include "sequential_network.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Neural {
+
+namespace {
+
+// Outputs computed at a time by a layer with a fused one, few enough to still be in the L1 cache for the latter.
+constexpr size_t fused_block_size = 64;
+
+} // namespace
+
+SequentialNetwork::SequentialNetwork() : m_layers(), m_stages(), m_kernels(&Kernels::GetTable<float>()) {}
+
+SequentialNetwork::SequentialNetwork(const Network& network)
+    : m_layers(), m_stages(), m_kernels(&Kernels::GetTable<float>(network.GetInstructionSet())) {
+    for (size_t layer_index = 0; layer_index != network.GetLayersCount(); ++layer_index) {
+        const auto weights = network.GetWeights(layer_index);
+        auto& layer = Add<DenseLayer>(weights.Columns(), weights.Rows());
+        const auto layer_weights = layer.GetWeights();
+        for (size_t neuron_index = 0; neuron_index != weights.Rows(); ++neuron_index)
+            std::copy_n(weights.Row(neuron_index), weights.Columns(), layer_weights.Row(neuron_index));
+        std::copy_n(network.GetBiases(layer_index).data(), weights.Rows(), layer.GetBiases().Data());
+        if (layer_index + 1 == network.GetLayersCount() && network.GetLoss() == Loss::CrossEntropy)
+            Add<SoftmaxLayer>(weights.Rows());
+        else
+            Add<ActivationLayer>(weights.Rows(), network.GetActivation());
+    }
+}
+
+SequentialNetwork::SequentialNetwork(const SequentialNetwork& other)
+    : m_layers(), m_stages(other.m_stages), m_kernels(other.m_kernels) {
+    m_layers.reserve(other.m_layers.size());
+    for (const auto& layer : other.m_layers)
+        m_layers.push_back(layer->Clone());
+}
+
+SequentialNetwork::~SequentialNetwork() {}
+
+SequentialNetwork& SequentialNetwork::operator=(const SequentialNetwork& other) {
+    if (this != &other)
+        *this = SequentialNetwork(other);
+    return *this;
+}
+
+Layer& SequentialNetwork::Add(std::unique_ptr<Layer> layer) {
+    assert(layer);
+    assert(m_layers.empty() || layer->GetInputsCount() == GetOutputsCount());
+
+    if (layer->IsElementwise() && !m_stages.empty() && !m_stages.back().fused &&
+        m_layers[m_stages.back().layer_index]->HasIndependentOutputs())
+        m_stages.back().fused = true;
+    else
+        m_stages.push_back({m_layers.size(), false});
+    m_layers.push_back(std::move(layer));
+    return *m_layers.back();
+}
+
+void SequentialNetwork::Randomize(std::uint64_t seed) {
+    Random::Prng<> random(seed);
+    for (auto& layer : m_layers)
+        layer->Randomize(random);
+}
+
+SequentialNetwork::Workspace SequentialNetwork::CreateWorkspace() const {
+    assert(!m_layers.empty());
+
+    Workspace workspace;
+    size_t max_size = GetInputsCount();
+    workspace.outputs.reserve(m_stages.size());
+    for (const auto& stage : m_stages)
+        workspace.outputs.emplace_back(m_layers[stage.layer_index]->GetOutputsCount());
+    workspace.saved.reserve(m_layers.size());
+    for (const auto& layer : m_layers) {
+        workspace.saved.emplace_back(layer->GetSavedCount());
+        max_size = std::max(max_size, layer->GetOutputsCount());
+    }
+    workspace.errors.resize(max_size);
+    workspace.next_errors.resize(max_size);
+    workspace.scratch.resize(max_size);
+    return workspace;
+}
+
+void SequentialNetwork::ComputeOutput(Span<const float> inputs, Workspace& workspace, Span<float> outputs) const {
+    assert(workspace.outputs.size() == m_stages.size());
+    assert(inputs.Size() == GetInputsCount());
+    assert(outputs.Size() == GetOutputsCount());
+
+    ComputeStages(inputs.Data(), outputs.Data(), workspace, false);
+}
+
+void SequentialNetwork::ComputeOutputBatch(MatrixView<const float> inputs, MatrixView<float> outputs,
+                                           Workspace& workspace) const {
+    assert(workspace.outputs.size() == m_stages.size());
+    assert(inputs.Columns() == GetInputsCount());
+    assert(outputs.Columns() == GetOutputsCount());
+    assert(inputs.Rows() == outputs.Rows());
+
+    const size_t samples_count = inputs.Rows();
+    ReserveBatch(workspace, samples_count);
+
+    MatrixView<const float> stage_inputs = inputs;
+    for (size_t stage_index = 0; stage_index != m_stages.size(); ++stage_index) {
+        const auto& stage = m_stages[stage_index];
+        // The last stage writes straight into the destination.
+        MatrixView<float> stage_outputs = stage_index + 1 != m_stages.size()
+                                              ? workspace.batch_outputs[stage_index].View().RowRange(0, samples_count)
+                                              : outputs;
+        auto pass = CreatePass(workspace, stage.layer_index, false);
+        m_layers[stage.layer_index]->ForwardBatch(stage_inputs, stage_outputs, pass);
+        if (stage.fused) {
+            const Layer& fused_layer = *m_layers[stage.layer_index + 1];
+            auto fused_pass = CreatePass(workspace, stage.layer_index + 1, false);
+            for (size_t sample_index = 0; sample_index != samples_count; ++sample_index)
+                fused_layer.ForwardInPlace(stage_outputs.Row(sample_index), stage_outputs.Columns(), fused_pass);
+        }
+        stage_inputs = stage_outputs;
+    }
+}
+
+void SequentialNetwork::ReserveBatch(Workspace& workspace, size_t samples_count) const {
+    if (workspace.batch_outputs.size() == m_stages.size() && workspace.batch_outputs.front().Rows() >= samples_count)
+        return;
+
+    workspace.batch_outputs.clear();
+    workspace.batch_outputs.reserve(m_stages.size());
+    for (const auto& stage : m_stages)
+        workspace.batch_outputs.emplace_back(samples_count, m_layers[stage.layer_index]->GetOutputsCount());
+}
+
+void SequentialNetwork::ComputeStages(const float* inputs, float* outputs, Workspace& workspace,
+                                      bool learning) const {
+    const float* stage_inputs = inputs;
+    for (size_t stage_index = 0; stage_index != m_stages.size(); ++stage_index) {
+        const auto& stage = m_stages[stage_index];
+        const Layer& layer = *m_layers[stage.layer_index];
+        // The last stage writes straight into the destination.
+        float* stage_outputs = stage_index + 1 != m_stages.size() ? workspace.outputs[stage_index].data() : outputs;
+        auto pass = CreatePass(workspace, stage.layer_index, learning);
+        if (!stage.fused) {
+            layer.Forward(stage_inputs, stage_outputs, pass);
+        } else {
+            const Layer& fused_layer = *m_layers[stage.layer_index + 1];
+            auto fused_pass = CreatePass(workspace, stage.layer_index + 1, learning);
+            float* const fused_saved = fused_pass.saved;
+            const size_t outputs_count = layer.GetOutputsCount();
+            for (size_t first = 0; first < outputs_count; first += fused_block_size) {
+                const size_t count = std::min(fused_block_size, outputs_count - first);
+                layer.ForwardRange(stage_inputs, stage_outputs, first, count, pass);
+                if (fused_saved)
+                    fused_pass.saved = fused_saved + first;
+                fused_layer.ForwardInPlace(stage_outputs + first, count, fused_pass);
+            }
+        }
+        stage_inputs = stage_outputs;
+    }
+}
+
+void SequentialNetwork::Learn(Span<const float> inputs, Span<const float> target_outputs, float rate,
+                              Workspace& workspace) {
+    assert(target_outputs.Size() == GetOutputsCount());
+
+    const auto outputs = ComputeOutputForLearning(inputs, workspace);
+    for (size_t output_index = 0; output_index != target_outputs.Size(); ++output_index)
+        workspace.errors[output_index] = target_outputs[output_index] - outputs[output_index];
+    BackpropagateErrors(inputs.Data(), rate, workspace);
+}
+
+Span<const float> SequentialNetwork::ComputeOutputForLearning(Span<const float> inputs, Workspace& workspace) const {
+    assert(workspace.outputs.size() == m_stages.size());
+    assert(inputs.Size() == GetInputsCount());
+
+    ComputeStages(inputs.Data(), workspace.outputs.back().data(), workspace, true);
+    return {workspace.outputs.back().data(), GetOutputsCount()};
+}
+
+void SequentialNetwork::Backpropagate(Span<const float> inputs, Span<const float> errors, float rate,
+                                      Workspace& workspace) {
+    assert(inputs.Size() == GetInputsCount());
+    assert(errors.Size() == GetOutputsCount());
+
+    std::copy_n(errors.Data(), errors.Size(), workspace.errors.data());
+    BackpropagateErrors(inputs.Data(), rate, workspace);
+}
+
+void SequentialNetwork::BackpropagateErrors(const float* inputs, float rate, Workspace& workspace) {
+    assert(rate > 0 && rate <= 1);
+    assert(workspace.outputs.size() == m_stages.size());
+
+    const auto& outputs = workspace.outputs;
+    float* errors = workspace.errors.data();
+    float* next_errors = workspace.next_errors.data();
+    for (size_t stage_index = m_stages.size(); stage_index-- != 0;) {
+        const auto& stage = m_stages[stage_index];
+        Layer& layer = *m_layers[stage.layer_index];
+        const float* stage_inputs = stage_index != 0 ? outputs[stage_index - 1].data() : inputs;
+        const float* stage_outputs = outputs[stage_index].data();
+        // There is no need for the errors of the network's inputs.
+        float* input_errors = stage_index != 0 ? next_errors : nullptr;
+
+        // The fused layer turns the errors of the stage's outputs into those of the layer's outputs in place.
+        if (stage.fused) {
+            auto fused_pass = CreatePass(workspace, stage.layer_index + 1, true);
+            m_layers[stage.layer_index + 1]->Backward(nullptr, stage_outputs, errors, errors, rate, fused_pass);
+        }
+        auto pass = CreatePass(workspace, stage.layer_index, true);
+        layer.Backward(stage_inputs, stage.fused ? nullptr : stage_outputs, errors, input_errors, rate, pass);
+        std::swap(errors, next_errors);
+    }
+}
+
+LayerPass SequentialNetwork::CreatePass(Workspace& workspace, size_t layer_index, bool learning) const {
+    auto& saved = workspace.saved[layer_index];
+    return {m_kernels, learning, &workspace.random, saved.empty() ? nullptr : saved.data(), workspace.scratch.data()};
+}
+
+size_t SequentialNetwork::GetParametersCount() const {
+    size_t count = 0;
+    for (const auto& layer : m_layers)
+        count += layer->GetParametersCount();
+    return count;
+}
+
+void SequentialNetwork::SetInstructionSet(Kernels::InstructionSet instruction_set) {
+    m_kernels = &Kernels::GetTable<float>(instruction_set);
+}
+
+} // namespace Neural
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "kernels.h"
+#include "layers.h"
+#include "matrix.h"
+#include "network.h"
+#include "span.h"
+
+#include <util/random.h>
+
+namespace Neural {
+
+// Feed-forward network made of any sequence of layers. An element-wise layer right after a layer with independent
+// outputs is fused into it: it works in place on every block of outputs as soon as it is computed, instead of making
+// a pass of its own over a buffer of its own. A dense layer followed by its activation function thus makes a single
+// pass over its outputs, like a layer of Network.
+class SequentialNetwork {
+public:
+    // Scratch memory of the forward and backward passes, see BasicWorkspace.
+    struct Workspace {
+        // Outputs of every stage, errors of the current and the previous one and per layer the values kept from the
+        // forward pass of a training sample.
+        std::vector<AlignedVector<float>> outputs;
+        AlignedVector<float> errors;
+        AlignedVector<float> next_errors;
+        AlignedVector<float> scratch;
+        std::vector<AlignedVector<float>> saved;
+        // Outputs of every stage for a batch of samples, grown as needed.
+        std::vector<Matrix<float>> batch_outputs;
+        // Source of the dropout decisions.
+        Random::Prng<> random{0};
+    };
+
+    SequentialNetwork();
+    // The layers of a network, each as a dense layer followed by its activation function, or by a softmax for the last
+    // one with the cross-entropy loss, with its parameters.
+    explicit SequentialNetwork(const Network&);
+    SequentialNetwork(const SequentialNetwork&);
+    SequentialNetwork(SequentialNetwork&&) = default;
+    ~SequentialNetwork();
+
+    SequentialNetwork& operator=(const SequentialNetwork&);
+    SequentialNetwork& operator=(SequentialNetwork&&) = default;
+
+    // Append a layer taking the outputs of the last one as its inputs.
+    Layer& Add(std::unique_ptr<Layer>);
+    template <typename L, typename... Args>
+    inline L& Add(Args&&... arguments) {
+        return static_cast<L&>(Add(std::make_unique<L>(std::forward<Args>(arguments)...)));
+    }
+
+    void Randomize(std::uint64_t);
+
+    // The workspace has to be created again after layers are added.
+    Workspace CreateWorkspace() const;
+
+    void ComputeOutput(Span<const float>, Workspace&, Span<float>) const;
+    // One sample per row of the (samples x inputs) and (samples x outputs) matrices. Every stage computes the whole
+    // batch before the next one, so that dense layers load each weight once per block of samples like
+    // Network::ComputeOutputBatch, and a fused layer follows on every row.
+    void ComputeOutputBatch(MatrixView<const float>, MatrixView<float>, Workspace&) const;
+
+    // Per-sample gradient descent step on the squared error, like Network::Learn with the Sgd optimizer.
+    void Learn(Span<const float>, Span<const float>, float, Workspace&);
+
+    // The forward pass of Learn, with the outputs left in the workspace, for a loss computed outside of the network.
+    Span<const float> ComputeOutputForLearning(Span<const float>, Workspace&) const;
+    // The backward pass of Learn from the errors of the outputs, the negative loss gradients, after
+    // ComputeOutputForLearning on the same inputs.
+    void Backpropagate(Span<const float>, Span<const float>, float, Workspace&);
+
+    inline size_t GetLayersCount() const { return m_layers.size(); }
+    inline const Layer& GetLayer(size_t layer_index) const { return *m_layers[layer_index]; }
+    inline Layer& GetLayer(size_t layer_index) { return *m_layers[layer_index]; }
+    // Number of passes over the outputs of the layers, fewer than the layers when some are fused.
+    inline size_t GetStagesCount() const { return m_stages.size(); }
+
+    inline size_t GetInputsCount() const { return m_layers.front()->GetInputsCount(); }
+    inline size_t GetOutputsCount() const { return m_layers.back()->GetOutputsCount(); }
+    // Number of trained parameters of all the layers.
+    size_t GetParametersCount() const;
+
+    void SetInstructionSet(Kernels::InstructionSet);
+    inline Kernels::InstructionSet GetInstructionSet() const { return m_kernels->instruction_set; }
+
+private:
+    // A layer, and whether the next one is fused into it.
+    struct Stage {
+        size_t layer_index;
+        bool fused;
+    };
+
+    std::vector<std::unique_ptr<Layer>> m_layers;
+    std::vector<Stage> m_stages;
+    const Kernels::Table<float>* m_kernels;
+
+    // Compute all the stages, the last one into the given outputs and the others into the workspace.
+    void ComputeStages(const float*, float*, Workspace&, bool) const;
+    LayerPass CreatePass(Workspace&, size_t, bool) const;
+    // Make room for the outputs of a batch of samples in the workspace.
+    void ReserveBatch(Workspace&, size_t) const;
+    // Propagate the errors of the outputs in the workspace back through all the stages, correcting the parameters.
+    void BackpropagateErrors(const float*, float, Workspace&);
+};
+
+} // namespace Neural
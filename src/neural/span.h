@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace Neural {
+
+// Non-owning view of contiguous elements, a minimal stand-in for std::span.
+template <typename T>
+class Span {
+public:
+    Span() : m_data(nullptr), m_size(0) {}
+    Span(T* data, size_t size) : m_data(data), m_size(size) {}
+
+    // View the elements of a contiguous container such as std::vector or AlignedVector.
+    template <typename C, typename = std::enable_if_t<std::is_convertible_v<decltype(std::declval<C&>().data()), T*>>>
+    Span(C& container) : m_data(container.data()), m_size(container.size()) {}
+
+    // Allow implicit conversion from a mutable span to a read-only one.
+    template <typename U, typename = std::enable_if_t<std::is_same_v<const U, T>>>
+    Span(const Span<U>& other) : m_data(other.Data()), m_size(other.Size()) {}
+
+    inline T& operator[](size_t index) const {
+        assert(index < m_size);
+        return m_data[index];
+    }
+
+    inline T* Data() const { return m_data; }
+    inline size_t Size() const { return m_size; }
+
+    inline T* begin() const { return m_data; }
+    inline T* end() const { return m_data + m_size; }
+
+private:
+    T* m_data;
+    size_t m_size;
+};
+
+} // namespace Neural
@@ -0,0 +1,78 @@
+#include "thread_pool.h"
+
+#include <cassert>
+
+namespace Neural {
+
+ThreadPool::ThreadPool(size_t threads_count)
+    : m_workers(), m_task(nullptr), m_tasks_count(0), m_next_task(0), m_busy_workers(0), m_generation(0),
+      m_stopping(false) {
+    assert(threads_count > 0);
+#ifdef __EMSCRIPTEN__
+    // The web build is not compiled with thread support, everything runs on the calling thread.
+    threads_count = 1;
+#endif
+    m_workers.reserve(threads_count - 1);
+    for (size_t worker_index = 1; worker_index < threads_count; ++worker_index)
+        m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_work_available.notify_all();
+    for (auto& worker : m_workers)
+        worker.join();
+}
+
+void ThreadPool::Run(size_t count, const std::function<void(size_t)>& task) {
+    if (m_workers.empty() || count <= 1) {
+        for (size_t index = 0; index != count; ++index)
+            task(index);
+        return;
+    }
+
+    {
+        std::lock_guard lock(m_mutex);
+        m_task = &task;
+        m_tasks_count = count;
+        m_next_task = 0;
+        m_busy_workers = m_workers.size();
+        ++m_generation;
+    }
+    m_work_available.notify_all();
+
+    RunTasks();
+
+    std::unique_lock lock(m_mutex);
+    m_work_done.wait(lock, [this] { return m_busy_workers == 0; });
+    m_task = nullptr;
+}
+
+void ThreadPool::WorkerLoop() {
+    std::uint64_t last_generation = 0;
+    for (;;) {
+        {
+            std::unique_lock lock(m_mutex);
+            m_work_available.wait(lock, [&] { return m_stopping || m_generation != last_generation; });
+            if (m_stopping)
+                return;
+            last_generation = m_generation;
+        }
+
+        RunTasks();
+
+        std::lock_guard lock(m_mutex);
+        if (--m_busy_workers == 0)
+            m_work_done.notify_one();
+    }
+}
+
+void ThreadPool::RunTasks() {
+    for (size_t index; (index = m_next_task.fetch_add(1)) < m_tasks_count;)
+        (*m_task)(index);
+}
+
+} // namespace Neural
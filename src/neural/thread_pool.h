@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Neural {
+
+// Fixed set of worker threads running one parallel loop at a time.
+class ThreadPool {
+public:
+    // The calling thread counts as one of the threads and takes part in every loop.
+    explicit ThreadPool(size_t);
+    ~ThreadPool();
+
+    inline size_t GetThreadsCount() const { return m_workers.size() + 1; }
+
+    // Call task(index) for every index in [0, count) and wait until all the calls return.
+    // The order and the thread each index runs on are unspecified.
+    void Run(size_t, const std::function<void(size_t)>&);
+
+private:
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_work_available;
+    std::condition_variable m_work_done;
+    const std::function<void(size_t)>* m_task;
+    size_t m_tasks_count;
+    std::atomic<size_t> m_next_task;
+    size_t m_busy_workers;
+    std::uint64_t m_generation;
+    bool m_stopping;
+
+    void WorkerLoop();
+    void RunTasks();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+};
+
+} // namespace Neural
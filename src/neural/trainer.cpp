@@ -0,0 +1,88 @@
+#include "trainer.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace Neural {
+
+template <typename T, typename W>
+ParallelTrainer<T, W>::ParallelTrainer(Network& network, size_t threads_count)
+    : m_network(network), m_thread_pool(threads_count), m_gradients(), m_workspaces() {
+    m_gradients.reserve(m_thread_pool.GetThreadsCount());
+    m_workspaces.reserve(m_thread_pool.GetThreadsCount());
+    for (size_t shard_index = 0; shard_index != m_thread_pool.GetThreadsCount(); ++shard_index) {
+        m_gradients.push_back(m_network.CreateGradients());
+        m_workspaces.push_back(m_network.CreateWorkspace());
+    }
+}
+
+template <typename T, typename W>
+ParallelTrainer<T, W>::~ParallelTrainer() {}
+
+template <typename T, typename W>
+void ParallelTrainer<T, W>::LearnBatch(MatrixView<const T> inputs, MatrixView<const T> target_outputs, T rate) {
+    assert(inputs.Rows() == target_outputs.Rows());
+
+    const size_t shards_count = m_gradients.size();
+    const size_t samples_count = inputs.Rows();
+    const size_t shard_size = (samples_count + shards_count - 1) / shards_count;
+
+    m_thread_pool.Run(shards_count, [&](size_t shard_index) {
+        auto& gradients = m_gradients[shard_index];
+        gradients.Clear();
+        const size_t first_sample = std::min(shard_index * shard_size, samples_count);
+        const size_t shard_samples_count = std::min(shard_size, samples_count - first_sample);
+        if (shard_samples_count != 0)
+            m_network.AccumulateGradients(inputs.RowRange(first_sample, shard_samples_count),
+                                          target_outputs.RowRange(first_sample, shard_samples_count), gradients,
+                                          m_workspaces[shard_index]);
+    });
+
+    // Sum the shards pairwise: 0 += 1, 2 += 3, ... then 0 += 2, 4 += 6, ... and so on.
+    for (size_t distance = 1; distance < shards_count; distance *= 2) {
+        const size_t pairs_count = (shards_count + 2 * distance - 1) / (2 * distance);
+        m_thread_pool.Run(pairs_count, [&](size_t pair_index) {
+            const size_t target_index = pair_index * 2 * distance;
+            const size_t source_index = target_index + distance;
+            if (source_index < shards_count)
+                m_gradients[target_index].Add(m_gradients[source_index]);
+        });
+    }
+
+    m_network.ApplyGradients(m_gradients.front(), rate);
+}
+
+template <typename T, typename W>
+AsyncTrainer<T, W>::AsyncTrainer(Network& network, size_t threads_count)
+    : m_network(network), m_thread_pool(threads_count), m_workspaces() {
+    m_workspaces.reserve(m_thread_pool.GetThreadsCount());
+    for (size_t shard_index = 0; shard_index != m_thread_pool.GetThreadsCount(); ++shard_index)
+        m_workspaces.push_back(m_network.CreateWorkspace());
+}
+
+template <typename T, typename W>
+AsyncTrainer<T, W>::~AsyncTrainer() {}
+
+template <typename T, typename W>
+void AsyncTrainer<T, W>::Learn(MatrixView<const T> inputs, MatrixView<const T> target_outputs, T rate) {
+    assert(inputs.Rows() == target_outputs.Rows());
+
+    const size_t shards_count = m_thread_pool.GetThreadsCount();
+    const size_t samples_count = inputs.Rows();
+    const size_t shard_size = (samples_count + shards_count - 1) / shards_count;
+
+    m_thread_pool.Run(shards_count, [&](size_t shard_index) {
+        const size_t first_sample = std::min(shard_index * shard_size, samples_count);
+        const size_t shard_samples_count = std::min(shard_size, samples_count - first_sample);
+        m_network.LearnAsync(inputs.RowRange(first_sample, shard_samples_count),
+                             target_outputs.RowRange(first_sample, shard_samples_count), rate,
+                             m_workspaces[shard_index]);
+    });
+}
+
+template class ParallelTrainer<float>;
+template class ParallelTrainer<double>;
+template class AsyncTrainer<float>;
+template class AsyncTrainer<double>;
+
+} // namespace Neural
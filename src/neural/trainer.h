@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "matrix.h"
+#include "network.h"
+#include "thread_pool.h"
+
+namespace Neural {
+
+// Data-parallel mini-batch trainer.
+// Every batch is split into one shard per thread, each shard accumulates its corrections into its own buffer
+// using its own workspace,
+// and the buffers are then summed pairwise in a fixed tree order. The shards only depend on the threads count,
+// so for a given threads count the results do not depend on scheduling.
+template <typename T, typename W = T>
+class ParallelTrainer {
+public:
+    using Network = BasicNetwork<T, W>;
+
+    ParallelTrainer(Network&, size_t);
+    ~ParallelTrainer();
+
+    void LearnBatch(MatrixView<const T>, MatrixView<const T>, T);
+
+    inline size_t GetThreadsCount() const { return m_thread_pool.GetThreadsCount(); }
+
+private:
+    Network& m_network;
+    ThreadPool m_thread_pool;
+    std::vector<typename Network::Gradients> m_gradients;
+    std::vector<typename Network::Workspace> m_workspaces;
+};
+
+// Asynchronous Hogwild-style trainer.
+// Each thread runs per-sample updates over its own share of the samples against the shared weights without locks.
+// This scales best when the samples are sparse, as their updates then rarely touch the same weights,
+// but the results depend on the scheduling and are not reproducible.
+template <typename T, typename W = T>
+class AsyncTrainer {
+public:
+    using Network = BasicNetwork<T, W>;
+
+    AsyncTrainer(Network&, size_t);
+    ~AsyncTrainer();
+
+    void Learn(MatrixView<const T>, MatrixView<const T>, T);
+
+    inline size_t GetThreadsCount() const { return m_thread_pool.GetThreadsCount(); }
+
+private:
+    Network& m_network;
+    ThreadPool m_thread_pool;
+    std::vector<typename Network::Workspace> m_workspaces;
+};
+
+extern template class ParallelTrainer<float>;
+extern template class ParallelTrainer<double>;
+extern template class AsyncTrainer<float>;
+extern template class AsyncTrainer<double>;
+
+} // namespace Neural
@@ -0,0 +1,96 @@
+// The documented maximum errors of the activation and exp approximations, over their whole domains.
+
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+#include <neural/activation.h>
+#include <neural/kernels.h>
+
+#include "test.h"
+
+namespace {
+
+using namespace Neural;
+
+// Dense enough to land within a few ulps of every extremum of the errors.
+constexpr size_t points_count = 1 << 22;
+
+template <typename T>
+std::vector<T> CreateGrid(T from, T to) {
+    std::vector<T> values(points_count);
+    for (size_t index = 0; index != points_count; ++index)
+        values[index] = static_cast<T>(from + (to - from) * static_cast<long double>(index) / (points_count - 1));
+    return values;
+}
+
+// Absolute errors of FastTanh and PreciseTanh over [-10, 10], past where both are clamped.
+template <typename T>
+void TestTanh(const char* type_name) {
+    double fast_error = 0;
+    double precise_error = 0;
+    for (T x : CreateGrid<T>(-10, 10)) {
+        const double reference = std::tanh(static_cast<long double>(x));
+        fast_error = std::fmax(fast_error, std::fabs(Kernels::FastTanh<Kernels::ScalarOps<T>>(x) - reference));
+        precise_error = std::fmax(precise_error, std::fabs(Kernels::PreciseTanh<Kernels::ScalarOps<T>>(x) - reference));
+    }
+    Test::Check(fast_error < 0.025, "%s FastTanh error %g, documented below 0.025", type_name, fast_error);
+    const double precise_bound = sizeof(T) == sizeof(float) ? 4e-7 : 3e-7;
+    Test::Check(precise_error < precise_bound, "%s PreciseTanh error %g, documented below %g", type_name,
+                precise_error, precise_bound);
+    std::printf("%s tanh errors: fast %g, precise %g\n", type_name, fast_error, precise_error);
+}
+
+// Relative error of Exp in units in the last place over the range where it is not clamped.
+template <typename T>
+void TestExp(const char* type_name, T lowest, T highest) {
+    double max_ulps = 0;
+    for (T x : CreateGrid<T>(lowest, highest)) {
+        const long double reference = std::exp(static_cast<long double>(x));
+        const T rounded = static_cast<T>(reference);
+        const long double ulp = std::nextafter(rounded, std::numeric_limits<T>::infinity()) - rounded;
+        const long double error = std::fabs(Kernels::Exp<Kernels::ScalarOps<T>>(x) - reference) / ulp;
+        max_ulps = std::fmax(max_ulps, static_cast<double>(error));
+    }
+    Test::Check(max_ulps < 2, "%s Exp error %g ulps, documented below 2", type_name, max_ulps);
+    std::printf("%s exp error: %g ulps\n", type_name, max_ulps);
+}
+
+// The activation of every table, whose error is half that of the tanh it uses, against GetMaxError.
+template <typename T>
+void TestActivate(Kernels::InstructionSet instruction_set, const char* type_name) {
+    const auto& table = Kernels::GetTable<T>(instruction_set);
+    const std::vector<T> values = CreateGrid<T>(-10, 10);
+    for (auto activation : {Kernels::Activation::Fast, Kernels::Activation::Precise}) {
+        std::vector<T> outputs = values;
+        table.activate(activation, outputs.data(), outputs.size());
+        double max_error = 0;
+        for (size_t index = 0; index != points_count; ++index) {
+            const double reference = 0.5 * (std::tanh(static_cast<long double>(values[index])) + 1);
+            max_error = std::fmax(max_error, std::fabs(outputs[index] - reference));
+        }
+        Test::Check(max_error <= Kernels::GetMaxError(activation), "%s %s %s activation error %g, documented %g",
+                    Kernels::GetName(instruction_set), type_name, Kernels::GetName(activation), max_error,
+                    Kernels::GetMaxError(activation));
+    }
+}
+
+} // namespace
+
+int main() {
+    TestTanh<float>("float");
+    TestTanh<double>("double");
+    TestExp<float>("float", -87.3f, 88.0f);
+    TestExp<double>("double", -708.0, 709.0);
+
+    for (auto instruction_set : {Kernels::InstructionSet::Scalar, Kernels::InstructionSet::Sse2,
+                                 Kernels::InstructionSet::Avx2, Kernels::InstructionSet::Avx512}) {
+        if (!Kernels::IsSupported(instruction_set))
+            continue;
+        TestActivate<float>(instruction_set, "float");
+        TestActivate<double>(instruction_set, "double");
+    }
+    return Test::GetExitCode();
+}
@@ -0,0 +1,326 @@
+// Every vectorized kernel table against the scalar reference one, on sizes that leave vector loop tails.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include <neural/bfloat16.h>
+#include <neural/kernels.h>
+#include <neural/matrix.h>
+#include <util/random.h>
+
+#include "test.h"
+
+namespace {
+
+using namespace Neural;
+
+constexpr size_t rows = 13;
+constexpr size_t columns = 37;
+constexpr size_t samples = 5;
+constexpr size_t softmax_count = 101;
+// Long enough for the quantized kernels to go through full vectors of every width and a tail.
+constexpr size_t quantized_columns = 1000;
+
+// Summation orders differ between the tables, and bfloat16 weights may round to a neighbor after an update.
+template <typename T, typename W>
+double GetTolerance() {
+    if (sizeof(W) < sizeof(float))
+        return 1e-2;
+    return sizeof(T) == sizeof(float) ? 1e-5 : 1e-12;
+}
+
+template <typename T>
+double ToDouble(T value) {
+    return static_cast<double>(value);
+}
+
+double ToDouble(BFloat16 value) {
+    return static_cast<float>(value);
+}
+
+template <typename T>
+void CheckClose(const char* table_name, const char* kernel, const T* values, const T* references, size_t count,
+                double tolerance) {
+    for (size_t index = 0; index != count; ++index) {
+        const double value = ToDouble(values[index]);
+        const double reference = ToDouble(references[index]);
+        if (!Test::Check(Test::IsClose(value, reference, tolerance), "%s %s [%zu]: %g, scalar %g", table_name, kernel,
+                         index, value, reference))
+            return;
+    }
+}
+
+template <typename T>
+std::vector<T> CreateValues(Random::Prng<>& random, size_t count, float range) {
+    std::vector<T> values(count);
+    for (auto& value : values)
+        value = static_cast<T>(random.NextFloat<float>(-range, range));
+    return values;
+}
+
+template <typename T>
+Matrix<T> CreateMatrix(Random::Prng<>& random, size_t matrix_rows, size_t matrix_columns) {
+    Matrix<T> matrix(matrix_rows, matrix_columns);
+    for (size_t row = 0; row != matrix_rows; ++row)
+        for (size_t column = 0; column != matrix_columns; ++column)
+            matrix(row, column) = static_cast<T>(random.NextFloat<float>(-1, 1));
+    return matrix;
+}
+
+template <typename T, typename W>
+void TestTable(Kernels::InstructionSet instruction_set, const char* type_name) {
+    const auto& table = Kernels::GetTable<T, W>(instruction_set);
+    const auto& scalar = Kernels::GetTable<T, W>(Kernels::InstructionSet::Scalar);
+    char table_name[64];
+    std::snprintf(table_name, sizeof(table_name), "%s %s", Kernels::GetName(instruction_set), type_name);
+    const double tolerance = GetTolerance<T, W>();
+
+    Random::Prng<> random(1);
+    const Matrix<W> weights = CreateMatrix<W>(random, rows, columns);
+    const std::vector<T> inputs = CreateValues<T>(random, columns, 1);
+    const std::vector<T> biases = CreateValues<T>(random, rows, 1);
+
+    {
+        std::vector<T> outputs(rows), references(rows);
+        table.dense(weights.Data(), weights.Stride(), rows, columns, inputs.data(), biases.data(), outputs.data());
+        scalar.dense(weights.Data(), weights.Stride(), rows, columns, inputs.data(), biases.data(), references.data());
+        CheckClose(table_name, "dense", outputs.data(), references.data(), rows, tolerance);
+    }
+
+    {
+        const Matrix<T> batch_inputs = CreateMatrix<T>(random, samples, columns);
+        Matrix<T> outputs(samples, rows), references(samples, rows);
+        table.dense_batch(weights.Data(), weights.Stride(), rows, columns, batch_inputs.Data(), batch_inputs.Stride(),
+                          samples, biases.data(), outputs.Data(), outputs.Stride());
+        scalar.dense_batch(weights.Data(), weights.Stride(), rows, columns, batch_inputs.Data(), batch_inputs.Stride(),
+                           samples, biases.data(), references.Data(), references.Stride());
+        for (size_t sample = 0; sample != samples; ++sample)
+            CheckClose(table_name, "dense_batch", outputs.Row(sample), references.Row(sample), rows, tolerance);
+    }
+
+    {
+        const std::vector<T> errors = CreateValues<T>(random, rows, 1);
+        const std::vector<T> scales = CreateValues<T>(random, rows, 0.1f);
+        Matrix<W> updated = weights, reference_weights = weights;
+        std::vector<T> input_errors = CreateValues<T>(random, columns, 1);
+        std::vector<T> reference_errors = input_errors;
+        table.backward(updated.Data(), updated.Stride(), rows, columns, errors.data(), scales.data(), inputs.data(),
+                       input_errors.data());
+        scalar.backward(reference_weights.Data(), reference_weights.Stride(), rows, columns, errors.data(),
+                        scales.data(), inputs.data(), reference_errors.data());
+        CheckClose(table_name, "backward errors", input_errors.data(), reference_errors.data(), columns, tolerance);
+        for (size_t row = 0; row != rows; ++row)
+            CheckClose(table_name, "backward weights", updated.Row(row), reference_weights.Row(row), columns,
+                       tolerance);
+    }
+
+    {
+        const Matrix<T> gradients = CreateMatrix<T>(random, rows, columns);
+        Matrix<W> updated = weights, reference_weights = weights;
+        table.update(updated.Data(), updated.Stride(), rows, columns, gradients.Data(), gradients.Stride(), T(0.1));
+        scalar.update(reference_weights.Data(), reference_weights.Stride(), rows, columns, gradients.Data(),
+                      gradients.Stride(), T(0.1));
+        for (size_t row = 0; row != rows; ++row)
+            CheckClose(table_name, "update", updated.Row(row), reference_weights.Row(row), columns, tolerance);
+    }
+
+    {
+        // The columns of every other input, the first and last included.
+        std::vector<size_t> indices;
+        for (size_t column = 0; column < columns; column += 2)
+            indices.push_back(column);
+        indices.push_back(columns - 1);
+        const std::vector<T> values = CreateValues<T>(random, indices.size(), 1);
+        const Matrix<W> weight_columns = CreateMatrix<W>(random, columns, rows);
+
+        std::vector<T> outputs(rows), references(rows);
+        table.sparse_dense(weight_columns.Data(), weight_columns.Stride(), rows, indices.data(), values.data(),
+                           indices.size(), biases.data(), outputs.data());
+        scalar.sparse_dense(weight_columns.Data(), weight_columns.Stride(), rows, indices.data(), values.data(),
+                            indices.size(), biases.data(), references.data());
+        CheckClose(table_name, "sparse_dense", outputs.data(), references.data(), rows, tolerance);
+
+        const std::vector<T> scales = CreateValues<T>(random, rows, 0.1f);
+        Matrix<W> updated = weight_columns, reference_columns = weight_columns;
+        table.sparse_update(updated.Data(), updated.Stride(), rows, indices.data(), values.data(), indices.size(),
+                            scales.data());
+        scalar.sparse_update(reference_columns.Data(), reference_columns.Stride(), rows, indices.data(),
+                             values.data(), indices.size(), scales.data());
+        for (size_t column = 0; column != columns; ++column)
+            CheckClose(table_name, "sparse_update", updated.Row(column), reference_columns.Row(column), rows,
+                       tolerance);
+    }
+
+    {
+        // Rows from empty to full, so that every row length goes through a different mix of vectors and tails.
+        std::vector<W> values;
+        std::vector<std::uint32_t> indices, offsets = {0};
+        for (size_t row = 0; row != rows; ++row) {
+            const size_t stride = row % 4 + 1;
+            for (size_t column = row == 0 ? columns : 0; column < columns; column += stride) {
+                values.push_back(weights(row, column));
+                indices.push_back(static_cast<std::uint32_t>(column));
+            }
+            offsets.push_back(static_cast<std::uint32_t>(values.size()));
+        }
+        std::vector<T> outputs(rows), references(rows);
+        table.csr_dense(values.data(), indices.data(), offsets.data(), rows, inputs.data(), biases.data(),
+                        outputs.data());
+        scalar.csr_dense(values.data(), indices.data(), offsets.data(), rows, inputs.data(), biases.data(),
+                         references.data());
+        CheckClose(table_name, "csr_dense", outputs.data(), references.data(), rows, tolerance);
+    }
+
+    {
+        const Matrix<T> errors = CreateMatrix<T>(random, samples, rows);
+        Matrix<T> input_errors = CreateMatrix<T>(random, samples, columns), reference_errors = input_errors;
+        table.backward_batch(weights.Data(), weights.Stride(), rows, columns, errors.Data(), errors.Stride(), samples,
+                             input_errors.Data(), input_errors.Stride());
+        scalar.backward_batch(weights.Data(), weights.Stride(), rows, columns, errors.Data(), errors.Stride(),
+                              samples, reference_errors.Data(), reference_errors.Stride());
+        for (size_t sample = 0; sample != samples; ++sample)
+            CheckClose(table_name, "backward_batch", input_errors.Row(sample), reference_errors.Row(sample), columns,
+                       tolerance);
+    }
+
+    {
+        const Matrix<T> deltas = CreateMatrix<T>(random, samples, rows);
+        const Matrix<T> batch_inputs = CreateMatrix<T>(random, samples, columns);
+        Matrix<T> gradients = CreateMatrix<T>(random, rows, columns), reference_gradients = gradients;
+        table.accumulate(gradients.Data(), gradients.Stride(), rows, columns, deltas.Data(), deltas.Stride(),
+                         batch_inputs.Data(), batch_inputs.Stride(), samples);
+        scalar.accumulate(reference_gradients.Data(), reference_gradients.Stride(), rows, columns, deltas.Data(),
+                          deltas.Stride(), batch_inputs.Data(), batch_inputs.Stride(), samples);
+        for (size_t row = 0; row != rows; ++row)
+            CheckClose(table_name, "accumulate", gradients.Row(row), reference_gradients.Row(row), columns,
+                       tolerance);
+    }
+
+    for (bool nesterov : {false, true}) {
+        const Matrix<T> gradients = CreateMatrix<T>(random, rows, columns);
+        Matrix<T> velocities = CreateMatrix<T>(random, rows, columns), reference_velocities = velocities;
+        Matrix<W> updated = weights, reference_weights = weights;
+        table.momentum_update(updated.Data(), updated.Stride(), rows, columns, gradients.Data(), gradients.Stride(),
+                              velocities.Data(), T(0.5), T(0.1), T(0.9), nesterov);
+        scalar.momentum_update(reference_weights.Data(), reference_weights.Stride(), rows, columns, gradients.Data(),
+                               gradients.Stride(), reference_velocities.Data(), T(0.5), T(0.1), T(0.9), nesterov);
+        const char* kernel = nesterov ? "momentum_update Nesterov" : "momentum_update";
+        for (size_t row = 0; row != rows; ++row) {
+            CheckClose(table_name, kernel, updated.Row(row), reference_weights.Row(row), columns, tolerance);
+            CheckClose(table_name, kernel, velocities.Row(row), reference_velocities.Row(row), columns, tolerance);
+        }
+    }
+
+    {
+        const Matrix<T> gradients = CreateMatrix<T>(random, rows, columns);
+        Matrix<T> moments = CreateMatrix<T>(random, rows, columns), reference_moments = moments;
+        // The squares are averages of squared gradients, never negative.
+        Matrix<T> squares = CreateMatrix<T>(random, rows, columns);
+        for (size_t row = 0; row != rows; ++row)
+            for (size_t column = 0; column != columns; ++column)
+                squares(row, column) *= squares(row, column);
+        Matrix<T> reference_squares = squares;
+        Matrix<W> updated = weights, reference_weights = weights;
+        table.adam_update(updated.Data(), updated.Stride(), rows, columns, gradients.Data(), gradients.Stride(),
+                          moments.Data(), squares.Data(), T(0.5), T(0.01), T(0.9), T(0.999), T(1e-8));
+        scalar.adam_update(reference_weights.Data(), reference_weights.Stride(), rows, columns, gradients.Data(),
+                           gradients.Stride(), reference_moments.Data(), reference_squares.Data(), T(0.5), T(0.01),
+                           T(0.9), T(0.999), T(1e-8));
+        for (size_t row = 0; row != rows; ++row) {
+            CheckClose(table_name, "adam_update", updated.Row(row), reference_weights.Row(row), columns, tolerance);
+            CheckClose(table_name, "adam_update", moments.Row(row), reference_moments.Row(row), columns, tolerance);
+            CheckClose(table_name, "adam_update", squares.Row(row), reference_squares.Row(row), columns, tolerance);
+        }
+    }
+
+    {
+        std::vector<T> outputs = CreateValues<T>(random, columns, 1);
+        std::vector<T> references = outputs;
+        table.maximum(outputs.data(), inputs.data(), columns);
+        scalar.maximum(references.data(), inputs.data(), columns);
+        CheckClose(table_name, "maximum", outputs.data(), references.data(), columns, 0);
+    }
+
+    for (auto activation : {Kernels::Activation::Fast, Kernels::Activation::Precise}) {
+        std::vector<T> values = CreateValues<T>(random, columns, 8);
+        std::vector<T> references = values;
+        table.activate(activation, values.data(), columns);
+        scalar.activate(activation, references.data(), columns);
+        char kernel[32];
+        std::snprintf(kernel, sizeof(kernel), "activate %s", Kernels::GetName(activation));
+        CheckClose(table_name, kernel, values.data(), references.data(), columns, tolerance);
+    }
+
+    {
+        std::vector<T> values = CreateValues<T>(random, softmax_count, 20);
+        std::vector<T> references = values;
+        table.softmax(values.data(), softmax_count);
+        scalar.softmax(references.data(), softmax_count);
+        CheckClose(table_name, "softmax", values.data(), references.data(), softmax_count, tolerance);
+    }
+
+    std::printf("%s compared with the scalar table\n", table_name);
+}
+
+// The integer dot products are exact, so they have to match the scalar ones exactly, the largest products included.
+void TestQuantizedTable(Kernels::InstructionSet instruction_set) {
+    const auto& table = Kernels::GetQuantizedTable(instruction_set);
+    const auto& scalar = Kernels::GetScalarQuantizedTable();
+    const char* table_name = Kernels::GetName(instruction_set);
+
+    Random::Prng<> random(2);
+    Matrix<std::int8_t> weights(rows, quantized_columns);
+    std::vector<std::uint8_t> inputs(quantized_columns);
+    for (size_t column = 0; column != quantized_columns; ++column) {
+        inputs[column] = static_cast<std::uint8_t>(random.NextFloat<float>(0, 255.99f));
+        for (size_t row = 0; row != rows; ++row)
+            weights(row, column) = static_cast<std::int8_t>(random.NextFloat<float>(-127.99f, 127.99f));
+    }
+    // Saturated inputs with the largest weights of either sign, and alternating ones.
+    std::vector<std::uint8_t> saturated_inputs(quantized_columns, 255);
+    Matrix<std::int8_t> saturated_weights(3, quantized_columns);
+    for (size_t column = 0; column != quantized_columns; ++column) {
+        saturated_weights(0, column) = 127;
+        saturated_weights(1, column) = -127;
+        saturated_weights(2, column) = column % 2 == 0 ? 127 : -127;
+    }
+
+    for (size_t columns_count : {size_t(1), columns, quantized_columns}) {
+        std::vector<std::int32_t> outputs(rows), references(rows);
+        table.dense(weights.Data(), weights.Stride(), rows, columns_count, inputs.data(), outputs.data());
+        scalar.dense(weights.Data(), weights.Stride(), rows, columns_count, inputs.data(), references.data());
+        for (size_t row = 0; row != rows; ++row)
+            Test::Check(outputs[row] == references[row], "%s quantized dense of %zu columns [%zu]: %d, scalar %d",
+                        table_name, columns_count, row, outputs[row], references[row]);
+
+        table.dense(saturated_weights.Data(), saturated_weights.Stride(), 3, columns_count, saturated_inputs.data(),
+                    outputs.data());
+        scalar.dense(saturated_weights.Data(), saturated_weights.Stride(), 3, columns_count,
+                     saturated_inputs.data(), references.data());
+        for (size_t row = 0; row != 3; ++row)
+            Test::Check(outputs[row] == references[row],
+                        "%s saturated quantized dense of %zu columns [%zu]: %d, scalar %d", table_name,
+                        columns_count, row, outputs[row], references[row]);
+    }
+
+    std::printf("%s quantized table compared with the scalar one\n", table_name);
+}
+
+} // namespace
+
+int main() {
+    for (auto instruction_set :
+         {Kernels::InstructionSet::Sse2, Kernels::InstructionSet::Avx2, Kernels::InstructionSet::Avx512}) {
+        if (!Kernels::IsSupported(instruction_set)) {
+            std::printf("%s is not supported, skipped\n", Kernels::GetName(instruction_set));
+            continue;
+        }
+        TestTable<float, float>(instruction_set, "float");
+        TestTable<double, double>(instruction_set, "double");
+        TestTable<float, BFloat16>(instruction_set, "float/bfloat16");
+        TestQuantizedTable(instruction_set);
+    }
+    return Test::GetExitCode();
+}
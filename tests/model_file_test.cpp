@@ -0,0 +1,111 @@
+// Networks written with DumpToFile and read back with LoadFromFile compute the same outputs, and files whose header
+// does not match their contents are rejected.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <neural/bfloat16.h>
+#include <neural/model_file.h>
+#include <neural/network.h>
+
+#include "test.h"
+
+namespace {
+
+using namespace Neural;
+
+constexpr size_t inputs_count = 37;
+constexpr size_t samples_count = 8;
+
+template <typename T, typename W>
+void TestRoundTrip(Loss loss, const char* type_name) {
+    BasicNetwork<T, W> network(inputs_count, {19, 10});
+    network.Randomize(7);
+    network.SetLoss(loss);
+
+    const std::string path = std::string("model_file_test_") + type_name + ".model";
+    if (!Test::Check(network.DumpToFile(path), "%s: cannot write %s", type_name, path.c_str()))
+        return;
+    for (bool verify_checksum : {false, true}) {
+        auto loaded = BasicNetwork<T, W>::LoadFromFile(path, verify_checksum);
+        if (!Test::Check(loaded.has_value(), "%s %s: cannot read the file back", type_name, GetName(loss)))
+            continue;
+        Test::Check(loaded->GetLoss() == loss, "%s %s: read back with the %s loss", type_name, GetName(loss),
+                    GetName(loaded->GetLoss()));
+
+        std::vector<T> inputs(inputs_count);
+        for (size_t sample_index = 0; sample_index != samples_count; ++sample_index) {
+            for (size_t input_index = 0; input_index != inputs_count; ++input_index)
+                inputs[input_index] = static_cast<T>((input_index * 7 + sample_index * 3) % 11) / 10;
+            const std::vector<T> outputs = network.ComputeOutput(inputs);
+            const std::vector<T> loaded_outputs = loaded->ComputeOutput(inputs);
+            for (size_t output_index = 0; output_index != outputs.size(); ++output_index)
+                Test::Check(outputs[output_index] == loaded_outputs[output_index],
+                            "%s %s: output %zu of sample %zu is %g after loading, %g before", type_name,
+                            GetName(loss), output_index, sample_index,
+                            static_cast<double>(loaded_outputs[output_index]),
+                            static_cast<double>(outputs[output_index]));
+        }
+    }
+    std::remove(path.c_str());
+    std::printf("%s %s network read back\n", type_name, GetName(loss));
+}
+
+// Rewrite a 32-bit number of a valid file, at the given offset from its start, and try to read it back.
+void TestCorruption(const char* name, size_t offset, std::uint32_t value, bool verify_checksum = false) {
+    Network network(inputs_count, {19, 10});
+    network.Randomize(7);
+    const std::string path = "model_file_test_corrupted.model";
+    if (!Test::Check(network.DumpToFile(path), "cannot write %s", path.c_str()))
+        return;
+
+    std::vector<char> contents;
+    {
+        std::ifstream in(path, std::ios::binary);
+        contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    std::memcpy(contents.data() + offset, &value, sizeof(value));
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(contents.data(), contents.size());
+    }
+    Test::Check(!Network::LoadFromFile(path, verify_checksum).has_value(), "%s: the file is read anyway", name);
+    std::remove(path.c_str());
+}
+
+void TestCorruptions() {
+    using ModelFile::Header;
+    const size_t sizes_offset = sizeof(Header);
+    const std::uint32_t swapped_version = (ModelFile::version & 0xff) << 24 | (ModelFile::version & 0xff00) << 8 |
+                                          (ModelFile::version >> 8 & 0xff00) | ModelFile::version >> 24;
+    TestCorruption("byte swapped version", offsetof(Header, version), swapped_version);
+    TestCorruption("no inputs", offsetof(Header, inputs_count), 0);
+    TestCorruption("more inputs", offsetof(Header, inputs_count), inputs_count + 64);
+    TestCorruption("huge inputs count", offsetof(Header, inputs_count), 0xffffffff);
+    TestCorruption("huge layers count", offsetof(Header, layers_count), 0xffffffff);
+    TestCorruption("unknown loss", offsetof(Header, loss), 2);
+    TestCorruption("empty layer", sizes_offset, 0);
+    TestCorruption("huge layer", sizes_offset, 0xffffffff);
+    TestCorruption("layers traded for each other", sizes_offset + sizeof(std::uint32_t), 19);
+    TestCorruption("changed weight", ModelFile::AlignBlock(sizes_offset + 2 * sizeof(std::uint32_t)), 0x3f800000,
+                   true);
+    std::printf("corrupted files rejected\n");
+}
+
+} // namespace
+
+int main() {
+    TestCorruptions();
+    for (auto loss : {Loss::SquaredError, Loss::CrossEntropy}) {
+        TestRoundTrip<float, float>(loss, "float");
+        TestRoundTrip<double, double>(loss, "double");
+        TestRoundTrip<float, BFloat16>(loss, "bfloat16");
+    }
+    return Test::GetExitCode();
+}
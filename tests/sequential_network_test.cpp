@@ -0,0 +1,97 @@
+// SequentialNetwork computes the same outputs as the Network it is built from, per sample and per batch.
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+#include <neural/layers.h>
+#include <neural/matrix.h>
+#include <neural/network.h>
+#include <neural/sequential_network.h>
+
+#include "test.h"
+
+namespace {
+
+using namespace Neural;
+
+constexpr size_t inputs_count = 37;
+constexpr size_t samples_count = 21;
+
+Matrix<float> CreateInputs() {
+    Matrix<float> inputs(samples_count, inputs_count);
+    for (size_t sample_index = 0; sample_index != samples_count; ++sample_index)
+        for (size_t input_index = 0; input_index != inputs_count; ++input_index)
+            inputs(sample_index, input_index) = static_cast<float>((input_index * 7 + sample_index * 3) % 11) / 10;
+    return inputs;
+}
+
+void TestNetworkLayers(Loss loss, Kernels::Activation activation) {
+    Network network(inputs_count, {70, 19, 10});
+    network.Randomize(7);
+    network.SetLoss(loss);
+    network.SetActivation(activation);
+    const SequentialNetwork sequential_network(network);
+
+    const Matrix<float> inputs = CreateInputs();
+    Matrix<float> outputs(samples_count, network.GetOutputsCount());
+    Matrix<float> sequential_outputs(samples_count, network.GetOutputsCount());
+    Matrix<float> batch_outputs(samples_count, network.GetOutputsCount());
+    network.ComputeOutputBatch(inputs.View(), outputs.View());
+    auto workspace = sequential_network.CreateWorkspace();
+    for (size_t sample_index = 0; sample_index != samples_count; ++sample_index)
+        sequential_network.ComputeOutput({inputs.Row(sample_index), inputs_count}, workspace,
+                                         {sequential_outputs.Row(sample_index), network.GetOutputsCount()});
+    sequential_network.ComputeOutputBatch(inputs.View(), batch_outputs.View(), workspace);
+
+    for (size_t sample_index = 0; sample_index != samples_count; ++sample_index)
+        for (size_t output_index = 0; output_index != network.GetOutputsCount(); ++output_index) {
+            const float output = outputs(sample_index, output_index);
+            Test::Check(Test::IsClose(sequential_outputs(sample_index, output_index), output, 1e-6),
+                        "%s %s: output %zu of sample %zu is %g, %g in Network", GetName(loss),
+                        Kernels::GetName(activation), output_index, sample_index,
+                        sequential_outputs(sample_index, output_index), output);
+            Test::Check(Test::IsClose(batch_outputs(sample_index, output_index), output, 1e-6),
+                        "%s %s: batch output %zu of sample %zu is %g, %g in Network", GetName(loss),
+                        Kernels::GetName(activation), output_index, sample_index,
+                        batch_outputs(sample_index, output_index), output);
+        }
+    std::printf("%s %s layers match the network\n", GetName(loss), Kernels::GetName(activation));
+}
+
+// Layers that are not fused, with a batch grown between calls.
+void TestMixedLayers() {
+    SequentialNetwork network;
+    network.Add<DenseLayer>(inputs_count, 24);
+    network.Add<NormalizationLayer>(24);
+    network.Add<ActivationLayer>(24, Kernels::Activation::Precise);
+    network.Add<DropoutLayer>(24, 0.25f);
+    network.Add<DenseLayer>(24, 10);
+    network.Add<SoftmaxLayer>(10);
+    network.Randomize(3);
+
+    const Matrix<float> inputs = CreateInputs();
+    Matrix<float> batch_outputs(samples_count, network.GetOutputsCount());
+    auto workspace = network.CreateWorkspace();
+    network.ComputeOutputBatch(inputs.View().RowRange(0, 2), batch_outputs.View().RowRange(0, 2), workspace);
+    network.ComputeOutputBatch(inputs.View(), batch_outputs.View(), workspace);
+    std::vector<float> outputs(network.GetOutputsCount());
+    for (size_t sample_index = 0; sample_index != samples_count; ++sample_index) {
+        network.ComputeOutput({inputs.Row(sample_index), inputs_count}, workspace, outputs);
+        for (size_t output_index = 0; output_index != outputs.size(); ++output_index)
+            Test::Check(Test::IsClose(batch_outputs(sample_index, output_index), outputs[output_index], 1e-6),
+                        "mixed layers: batch output %zu of sample %zu is %g, %g per sample", output_index,
+                        sample_index, batch_outputs(sample_index, output_index), outputs[output_index]);
+    }
+    std::printf("mixed layers match per sample\n");
+}
+
+} // namespace
+
+int main() {
+    for (auto loss : {Loss::SquaredError, Loss::CrossEntropy})
+        for (auto activation : {Kernels::Activation::Precise, Kernels::Activation::Exact})
+            TestNetworkLayers(loss, activation);
+    TestMixedLayers();
+    return Test::GetExitCode();
+}
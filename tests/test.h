@@ -0,0 +1,45 @@
+#pragma once
+
+// Minimal checks for the test executables: every failed check is reported and counted, and main returns
+// GetExitCode() so that CTest sees the failure.
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+
+namespace Test {
+
+inline int& GetFailuresCount() {
+    static int count = 0;
+    return count;
+}
+
+#if defined(__GNUC__)
+__attribute__((format(printf, 2, 3)))
+#endif
+inline bool Check(bool condition, const char* format, ...) {
+    if (!condition) {
+        ++GetFailuresCount();
+        std::va_list arguments;
+        va_start(arguments, format);
+        std::fputs("FAILED: ", stderr);
+        std::vfprintf(stderr, format, arguments);
+        std::fputc('\n', stderr);
+        va_end(arguments);
+    }
+    return condition;
+}
+
+// Whether two values differ by at most the tolerance, relative to the larger magnitude above 1 and absolute below.
+inline bool IsClose(double value, double reference, double tolerance) {
+    const double magnitude = std::fmax(1.0, std::fmax(std::fabs(value), std::fabs(reference)));
+    return std::fabs(value - reference) <= tolerance * magnitude;
+}
+
+inline int GetExitCode() {
+    if (GetFailuresCount() != 0)
+        std::fprintf(stderr, "%d checks failed\n", GetFailuresCount());
+    return GetFailuresCount() == 0 ? 0 : 1;
+}
+
+} // namespace Test